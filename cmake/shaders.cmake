@@ -1,4 +1,3 @@
-
 macro(make_shaders NAME_IN NAME_OUT)
     file(GLOB SHADERS shaders/*)
     foreach(SHADER ${SHADERS})
@@ -6,4 +5,28 @@ macro(make_shaders NAME_IN NAME_OUT)
         file(READ ${SHADER} ${SHADERNAME})
     endforeach ()
     configure_file(${NAME_IN} ${NAME_OUT} @ONLY)
-endmacro()
\ No newline at end of file
+endmacro()
+
+macro(make_spirv_shaders TARGET)
+    if (NOT GLSLC_EXECUTABLE)
+        find_program(GLSLC_EXECUTABLE glslc HINTS ${Vulkan_GLSLC_EXECUTABLE} $ENV{VULKAN_SDK}/bin REQUIRED)
+    endif ()
+    file(GLOB SHADERS ${CMAKE_CURRENT_SOURCE_DIR}/shaders/*)
+    set(SPIRV_DIR ${CMAKE_CURRENT_BINARY_DIR}/shaders)
+    set(SPIRV_INCLUDES)
+    foreach(SHADER ${SHADERS})
+        get_filename_component(SHADERNAME ${SHADER} NAME)
+        set(SPIRV_INCLUDE ${SPIRV_DIR}/${SHADERNAME}.inc)
+        add_custom_command(
+                OUTPUT ${SPIRV_INCLUDE}
+                COMMAND ${CMAKE_COMMAND} -E make_directory ${SPIRV_DIR}
+                COMMAND ${GLSLC_EXECUTABLE} -O -mfmt=num -o ${SPIRV_INCLUDE} ${SHADER}
+                DEPENDS ${SHADER}
+                COMMENT "Compiling ${SHADERNAME} to SPIR-V"
+                VERBATIM
+        )
+        list(APPEND SPIRV_INCLUDES ${SPIRV_INCLUDE})
+    endforeach ()
+    target_sources(${TARGET} PRIVATE ${SPIRV_INCLUDES})
+    target_include_directories(${TARGET} PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
+endmacro()
@@ -0,0 +1,90 @@
+#include "backend/gl/renderer/gpu_timer.h"
+
+namespace gl {
+
+namespace {
+
+ArrayObject CreateQuery() {
+  return {1, glGenQueries, glDeleteQueries};
+}
+
+bool QueryAvailable(const ArrayObject& query) {
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(query.Value(), GL_QUERY_RESULT_AVAILABLE, &available);
+  return available == GL_TRUE;
+}
+
+GLuint64 QueryResult(const ArrayObject& query) {
+  GLuint64 result = 0;
+  glGetQueryObjectui64v(query.Value(), GL_QUERY_RESULT, &result);
+  return result;
+}
+
+} // namespace
+
+GpuTimer::GpuTimer() : curr_frame_(0), range_active_(false) {
+  for (FrameQueries& frame : frames_) {
+    frame.pass = {CreateQuery(), CreateQuery()};
+    frame.ranges.reserve(kMaxRanges);
+    for (size_t i = 0; i < kMaxRanges; ++i) {
+      frame.ranges.push_back(CreateQuery());
+    }
+    frame.range_indices.reserve(kMaxRanges);
+    frame.dropped = 0;
+    frame.pending = false;
+  }
+}
+
+void GpuTimer::Begin() {
+  FrameQueries& queries = frames_[curr_frame_];
+  queries.range_indices.clear();
+  queries.dropped = 0;
+  queries.pending = true;
+
+  glQueryCounter(queries.pass[0].Value(), GL_TIMESTAMP);
+}
+
+void GpuTimer::BeginRange(const size_t range) {
+  FrameQueries& queries = frames_[curr_frame_];
+  if (queries.range_indices.size() == kMaxRanges) {
+    ++queries.dropped;
+    return;
+  }
+  glBeginQuery(GL_TIME_ELAPSED, queries.ranges[queries.range_indices.size()].Value());
+  queries.range_indices.push_back(range);
+  range_active_ = true;
+}
+
+void GpuTimer::EndRange() {
+  if (!range_active_) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  range_active_ = false;
+}
+
+void GpuTimer::End() {
+  glQueryCounter(frames_[curr_frame_].pass[1].Value(), GL_TIMESTAMP);
+  curr_frame_ = (curr_frame_ + 1) % kFrameLatency;
+}
+
+void GpuTimer::Collect(engine::FrameStats* frame_stats) {
+  FrameQueries& queries = frames_[curr_frame_];
+  if (!queries.pending) {
+    return;
+  }
+  // Results that are still in flight after kFrameLatency frames are dropped, reissuing the queries discards them.
+  queries.pending = false;
+  if (frame_stats == nullptr || !QueryAvailable(queries.pass[1])) {
+    return;
+  }
+  frame_stats->AddGpuTime(static_cast<double>(QueryResult(queries.pass[1]) - QueryResult(queries.pass[0])) / 1e6);
+  frame_stats->AddDroppedGpuRanges(queries.dropped);
+  for (size_t i = 0; i < queries.range_indices.size(); ++i) {
+    if (QueryAvailable(queries.ranges[i])) {
+      frame_stats->AddGpuRangeTime(queries.range_indices[i], static_cast<double>(QueryResult(queries.ranges[i])) / 1e6);
+    }
+  }
+}
+
+} // namespace gl
@@ -0,0 +1,44 @@
+#ifndef BACKEND_GL_RENDERER_GPU_TIMER_H_
+#define BACKEND_GL_RENDERER_GPU_TIMER_H_
+
+#include <GL/glew.h>
+
+#include <array>
+#include <vector>
+
+#include "backend/gl/renderer/handle_object.h"
+#include "engine/frame_stats.h"
+
+namespace gl {
+
+class GpuTimer final {
+public:
+  static constexpr size_t kMaxRanges = engine::FrameStats::kMaxGpuRanges;
+  static constexpr size_t kFrameLatency = 3;
+
+  GpuTimer();
+
+  void Begin();
+  void BeginRange(size_t range);
+  void EndRange();
+  void End();
+
+  void Collect(engine::FrameStats* frame_stats);
+private:
+  struct FrameQueries {
+    std::array<ArrayObject, 2> pass;
+    std::vector<ArrayObject> ranges;
+    std::vector<size_t> range_indices;
+    // ranges past kMaxRanges, counted instead of timed
+    size_t dropped;
+    bool pending;
+  };
+
+  std::array<FrameQueries, kFrameLatency> frames_;
+  size_t curr_frame_;
+  bool range_active_;
+};
+
+} // namespace gl
+
+#endif // BACKEND_GL_RENDERER_GPU_TIMER_H_
@@ -30,6 +30,9 @@ ValueObject::ValueObject(ValueObject&& other) noexcept : value_(other.value_), d
 
 ValueObject& ValueObject::operator=(ValueObject&& other) noexcept {
   if (this != &other) {
+    if (deleter_ != nullptr) {
+      deleter_(value_);
+    }
     value_ = std::exchange(other.value_, 0);
     deleter_ = std::exchange(other.deleter_, nullptr);
   }
@@ -55,6 +58,9 @@ ArrayObject::~ArrayObject() {
 
 ArrayObject& ArrayObject::operator=(ArrayObject&& other) noexcept {
   if (this != &other) {
+    if (deleter_ != nullptr) {
+      deleter_(size_, &array_);
+    }
     size_ = std::exchange(other.size_, 0);
     array_ = std::exchange(other.array_, 0);
     deleter_ = std::exchange(other.deleter_, nullptr);
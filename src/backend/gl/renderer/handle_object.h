@@ -20,8 +20,8 @@ public:
 
   [[nodiscard]] GLuint Value() const noexcept;
 private:
-  GLuint value_;
-  Deleter deleter_;
+  GLuint value_ = 0;
+  Deleter deleter_ = nullptr;
 };
 
 inline GLuint ValueObject::Value() const noexcept {
@@ -44,9 +44,9 @@ public:
 
   [[nodiscard]] GLuint Value() const noexcept;
 private:
-  GLsizei size_;
-  GLuint array_;
-  Deleter deleter_;
+  GLsizei size_ = 0;
+  GLuint array_ = 0;
+  Deleter deleter_ = nullptr;
 };
 
 inline GLuint ArrayObject::Value() const noexcept {
@@ -1,6 +1,12 @@
 #include "backend/gl/renderer/object_loader.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <future>
 #include <optional>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -11,11 +17,45 @@
 #include "engine/render/types.h"
 #include "engine/render/data_util.h"
 #include "obj/parser.h"
+#include "texture/cache.h"
+#include "texture/ktx2.h"
+#include "trace/trace.h"
 
 namespace gl {
 
 namespace {
 
+struct VertexAttribute {
+  const char* name;
+  GLint size;
+  GLuint offset;
+};
+
+constexpr GLuint kVertexBinding = 0;
+
+constexpr std::array kVertexAttributes = {
+  VertexAttribute{"inPosition", 3, offsetof(engine::Vertex, pos)},
+  VertexAttribute{"inNormal", 3, offsetof(engine::Vertex, normal)},
+  VertexAttribute{"inTexCoord", 2, offsetof(engine::Vertex, tex_coord)}
+};
+
+inline bool DirectStateAccessSupported() {
+  return GLEW_VERSION_4_5 || (GLEW_ARB_direct_state_access && GLEW_ARB_buffer_storage);
+}
+
+std::pair<ArrayObject, void*> CreateStagingBuffer(const GLsizeiptr size) {
+  constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  ArrayObject staging(1, glCreateBuffers, glDeleteBuffers);
+  glNamedBufferStorage(staging.Value(), size, nullptr, flags);
+
+  void* mapped = glMapNamedBufferRange(staging.Value(), 0, size, flags);
+  if (mapped == nullptr) {
+    throw Error("Failed to map staging buffer");
+  }
+  return {std::move(staging), mapped};
+}
+
 ArrayObject TextureCreate(const uint8_t* data, const int width, const int height) {
   ArrayObject texture(1, glGenTextures, glDeleteTextures);
   glBindTexture(GL_TEXTURE_2D, texture.Value());
@@ -30,45 +70,271 @@ ArrayObject TextureCreate(const uint8_t* data, const int width, const int height
   return texture;
 }
 
+GLenum ToGlFormat(const texture::Format format) noexcept {
+  switch (format) {
+    case texture::Format::kBc1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case texture::Format::kBc3:
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case texture::Format::kBc7:
+      return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+      return GL_RGBA;
+  }
+}
+
+// Block formats the context can sample, best quality first.
+std::vector<texture::Format> GetTextureFormats() {
+  std::vector<texture::Format> formats;
+  if (GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc) {
+    formats.push_back(texture::Format::kBc7);
+  }
+  if (GLEW_EXT_texture_compression_s3tc) {
+    formats.insert(formats.end(), {texture::Format::kBc3, texture::Format::kBc1});
+  }
+  return formats;
+}
+
+ArrayObject CompressedTextureCreate(const texture::Texture& texture) {
+  ArrayObject handle(1, glGenTextures, glDeleteTextures);
+  glBindTexture(GL_TEXTURE_2D, handle.Value());
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size() - 1));
+
+  const GLenum format = ToGlFormat(texture.format);
+  for (size_t i = 0; i < texture.levels.size(); ++i) {
+    const texture::Level& level = texture.levels[i];
+    const uint8_t* data = texture.data.data() + level.offset;
+    const auto width = static_cast<GLsizei>(level.width), height = static_cast<GLsizei>(level.height);
+    if (texture.format == texture::Format::kRgba8) {
+      glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    } else {
+      glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), format, width, height, 0, static_cast<GLsizei>(level.size), data);
+    }
+  }
+  return handle;
+}
+
 ArrayObject LoadDummyTexture()  {
   constexpr int dummy_width = 16;
   constexpr int dummy_height = 16;
 
-  const std::vector<unsigned char> dummy_colors(dummy_width * dummy_height, 0xff);
+  const std::vector<unsigned char> dummy_colors(dummy_width * dummy_height * STBI_rgb_alpha, 0xff);
 
   return TextureCreate(dummy_colors.data(), dummy_width, dummy_height);
 }
 
-ArrayObject LoadTexture(const std::string& path) {
+DecodedImage DecodeImage(const std::string& path) {
+  TRACE_ZONE("stbi_load");
   int image_width, image_height, image_channels;
-  const std::unique_ptr<stbi_uc, void(*)(void*)> pixels(stbi_load(path.c_str(), &image_width, &image_height, &image_channels, STBI_rgb_alpha), stbi_image_free);
+  std::unique_ptr<stbi_uc, void(*)(void*)> pixels(stbi_load(path.c_str(), &image_width, &image_height, &image_channels, STBI_rgb_alpha), stbi_image_free);
   if (pixels == nullptr) {
+    return {std::move(pixels), 0, 0};
+  }
+  return {std::move(pixels), image_width, image_height};
+}
+
+// KTX2 materials are uploaded in their stored format, other images are encoded once and cached next to the source.
+texture::Texture LoadTexture(const std::string& path, const std::vector<texture::Format>& formats) {
+  TRACE_ZONE("LoadTexture");
+  if (std::filesystem::path(path).extension() == ".ktx2") {
+    texture::Texture texture = texture::ReadKtx2(path);
+    if (std::find(formats.begin(), formats.end(), texture.format) == formats.end() && texture.format != texture::Format::kRgba8) {
+      throw Error("Texture format of " + path + " is not supported");
+    }
+    return texture;
+  }
+  if (std::optional<texture::Texture> cached = texture::LoadCached(path, formats)) {
+    return std::move(*cached);
+  }
+  const DecodedImage image = DecodeImage(path);
+  if (image.pixels == nullptr) {
+    constexpr uint32_t dummy_size = 16;
+    const std::vector<unsigned char> dummy_colors(dummy_size * dummy_size * STBI_rgb_alpha, 0xff);
+    return texture::BuildMips(dummy_colors.data(), dummy_size, dummy_size);
+  }
+  const auto width = static_cast<uint32_t>(image.width), height = static_cast<uint32_t>(image.height);
+  const texture::Format format = texture::ChooseFormat(formats, texture::HasAlpha(image.pixels.get(), width, height));
+  texture::Texture texture = texture::Compress(texture::BuildMips(image.pixels.get(), width, height), format);
+  if (format != texture::Format::kRgba8) {
+    texture::StoreCached(path, texture);
+  }
+  return texture;
+}
+
+std::vector<texture::Texture> LoadTextures(const obj::Data& data) {
+  const std::vector<texture::Format> formats = GetTextureFormats();
+
+  std::vector<std::future<texture::Texture>> loaded_textures;
+  loaded_textures.reserve(data.mtl.size());
+
+  for(const obj::NewMtl& mtl : data.mtl) {
+    loaded_textures.emplace_back(std::async(std::launch::async, LoadTexture, mtl.map_kd, formats));
+  }
+  std::vector<texture::Texture> textures;
+  textures.reserve(loaded_textures.size());
+
+  for(std::future<texture::Texture>& loaded_texture : loaded_textures) {
+    textures.emplace_back(loaded_texture.get());
+  }
+  return textures;
+}
+
+std::vector<DecodedImage> DecodeImages(const obj::Data& data) {
+  std::vector<std::future<DecodedImage>> decoded_images;
+  decoded_images.reserve(data.mtl.size());
+
+  for(const obj::NewMtl& mtl : data.mtl) {
+    decoded_images.emplace_back(std::async(std::launch::async, DecodeImage, mtl.map_kd));
+  }
+  std::vector<DecodedImage> images;
+  images.reserve(decoded_images.size());
+
+  for(std::future<DecodedImage>& decoded_image : decoded_images) {
+    images.emplace_back(decoded_image.get());
+  }
+  return images;
+}
+
+ArrayObject UploadTexture(const DecodedImage& image) {
+  if (image.pixels == nullptr) {
     return LoadDummyTexture();
   }
-  return TextureCreate(pixels.get(), image_width, image_height);
+  return TextureCreate(image.pixels.get(), image.width, image.height);
 }
 
-std::vector<ArrayObject> LoadTextures(const obj::Data& data) {
+std::vector<ArrayObject> UploadTextures(const std::vector<DecodedImage>& images) {
   std::vector<ArrayObject> textures;
-  textures.reserve(data.mtl.size());
+  textures.reserve(images.size());
 
-  for(const obj::NewMtl& mtl : data.mtl) {
-    const std::string& path = mtl.map_kd;
-    ArrayObject texture = LoadTexture(path);
-    textures.emplace_back(std::move(texture));
+  for(const DecodedImage& image : images) {
+    textures.emplace_back(UploadTexture(image));
   }
   return textures;
 }
 
+std::vector<ArrayObject> UploadTextures(const std::vector<texture::Texture>& textures) {
+  std::vector<ArrayObject> handles;
+  handles.reserve(textures.size());
+
+  for(const texture::Texture& texture : textures) {
+    handles.emplace_back(CompressedTextureCreate(texture));
+  }
+  return handles;
+}
+
 } // namespace
 
 void ObjectLoader::Init() {
   stbi_set_flip_vertically_on_load(true);
 }
 
+DecodedObject ObjectLoader::Decode(const std::string& path, const bool compress_textures) {
+  obj::Data data = obj::ParseFromFile(path);
+
+  DecodedObject decoded = {};
+  decoded.vertices.resize(data.indices.size());
+  decoded.indices.resize(data.indices.size());
+  decoded.vertices.resize(engine::data_util::RemoveDuplicates(data, decoded.vertices.data(), decoded.indices.data()));
+  if (compress_textures) {
+    decoded.textures = LoadTextures(data);
+  } else {
+    decoded.images = DecodeImages(data);
+  }
+  decoded.usemtl = std::move(data.usemtl);
+
+  return decoded;
+}
+
 Object ObjectLoader::Load(const std::string& path) const {
   obj::Data data = obj::ParseFromFile(path);
 
+  Object object = DirectStateAccessSupported() ? LoadBuffersDirect(data) : LoadBuffersBound(data);
+  object.textures = compress_textures_ ? UploadTextures(LoadTextures(data)) : UploadTextures(DecodeImages(data));
+  object.usemtl = std::move(data.usemtl);
+
+  return object;
+}
+
+Object ObjectLoader::Upload(DecodedObject&& decoded) const {
+  Object object = DirectStateAccessSupported() ? UploadBuffersDirect(decoded) : UploadBuffersBound(decoded);
+  object.textures = compress_textures_ ? UploadTextures(decoded.textures) : UploadTextures(decoded.images);
+  object.usemtl = std::move(decoded.usemtl);
+
+  return object;
+}
+
+Object ObjectLoader::LoadBuffersDirect(const obj::Data& data) const {
+  const auto indices_size = static_cast<GLsizeiptr>(sizeof(engine::Index) * data.indices.size());
+  const auto vertices_capacity = static_cast<GLsizeiptr>(sizeof(engine::Vertex) * data.indices.size());
+
+  auto [staging, mapped] = CreateStagingBuffer(indices_size + vertices_capacity);
+  auto indices = static_cast<engine::Index*>(mapped);
+  auto vertices = reinterpret_cast<engine::Vertex*>(static_cast<char*>(mapped) + indices_size);
+
+  const size_t vertex_count = engine::data_util::RemoveDuplicates(data, vertices, indices);
+  const auto vertices_size = static_cast<GLsizeiptr>(sizeof(engine::Vertex) * vertex_count);
+
+  ArrayObject ebo(1, glCreateBuffers, glDeleteBuffers);
+  glNamedBufferStorage(ebo.Value(), indices_size, nullptr, 0);
+  glCopyNamedBufferSubData(staging.Value(), ebo.Value(), 0, 0, indices_size);
+
+  ArrayObject vbo(1, glCreateBuffers, glDeleteBuffers);
+  glNamedBufferStorage(vbo.Value(), vertices_size, nullptr, 0);
+  glCopyNamedBufferSubData(staging.Value(), vbo.Value(), indices_size, 0, vertices_size);
+
+  glUnmapNamedBuffer(staging.Value());
+
+  Object object = {};
+
+  object.vao = CreateVertexArrayDirect(vbo.Value(), ebo.Value());
+  object.vbo = std::move(vbo);
+  object.ebo = std::move(ebo);
+
+  return object;
+}
+
+Object ObjectLoader::UploadBuffersDirect(const DecodedObject& decoded) const {
+  ArrayObject ebo(1, glCreateBuffers, glDeleteBuffers);
+  glNamedBufferStorage(ebo.Value(), static_cast<GLsizeiptr>(sizeof(engine::Index) * decoded.indices.size()), decoded.indices.data(), 0);
+
+  ArrayObject vbo(1, glCreateBuffers, glDeleteBuffers);
+  glNamedBufferStorage(vbo.Value(), static_cast<GLsizeiptr>(sizeof(engine::Vertex) * decoded.vertices.size()), decoded.vertices.data(), 0);
+
+  Object object = {};
+
+  object.vao = CreateVertexArrayDirect(vbo.Value(), ebo.Value());
+  object.vbo = std::move(vbo);
+  object.ebo = std::move(ebo);
+
+  return object;
+}
+
+ArrayObject ObjectLoader::CreateVertexArrayDirect(const GLuint vbo, const GLuint ebo) const {
+  ArrayObject vao(1, glCreateVertexArrays, glDeleteVertexArrays);
+  glVertexArrayVertexBuffer(vao.Value(), kVertexBinding, vbo, 0, sizeof(engine::Vertex));
+  glVertexArrayElementBuffer(vao.Value(), ebo);
+
+  for(const auto [name, size, offset] : kVertexAttributes) {
+    const GLint location = glGetAttribLocation(program_.Value(), name);
+    if (location < 0) {
+      continue;
+    }
+    glEnableVertexArrayAttrib(vao.Value(), location);
+    glVertexArrayAttribFormat(vao.Value(), location, size, GL_FLOAT, GL_FALSE, offset);
+    glVertexArrayAttribBinding(vao.Value(), location, kVertexBinding);
+  }
+  return vao;
+}
+
+Object ObjectLoader::LoadBuffersBound(const obj::Data& data) const {
+  ArrayObject vao(1, glGenVertexArrays, glDeleteVertexArrays);
+  glBindVertexArray(vao.Value());
+
   ArrayObject ebo(1, glGenBuffers, glDeleteBuffers);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo.Value());
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(engine::Index) * data.indices.size()),  nullptr, GL_STATIC_DRAW);
@@ -86,30 +352,56 @@ Object ObjectLoader::Load(const std::string& path) const {
   }
   engine::data_util::RemoveDuplicates(data, vertices, indices);
 
-  const GLuint pos_loc = glGetAttribLocation(program_.Value(), "inPosition");
-  glVertexAttribPointer(pos_loc, 3, GL_FLOAT, GL_FALSE,  8 * sizeof(float), nullptr);
-  glEnableVertexAttribArray(pos_loc);
-
-  const GLuint normal_loc = glGetAttribLocation(program_.Value(), "inNormal");
-  glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE,  8 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(normal_loc);
-
-  const GLuint tex_loc = glGetAttribLocation(program_.Value(), "inTexCoord");
-  glVertexAttribPointer(tex_loc, 2, GL_FLOAT, GL_FALSE,  8 * sizeof(float), reinterpret_cast<void*>(6 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(tex_loc);
+  SetVertexAttributesBound();
 
   glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
   glUnmapBuffer(GL_ARRAY_BUFFER);
 
+  glBindVertexArray(0);
+
   Object object = {};
 
+  object.vao = std::move(vao);
   object.vbo = std::move(vbo);
   object.ebo = std::move(ebo);
-  object.textures = LoadTextures(data);
-  object.usemtl = std::move(data.usemtl);
 
   return object;
 }
 
+Object ObjectLoader::UploadBuffersBound(const DecodedObject& decoded) const {
+  ArrayObject vao(1, glGenVertexArrays, glDeleteVertexArrays);
+  glBindVertexArray(vao.Value());
+
+  ArrayObject ebo(1, glGenBuffers, glDeleteBuffers);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo.Value());
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(engine::Index) * decoded.indices.size()), decoded.indices.data(), GL_STATIC_DRAW);
+
+  ArrayObject vbo(1, glGenBuffers, glDeleteBuffers);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo.Value());
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(engine::Vertex) * decoded.vertices.size()), decoded.vertices.data(), GL_STATIC_DRAW);
+
+  SetVertexAttributesBound();
+
+  glBindVertexArray(0);
+
+  Object object = {};
+
+  object.vao = std::move(vao);
+  object.vbo = std::move(vbo);
+  object.ebo = std::move(ebo);
+
+  return object;
+}
+
+void ObjectLoader::SetVertexAttributesBound() const {
+  for(const auto [name, size, offset] : kVertexAttributes) {
+    const GLint location = glGetAttribLocation(program_.Value(), name);
+    if (location < 0) {
+      continue;
+    }
+    glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, sizeof(engine::Vertex), reinterpret_cast<void*>(offset));
+    glEnableVertexAttribArray(location);
+  }
+}
 
-} // namespace gl
\ No newline at end of file
+} // namespace gl
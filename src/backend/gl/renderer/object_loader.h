@@ -1,26 +1,57 @@
 #ifndef BACKEND_GL_RENDERER_OBJECT_LOADER_H_
 #define BACKEND_GL_RENDERER_OBJECT_LOADER_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "backend/gl/renderer/handle_object.h"
 #include "backend/gl/renderer/object.h"
+#include "engine/render/types.h"
+#include "obj/types.h"
+#include "texture/texture.h"
 
 namespace gl {
 
+struct DecodedImage {
+  std::unique_ptr<unsigned char, void(*)(void*)> pixels;
+  int width;
+  int height;
+};
+
+struct DecodedObject {
+  std::vector<engine::Vertex> vertices;
+  std::vector<engine::Index> indices;
+  std::vector<DecodedImage> images;
+  // filled instead of images when textures are compressed
+  std::vector<texture::Texture> textures;
+  std::vector<obj::UseMtl> usemtl;
+};
+
 class ObjectLoader {
 public:
   static void Init();
+  static DecodedObject Decode(const std::string& path, bool compress_textures);
 
-  explicit ObjectLoader(const ValueObject& program);
+  ObjectLoader(const ValueObject& program, bool compress_textures);
   ~ObjectLoader() = default;
 
   [[nodiscard]] Object Load(const std::string& path) const;
+  [[nodiscard]] Object Upload(DecodedObject&& decoded) const;
 private:
+  [[nodiscard]] Object LoadBuffersDirect(const obj::Data& data) const;
+  [[nodiscard]] Object LoadBuffersBound(const obj::Data& data) const;
+  [[nodiscard]] Object UploadBuffersDirect(const DecodedObject& decoded) const;
+  [[nodiscard]] Object UploadBuffersBound(const DecodedObject& decoded) const;
+  [[nodiscard]] ArrayObject CreateVertexArrayDirect(GLuint vbo, GLuint ebo) const;
+  void SetVertexAttributesBound() const;
+
   const ValueObject& program_;
+  bool compress_textures_;
 };
 
-inline ObjectLoader::ObjectLoader(const ValueObject& program) : program_(program) {}
+inline ObjectLoader::ObjectLoader(const ValueObject& program, const bool compress_textures)
+  : program_(program), compress_textures_(compress_textures) {}
 
 } // namespace gl
 
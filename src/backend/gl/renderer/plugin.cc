@@ -4,8 +4,8 @@
 #include "backend/gl/renderer/renderer.h"
 #include "backend/gl/renderer/window.h"
 
-engine::Renderer* ENGINE_CONV PluginCreateRenderer(engine::Window& window) {
-  return new gl::Renderer(NAMED_DYNAMIC_CAST(gl::Window&, window));
+engine::Renderer* ENGINE_CONV PluginCreateRenderer(engine::Window& window, const engine::RenderSettings& settings) {
+  return new gl::Renderer(NAMED_DYNAMIC_CAST(gl::Window&, window), settings);
 }
 
 void ENGINE_CONV PluginDestroyRenderer(engine::Renderer* renderer) {
@@ -2,11 +2,13 @@
 
 #include <GL/glew.h>
 
+#include <chrono>
 #include <vector>
 
 #include "backend/gl/renderer/error.h"
 #include "backend/gl/renderer/object_loader.h"
 #include "backend/gl/renderer/shaders.h"
+#include "trace/trace.h"
 
 namespace gl {
 
@@ -56,36 +58,93 @@ ValueObject ShaderProgramCreate() {
   return program;
 }
 
+int ToSwapInterval(const engine::PresentMode present_mode) noexcept {
+  switch (present_mode) {
+    case engine::PresentMode::kImmediate:
+    case engine::PresentMode::kFrameLimited:
+      return 0;
+    default:
+      return 1;
+  }
+}
+
 } // namespace
 
-Renderer::Renderer(Window& window)
+Renderer::Renderer(Window& window, const engine::RenderSettings& settings)
     : window_(window),
+      compress_textures_(settings.compress_textures),
       program_(ShaderProgramCreate()),
       uniform_updater_(program_.Value()),
-      object_() {
+      gpu_timer_(),
+      object_(),
+      frame_stats_(nullptr) {
   ObjectLoader::Init();
+  window.SetSwapInterval(ToSwapInterval(settings.present_mode));
   window.SetWindowResizedCallback([](const int width, const int height) {
     glViewport(0, 0, width, height);
   });
 }
 
 void Renderer::LoadModel(const std::string& path) {
-  object_ = ObjectLoader(program_).Load(path);
+  object_ = ObjectLoader(program_, compress_textures_).Load(path);
+}
+
+std::future<void> Renderer::LoadModelAsync(const std::string& path) {
+  PendingObject pending_object = {};
+  pending_object.decoded = std::async(std::launch::async, ObjectLoader::Decode, path, compress_textures_);
+
+  std::future<void> future = pending_object.promise.get_future();
+  pending_objects_.emplace_back(std::move(pending_object));
+
+  return future;
+}
+
+void Renderer::UploadPendingObjects() {
+  for(auto it = pending_objects_.begin(); it != pending_objects_.end();) {
+    if (it->decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++it;
+      continue;
+    }
+    try {
+      object_ = ObjectLoader(program_, compress_textures_).Upload(it->decoded.get());
+      it->promise.set_value();
+    } catch (...) {
+      it->promise.set_exception(std::current_exception());
+    }
+    it = pending_objects_.erase(it);
+  }
 }
 
 void Renderer::RenderFrame() {
+  TRACE_ZONE("gl::Renderer::RenderFrame");
+  UploadPendingObjects();
+  gpu_timer_.Collect(frame_stats_);
+  gpu_timer_.Begin();
+
   glClearColor(0, 0, 0, 1);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  uniform_updater_.Update(model_.GetUniforms());
-
-  size_t prev_offset = 0;
-
-  for(const auto[index, offset] : object_.usemtl) {
-    glBindTexture(GL_TEXTURE_2D, object_.textures[index].Value());
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(offset - prev_offset), GL_UNSIGNED_INT, reinterpret_cast<void*>(prev_offset * sizeof(GLuint)));
-    prev_offset = offset;
+  {
+    engine::FrameStats::Scope uniform_update_scope(frame_stats_, engine::FrameStats::Phase::kUniformUpdate);
+    uniform_updater_.Update(model_.GetUniforms());
+  }
+  {
+    engine::FrameStats::Scope record_scope(frame_stats_, engine::FrameStats::Phase::kRecord);
+    glBindVertexArray(object_.vao.Value());
+
+    size_t prev_offset = 0;
+
+    for(const auto[index, offset] : object_.usemtl) {
+      glBindTexture(GL_TEXTURE_2D, object_.textures[index].Value());
+      gpu_timer_.BeginRange(index);
+      glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(offset - prev_offset), GL_UNSIGNED_INT, reinterpret_cast<void*>(prev_offset * sizeof(GLuint)));
+      gpu_timer_.EndRange();
+      prev_offset = offset;
+    }
+    glBindVertexArray(0);
   }
+  gpu_timer_.End();
+  engine::FrameStats::Scope fence_wait_scope(frame_stats_, engine::FrameStats::Phase::kFenceWait);
   glFinish();
 }
 
@@ -1,41 +1,63 @@
 #ifndef BACKEND_GL_RENDERER_RENDERER_H_
 #define BACKEND_GL_RENDERER_RENDERER_H_
 
+#include <future>
 #include <string>
+#include <vector>
 
 #include <GL/glew.h>
 
+#include "backend/gl/renderer/gpu_timer.h"
 #include "backend/gl/renderer/handle_object.h"
 #include "backend/gl/renderer/object.h"
+#include "backend/gl/renderer/object_loader.h"
 #include "backend/gl/renderer/window.h"
 #include "backend/gl/renderer/uniform_updater.h"
 #include "engine/render/model.h"
 #include "engine/render/renderer.h"
+#include "engine/render/settings.h"
 
 namespace gl {
 
+struct PendingObject {
+  std::future<DecodedObject> decoded;
+  std::promise<void> promise;
+};
+
 class Renderer final : public engine::Renderer {
 public:
-  explicit Renderer(Window& window);
+  Renderer(Window& window, const engine::RenderSettings& settings);
   ~Renderer() override = default;
 
   void RenderFrame() override;
   void LoadModel(const std::string& path) override;
+  std::future<void> LoadModelAsync(const std::string& path) override;
   [[nodiscard]] engine::Model& GetModel() noexcept override;
+  void SetFrameStats(engine::FrameStats* frame_stats) noexcept override;
 private:
+  void UploadPendingObjects();
+
   Window& window_;
+  bool compress_textures_;
   ValueObject program_;
   UniformUpdater uniform_updater_;
+  GpuTimer gpu_timer_;
 
   Object object_;
+  std::vector<PendingObject> pending_objects_;
 
   engine::Model model_;
+  engine::FrameStats* frame_stats_;
 };
 
 inline engine::Model& Renderer::GetModel() noexcept {
   return model_;
 }
 
+inline void Renderer::SetFrameStats(engine::FrameStats* frame_stats) noexcept {
+  frame_stats_ = frame_stats;
+}
+
 } // namespace gl
 
 #endif // BACKEND_GL_RENDERER_RENDERER_H_
@@ -5,7 +5,10 @@
 
 namespace gl {
 
-class Window : public virtual engine::Window {};
+class Window : public virtual engine::Window {
+public:
+  virtual void SetSwapInterval(int interval) const = 0;
+};
 
 } // namespace gl
 
@@ -21,6 +21,10 @@ void Window::SetWindowEventHandler(EventHandler* handler) noexcept {
   });
 }
 
+void Window::SetSwapInterval(const int interval) const {
+  glfwSwapInterval(interval);
+}
+
 void Window::Loop() const {
   internal::Window::Loop();
   glfwSwapBuffers(window_);
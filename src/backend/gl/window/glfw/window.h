@@ -14,6 +14,7 @@ public:
   ~Window() override = default;
 
   void Loop() const override;
+  void SetSwapInterval(int interval) const override;
   void SetWindowEventHandler(EventHandler* handler) noexcept override;
 };
 
@@ -13,6 +13,10 @@ void Window::Loop() const noexcept {
   SDL_GL_SwapWindow(window_);
 }
 
+void Window::SetSwapInterval(const int interval) const {
+  SDL_GL_SetSwapInterval(interval);
+}
+
 void Window::OnWindowResize([[maybe_unused]]const int window_width, [[maybe_unused]]const int window_height) const {
   int width, height;
   SDL_GL_GetDrawableSize(window_, &width, &height);
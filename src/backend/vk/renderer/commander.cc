@@ -1,14 +1,19 @@
 #include "backend/vk/renderer/commander.h"
 
+#include <limits>
+
 #include "backend/vk/renderer/error.h"
+#include "trace/trace.h"
 
 namespace vk {
 
-Commander::Commander(VkDevice logical_device, VkCommandPool cmd_pool, VkQueue graphics_queue)
+Commander::Commander(VkDevice logical_device, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex)
   : logical_device_(logical_device),
     cmd_pool_(cmd_pool),
     cmd_buffer_(VK_NULL_HANDLE),
-    graphics_queue_(graphics_queue) {
+    graphics_queue_(graphics_queue),
+    queue_mutex_(queue_mutex),
+    fence_(VK_NULL_HANDLE) {
   VkCommandBufferAllocateInfo alloc_info = {};
   alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -18,9 +23,17 @@ Commander::Commander(VkDevice logical_device, VkCommandPool cmd_pool, VkQueue gr
   if (const VkResult result = vkAllocateCommandBuffers(logical_device, &alloc_info, &cmd_buffer_); result != VK_SUCCESS) {
     throw Error("failed to allocate command buffers").WithCode(result);
   }
+  VkFenceCreateInfo fence_info = {};
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+  if (const VkResult result = vkCreateFence(logical_device, &fence_info, nullptr, &fence_); result != VK_SUCCESS) {
+    vkFreeCommandBuffers(logical_device_, cmd_pool_, 1, &cmd_buffer_);
+    throw Error("failed to create command fence").WithCode(result);
+  }
 }
 
 Commander::~Commander() {
+  vkDestroyFence(logical_device_, fence_, nullptr);
   vkFreeCommandBuffers(logical_device_, cmd_pool_, 1, &cmd_buffer_);
 }
 
@@ -35,6 +48,7 @@ void Commander::Begin() const {
 }
 
 void Commander::End() const {
+  TRACE_ZONE("Commander::End");
   if (const VkResult result = vkEndCommandBuffer(cmd_buffer_); result != VK_SUCCESS) {
     throw Error("failed to end cmd buffer").WithCode(result);
   }
@@ -44,16 +58,19 @@ void Commander::End() const {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &cmd_buffer_;
 
-  if (const VkResult result = vkQueueSubmit(graphics_queue_, 1, &submitInfo, VK_NULL_HANDLE); result != VK_SUCCESS) {
-    throw Error("failed to submin the graphics queue");
+  {
+    std::lock_guard lock(queue_mutex_);
+    if (const VkResult result = vkQueueSubmit(graphics_queue_, 1, &submitInfo, fence_); result != VK_SUCCESS) {
+      throw Error("failed to submin the graphics queue");
+    }
   }
-  if (const VkResult result = vkQueueWaitIdle(graphics_queue_); result != VK_SUCCESS) {
-    throw Error("failed to wait idle graphics queue").WithCode(result);
+  if (const VkResult result = vkWaitForFences(logical_device_, 1, &fence_, VK_TRUE, std::numeric_limits<uint64_t>::max()); result != VK_SUCCESS) {
+    throw Error("failed to wait for command fence").WithCode(result);
   }
 }
 
-BufferCommander::BufferCommander(Buffer& buffer, VkCommandPool cmd_pool, VkQueue graphics_queue)
-  : Commander(buffer.creator(), cmd_pool, graphics_queue), buffer_(buffer) {}
+BufferCommander::BufferCommander(Buffer& buffer, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex)
+  : Commander(buffer.creator(), cmd_pool, graphics_queue, queue_mutex), buffer_(buffer) {}
 
 
 void BufferCommander::CopyBuffer(const Buffer& src) const {
@@ -62,87 +79,21 @@ void BufferCommander::CopyBuffer(const Buffer& src) const {
   vkCmdCopyBuffer(cmd_buffer_, src.handle(), buffer_.handle(), 1, &copy_region);
 }
 
-ImageCommander::ImageCommander(Image& image, VkCommandPool cmd_pool, VkQueue graphics_queue)
-    : Commander(image.creator(), cmd_pool, graphics_queue), image_(image) {}
-
-void ImageCommander::GenerateMipmaps() const {
-  VkImage image = image_.handle();
-
-  VkImageMemoryBarrier barrier = {};
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.image = image;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
-  barrier.subresourceRange.levelCount = 1;
-
-  auto mip_width = static_cast<int32_t>(image_.extent().width);
-  auto mip_height = static_cast<int32_t>(image_.extent().height);
-
-  for (uint32_t i = 1; i < image_.mip_levels(); i++) {
-      barrier.subresourceRange.baseMipLevel = i - 1;
-      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-      vkCmdPipelineBarrier(cmd_buffer_,
-          VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-          0, nullptr,
-          0, nullptr,
-          1, &barrier);
-
-      VkImageBlit blit = {};
-      blit.srcOffsets[0] = {0, 0, 0};
-      blit.srcOffsets[1] = {mip_width, mip_height, 1};
-      blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      blit.srcSubresource.mipLevel = i - 1;
-      blit.srcSubresource.baseArrayLayer = 0;
-      blit.srcSubresource.layerCount = 1;
-      blit.dstOffsets[0] = {0, 0, 0};
-      blit.dstOffsets[1] = { mip_width > 1 ? mip_width / 2 : 1, mip_height > 1 ? mip_height / 2 : 1, 1 };
-      blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      blit.dstSubresource.mipLevel = i;
-      blit.dstSubresource.baseArrayLayer = 0;
-      blit.dstSubresource.layerCount = 1;
-
-      vkCmdBlitImage(cmd_buffer_,
-          image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-          image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-          1, &blit,
-          VK_FILTER_LINEAR);
-
-      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-      barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-      vkCmdPipelineBarrier(cmd_buffer_,
-          VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-          0, nullptr,
-          0, nullptr,
-          1, &barrier);
-
-      if (mip_width > 1) mip_width /= 2;
-      if (mip_height > 1) mip_height /= 2;
-  }
-
-  barrier.subresourceRange.baseMipLevel = image_.mip_levels() - 1;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+TransferCommander::TransferCommander(VkDevice logical_device, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex)
+  : Commander(logical_device, cmd_pool, graphics_queue, queue_mutex) {}
 
-  vkCmdPipelineBarrier(cmd_buffer_,
-      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier);
+void TransferCommander::CopyBuffer(const Buffer& src, const VkDeviceSize src_offset, const Buffer& dst, const VkDeviceSize dst_offset, const VkDeviceSize size) const {
+  VkBufferCopy copy_region = {};
+  copy_region.srcOffset = src_offset;
+  copy_region.dstOffset = dst_offset;
+  copy_region.size = size;
+  vkCmdCopyBuffer(cmd_buffer_, src.handle(), dst.handle(), 1, &copy_region);
 }
 
-void ImageCommander::TransitImageLayout(VkImageLayout old_layout, VkImageLayout new_layout) const {
+ImageCommander::ImageCommander(Image& image, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex)
+    : Commander(image.creator(), cmd_pool, graphics_queue, queue_mutex), image_(image) {}
+
+void ImageCommander::TransitImageLayout(VkImageLayout old_layout, VkImageLayout new_layout, const uint32_t base_level, const uint32_t level_count) const {
   VkImageMemoryBarrier barrier = {};
   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   barrier.oldLayout = old_layout;
@@ -151,8 +102,8 @@ void ImageCommander::TransitImageLayout(VkImageLayout old_layout, VkImageLayout
   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barrier.image = image_.handle();
   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = image_.mip_levels();
+  barrier.subresourceRange.baseMipLevel = base_level;
+  barrier.subresourceRange.levelCount = level_count;
   barrier.subresourceRange.baseArrayLayer = 0;
   barrier.subresourceRange.layerCount = 1;
 
@@ -199,4 +150,8 @@ void ImageCommander::CopyBuffer(const Buffer& src) const {
   vkCmdCopyBufferToImage(cmd_buffer_, src.handle(), image_.handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
+void ImageCommander::CopyBufferRegions(const Buffer& src, const std::vector<VkBufferImageCopy>& regions) const {
+  vkCmdCopyBufferToImage(cmd_buffer_, src.handle(), image_.handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+}
+
 } // namespace vk
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <vulkan/vulkan.h>
 
+#include <mutex>
+#include <vector>
+
 #include "backend/vk/renderer/buffer.h"
 #include "backend/vk/renderer/image.h"
 
@@ -10,7 +13,7 @@ namespace vk {
 
 class Commander {
 public:
-  Commander(VkDevice logical_device, VkCommandPool cmd_pool, VkQueue graphics_queue);
+  Commander(VkDevice logical_device, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex);
   ~Commander();
 
   void Begin() const;
@@ -20,11 +23,13 @@ protected:
   VkCommandPool cmd_pool_;
   VkCommandBuffer cmd_buffer_;
   VkQueue graphics_queue_;
+  std::mutex& queue_mutex_;
+  VkFence fence_;
 };
 
 class BufferCommander : public Commander {
 public:
-  BufferCommander(Buffer& buffer, VkCommandPool cmd_pool, VkQueue graphics_queue);
+  BufferCommander(Buffer& buffer, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex);
   ~BufferCommander() = default;
 
   void CopyBuffer(const Buffer& src) const;
@@ -32,14 +37,24 @@ private:
   Buffer& buffer_;
 };
 
+// Copies between buffers it is not bound to, for uploads filling several destinations in one submission.
+class TransferCommander : public Commander {
+public:
+  TransferCommander(VkDevice logical_device, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex);
+  ~TransferCommander() = default;
+
+  void CopyBuffer(const Buffer& src, VkDeviceSize src_offset, const Buffer& dst, VkDeviceSize dst_offset, VkDeviceSize size) const;
+};
+
 class ImageCommander : public Commander {
 public:
-  ImageCommander(Image& image, VkCommandPool cmd_pool, VkQueue graphics_queue);
+  ImageCommander(Image& image, VkCommandPool cmd_pool, VkQueue graphics_queue, std::mutex& queue_mutex);
   ~ImageCommander() = default;
 
-  void GenerateMipmaps() const;
-  void TransitImageLayout(VkImageLayout old_layout, VkImageLayout new_layout) const;
+  void TransitImageLayout(VkImageLayout old_layout, VkImageLayout new_layout, uint32_t base_level = 0, uint32_t level_count = VK_REMAINING_MIP_LEVELS) const;
   void CopyBuffer(const Buffer& src) const;
+  // One region per mip level, for images whose levels are all precomputed.
+  void CopyBufferRegions(const Buffer& src, const std::vector<VkBufferImageCopy>& regions) const;
 private:
   Image& image_;
 };
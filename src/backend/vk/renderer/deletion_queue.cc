@@ -0,0 +1,35 @@
+#include "backend/vk/renderer/deletion_queue.h"
+
+#include <vector>
+
+namespace vk {
+
+void DeletionQueue::Collect(const uint64_t frame, const size_t frame_count) {
+  std::vector<std::unique_ptr<Garbage>> garbage;
+  {
+    std::lock_guard lock(mutex_);
+    frame_ = frame;
+    while (!entries_.empty() && entries_.front().frame + frame_count <= frame) {
+      garbage.push_back(std::move(entries_.front().garbage));
+      entries_.pop_front();
+    }
+  }
+  // destroyed outside the lock and in retirement order
+  for (std::unique_ptr<Garbage>& entry : garbage) {
+    entry.reset();
+  }
+}
+
+void DeletionQueue::Flush() {
+  std::deque<Entry> entries;
+  {
+    std::lock_guard lock(mutex_);
+    entries = std::move(entries_);
+    entries_.clear();
+  }
+  for (Entry& entry : entries) {
+    entry.garbage.reset();
+  }
+}
+
+} // namespace vk
@@ -0,0 +1,57 @@
+#ifndef BACKEND_VK_RENDERER_DELETION_QUEUE_H_
+#define BACKEND_VK_RENDERER_DELETION_QUEUE_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace vk {
+
+// Keeps replaced resources alive until every frame that could still reference them has completed.
+class DeletionQueue final {
+public:
+  DeletionQueue() noexcept;
+
+  template<typename Resource>
+  void Push(Resource&& resource);
+
+  // Sets the frame later pushes are tagged with and destroys everything retired frame_count frames ago or earlier.
+  void Collect(uint64_t frame, size_t frame_count);
+  void Flush();
+private:
+  struct Garbage {
+    virtual ~Garbage() = default;
+  };
+
+  template<typename Resource>
+  struct TypedGarbage final : Garbage {
+    explicit TypedGarbage(Resource&& resource) : resource(std::move(resource)) {}
+
+    Resource resource;
+  };
+
+  struct Entry {
+    uint64_t frame;
+    std::unique_ptr<Garbage> garbage;
+  };
+
+  std::mutex mutex_;
+  std::deque<Entry> entries_;
+  uint64_t frame_;
+};
+
+inline DeletionQueue::DeletionQueue() noexcept : frame_(0) {}
+
+template<typename Resource>
+void DeletionQueue::Push(Resource&& resource) {
+  static_assert(std::is_rvalue_reference_v<Resource&&>, "retired resources must be moved in");
+  auto garbage = std::make_unique<TypedGarbage<std::decay_t<Resource>>>(std::move(resource));
+
+  std::lock_guard lock(mutex_);
+  entries_.push_back({frame_, std::move(garbage)});
+}
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_DELETION_QUEUE_H_
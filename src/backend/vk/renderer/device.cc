@@ -6,6 +6,7 @@
 #include "backend/vk/renderer/device.h"
 #include "backend/vk/renderer/error.h"
 #include "backend/vk/renderer/instance.h"
+#include "trace/trace.h"
 
 namespace vk {
 
@@ -21,15 +22,41 @@ VkSurfaceFormatKHR ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& av
   return available_formats[0];
 }
 
-VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& available_present_modes) {
-//  for (const auto& available_present_mode : available_present_modes) {
-//    if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-//      return available_present_mode;
-//    }
-//  }
+bool PresentModeAvailable(const std::vector<VkPresentModeKHR>& available_present_modes, const VkPresentModeKHR present_mode) {
+  return std::find(available_present_modes.begin(), available_present_modes.end(), present_mode) != available_present_modes.end();
+}
+
+VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& available_present_modes, const VkPresentModeKHR desired_present_mode) {
+  if (PresentModeAvailable(available_present_modes, desired_present_mode)) {
+    return desired_present_mode;
+  }
+  // immediate falls back to the other non blocking mode before settling for fifo, which is always supported
+  if (desired_present_mode == VK_PRESENT_MODE_IMMEDIATE_KHR && PresentModeAvailable(available_present_modes, VK_PRESENT_MODE_MAILBOX_KHR)) {
+    return VK_PRESENT_MODE_MAILBOX_KHR;
+  }
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t ChooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities, const VkPresentModeKHR present_mode) {
+  uint32_t image_count;
+  switch (present_mode) {
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      // one image on screen, one queued and one to render into
+      image_count = std::max(capabilities.minImageCount + 1, 3u);
+      break;
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      image_count = capabilities.minImageCount;
+      break;
+    default:
+      image_count = capabilities.minImageCount + 1;
+      break;
+  }
+  if (capabilities.maxImageCount > 0 && image_count > capabilities.maxImageCount) {
+    image_count = capabilities.maxImageCount;
+  }
+  return image_count;
+}
+
 VkExtent2D ChooseExtent(const VkExtent2D extent, const VkSurfaceCapabilitiesKHR& capabilities) {
   if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
     return capabilities.currentExtent;
@@ -67,6 +94,28 @@ template<typename HandleType, typename AllocInfo>
   return seq;
 }
 
+std::optional<MemoryBudget> Device::memory_budget() const {
+  if (!features_.memory_budget) {
+    return std::nullopt;
+  }
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {};
+  budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+  VkPhysicalDeviceMemoryProperties2 memory_properties = {};
+  memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+  memory_properties.pNext = &budget_properties;
+  vkGetPhysicalDeviceMemoryProperties2(physical_device_.handle(), &memory_properties);
+
+  MemoryBudget memory_budget = {};
+  for (uint32_t i = 0; i < memory_properties.memoryProperties.memoryHeapCount; ++i) {
+    if (memory_properties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      memory_budget.usage += budget_properties.heapUsage[i];
+      memory_budget.budget += budget_properties.heapBudget[i];
+    }
+  }
+  return memory_budget;
+}
+
 DeviceHandle<VkShaderModule> Device::CreateShaderModule(const std::vector<uint32_t>& spirv) const {
   VkShaderModuleCreateInfo create_info = {};
   create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -143,7 +192,17 @@ DeviceHandle<VkPipelineLayout> Device::CreatePipelineLayout(const std::vector<Vk
   return ExecuteCreate(vkCreatePipelineLayout, vkDestroyPipelineLayout, &pipeline_layout_info);
 }
 
-DeviceHandle<VkPipeline> Device::CreatePipeline(VkPipelineLayout pipeline_layout, VkRenderPass render_pass, const std::vector<VkVertexInputAttributeDescription>& attribute_descriptions, const std::vector<VkVertexInputBindingDescription>& binding_descriptions, const std::vector<Shader>& shaders) const {
+DeviceHandle<VkPipelineCache> Device::CreatePipelineCache(const std::vector<uint8_t>& initial_data) const {
+  VkPipelineCacheCreateInfo create_info = {};
+  create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  create_info.initialDataSize = initial_data.size();
+  create_info.pInitialData = initial_data.data();
+
+  return ExecuteCreate(vkCreatePipelineCache, vkDestroyPipelineCache, &create_info);
+}
+
+DeviceHandle<VkPipeline> Device::CreatePipeline(VkPipelineCache pipeline_cache, VkPipelineLayout pipeline_layout, const RenderTarget& render_target, const DepthState& depth_state, const std::vector<VkVertexInputAttributeDescription>& attribute_descriptions, const std::vector<VkVertexInputBindingDescription>& binding_descriptions, const std::vector<Shader>& shaders) const {
+  TRACE_ZONE("Device::CreatePipeline");
   std::vector<VkPipelineShaderStageCreateInfo> shader_stages_infos;
   shader_stages_infos.reserve(shaders.size());
   for(const auto& [module, description] : shaders) {
@@ -189,13 +248,17 @@ DeviceHandle<VkPipeline> Device::CreatePipeline(VkPipelineLayout pipeline_layout
   VkPipelineDepthStencilStateCreateInfo depth_stencil = {};
   depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depth_stencil.depthTestEnable = VK_TRUE;
-  depth_stencil.depthWriteEnable = VK_TRUE;
-  depth_stencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depth_stencil.depthWriteEnable = depth_state.write;
+  depth_stencil.depthCompareOp = depth_state.compare_op;
   depth_stencil.depthBoundsTestEnable = VK_FALSE;
   depth_stencil.stencilTestEnable = VK_FALSE;
 
+  const bool has_fragment_stage = std::any_of(shaders.begin(), shaders.end(), [](const Shader& shader) {
+    return shader.description.stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+  });
+  // depth-only pipelines keep the color attachment untouched
   VkPipelineColorBlendAttachmentState color_blend_attachment = {};
-  color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  color_blend_attachment.colorWriteMask = has_fragment_stage ? VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT : 0;
   color_blend_attachment.blendEnable = VK_FALSE;
 
   VkPipelineColorBlendStateCreateInfo color_blending = {};
@@ -219,9 +282,16 @@ DeviceHandle<VkPipeline> Device::CreatePipeline(VkPipelineLayout pipeline_layout
   dynamic_state.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
   dynamic_state.pDynamicStates = dynamic_states.data();
 
+  VkPipelineRenderingCreateInfoKHR rendering_info = {};
+  rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+  rendering_info.colorAttachmentCount = 1;
+  rendering_info.pColorAttachmentFormats = &render_target.color_format;
+  rendering_info.depthAttachmentFormat = render_target.depth_format;
+
   VkGraphicsPipelineCreateInfo pipeline_info = {};
   pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipeline_info.stageCount = 2;
+  pipeline_info.pNext = render_target.render_pass == VK_NULL_HANDLE ? &rendering_info : nullptr;
+  pipeline_info.stageCount = static_cast<uint32_t>(shader_stages_infos.size());
   pipeline_info.pStages = shader_stages_infos.data();
   pipeline_info.pVertexInputState = &vertex_input_info;
   pipeline_info.pInputAssemblyState = &input_assembly;
@@ -232,14 +302,14 @@ DeviceHandle<VkPipeline> Device::CreatePipeline(VkPipelineLayout pipeline_layout
   pipeline_info.pColorBlendState = &color_blending;
   pipeline_info.pDynamicState = &dynamic_state;
   pipeline_info.layout = pipeline_layout;
-  pipeline_info.renderPass = render_pass;
+  pipeline_info.renderPass = render_target.render_pass;
   pipeline_info.subpass = 0;
   pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
   VkPipeline pipeline = VK_NULL_HANDLE;
   VkDevice logical_device = this->handle();
   const VkAllocationCallbacks* allocator = this->allocator();
-  if (const VkResult result = vkCreateGraphicsPipelines(logical_device, VK_NULL_HANDLE, 1, &pipeline_info, allocator, &pipeline); result != VK_SUCCESS) {
+  if (const VkResult result = vkCreateGraphicsPipelines(logical_device, pipeline_cache, 1, &pipeline_info, allocator, &pipeline); result != VK_SUCCESS) {
     throw Error("failed to create graphics pipeline").WithCode(result);
   }
   return {
@@ -250,6 +320,30 @@ DeviceHandle<VkPipeline> Device::CreatePipeline(VkPipelineLayout pipeline_layout
   };
 }
 
+DeviceHandle<VkPipeline> Device::CreateComputePipeline(VkPipelineCache pipeline_cache, VkPipelineLayout pipeline_layout, const Shader& shader) const {
+  TRACE_ZONE("Device::CreateComputePipeline");
+  VkComputePipelineCreateInfo pipeline_info = {};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipeline_info.stage.stage = shader.description.stage;
+  pipeline_info.stage.pName = shader.description.entry_point.data();
+  pipeline_info.stage.module = shader.module.handle();
+  pipeline_info.layout = pipeline_layout;
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  VkDevice logical_device = this->handle();
+  const VkAllocationCallbacks* allocator = this->allocator();
+  if (const VkResult result = vkCreateComputePipelines(logical_device, pipeline_cache, 1, &pipeline_info, allocator, &pipeline); result != VK_SUCCESS) {
+    throw Error("failed to create compute pipeline").WithCode(result);
+  }
+  return {
+    pipeline,
+    logical_device,
+    vkDestroyPipeline,
+    allocator
+  };
+}
+
 DeviceHandle<VkCommandPool> Device::CreateCommandPool() const {
   VkCommandPoolCreateInfo create_info = {};
   create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -274,6 +368,15 @@ DeviceHandle<VkFence> Device::CreateFence() const {
   return ExecuteCreate(vkCreateFence, vkDestroyFence, &create_info);
 }
 
+DeviceHandle<VkQueryPool> Device::CreateQueryPool(const VkQueryType query_type, const uint32_t query_count) const {
+  VkQueryPoolCreateInfo create_info = {};
+  create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  create_info.queryType = query_type;
+  create_info.queryCount = query_count;
+
+  return ExecuteCreate(vkCreateQueryPool, vkDestroyQueryPool, &create_info);
+}
+
 DeviceHandle<VkDescriptorSetLayout> Device::CreateUniformDescriptorSetLayout() const {
   VkDescriptorSetLayoutBinding layout_binding = {};
   layout_binding.binding = 0;
@@ -306,14 +409,59 @@ DeviceHandle<VkDescriptorSetLayout> Device::CreateSamplerDescriptorSetLayout() c
   return ExecuteCreate(vkCreateDescriptorSetLayout, vkDestroyDescriptorSetLayout, &layout_info);
 }
 
-DeviceHandle<VkDescriptorPool> Device::CreateDescriptorPool(const size_t uniform_count, const size_t sampler_count) const {
-  std::array<VkDescriptorPoolSize, 2> pool_sizes = {};
+DeviceHandle<VkDescriptorSetLayout> Device::CreateCullDescriptorSetLayout() const {
+  std::array<VkDescriptorSetLayoutBinding, 4> layout_bindings = {};
+  for (uint32_t i = 0; i < layout_bindings.size(); ++i) {
+    layout_bindings[i].binding = i;
+    layout_bindings[i].descriptorCount = 1;
+    layout_bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  VkDescriptorSetLayoutCreateInfo layout_info = {};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = static_cast<uint32_t>(layout_bindings.size());
+  layout_info.pBindings = layout_bindings.data();
+
+  return ExecuteCreate(vkCreateDescriptorSetLayout, vkDestroyDescriptorSetLayout, &layout_info);
+}
+
+DeviceHandle<VkDescriptorSetLayout> Device::CreateVirtualTextureDescriptorSetLayout() const {
+  constexpr std::array descriptor_types = {
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+  };
+  std::array<VkDescriptorSetLayoutBinding, descriptor_types.size()> layout_bindings = {};
+  for (uint32_t i = 0; i < layout_bindings.size(); ++i) {
+    layout_bindings[i].binding = i;
+    layout_bindings[i].descriptorCount = 1;
+    layout_bindings[i].descriptorType = descriptor_types[i];
+    layout_bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  }
+  VkDescriptorSetLayoutCreateInfo layout_info = {};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = static_cast<uint32_t>(layout_bindings.size());
+  layout_info.pBindings = layout_bindings.data();
+
+  return ExecuteCreate(vkCreateDescriptorSetLayout, vkDestroyDescriptorSetLayout, &layout_info);
+}
+
+DeviceHandle<VkDescriptorPool> Device::CreateDescriptorPool(const size_t uniform_count, const size_t sampler_count, const size_t storage_count) const {
+  std::vector<VkDescriptorPoolSize> pool_sizes(2);
   pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
   pool_sizes[0].descriptorCount = static_cast<uint32_t>(uniform_count);
 
   pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   pool_sizes[1].descriptorCount = static_cast<uint32_t>(sampler_count);
 
+  if (storage_count != 0) {
+    VkDescriptorPoolSize storage_size = {};
+    storage_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    storage_size.descriptorCount = static_cast<uint32_t>(storage_count);
+    pool_sizes.push_back(storage_size);
+  }
+
   VkDescriptorPoolCreateInfo pool_info = {};
   pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
@@ -323,14 +471,14 @@ DeviceHandle<VkDescriptorPool> Device::CreateDescriptorPool(const size_t uniform
   return ExecuteCreate(vkCreateDescriptorPool, vkDestroyDescriptorPool, &pool_info);
 }
 
-DeviceHandle<VkImageView> Device::CreateImageView(VkImage image, const VkImageAspectFlags aspect_flags, const VkFormat format, const uint32_t mip_levels) const {
+DeviceHandle<VkImageView> Device::CreateImageView(VkImage image, const VkImageAspectFlags aspect_flags, const VkFormat format, const uint32_t mip_levels, const uint32_t base_mip_level) const {
   VkImageViewCreateInfo view_info = {};
   view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   view_info.image = image;
   view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
   view_info.format = format;
   view_info.subresourceRange.aspectMask = aspect_flags;
-  view_info.subresourceRange.baseMipLevel = 0;
+  view_info.subresourceRange.baseMipLevel = base_mip_level;
   view_info.subresourceRange.levelCount = mip_levels;
   view_info.subresourceRange.baseArrayLayer = 0;
   view_info.subresourceRange.layerCount = 1;
@@ -376,6 +524,28 @@ DeviceHandle<VkSampler> Device::CreateSampler(const VkSamplerMipmapMode mipmap_m
   return ExecuteCreate(vkCreateSampler, vkDestroySampler, &sampler_info);
 }
 
+DeviceHandle<VkSampler> Device::CreateClampedSampler(const VkFilter filter) const {
+  VkSamplerCreateInfo sampler_info = {};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = filter;
+  sampler_info.minFilter = filter;
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler_info.anisotropyEnable = VK_FALSE;
+  sampler_info.maxAnisotropy = 1.0f;
+  sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  sampler_info.unnormalizedCoordinates = VK_FALSE;
+  sampler_info.compareEnable = VK_FALSE;
+  sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  sampler_info.minLod = 0.0f;
+  sampler_info.maxLod = 0.0f;
+  sampler_info.mipLodBias = 0.0f;
+
+  return ExecuteCreate(vkCreateSampler, vkDestroySampler, &sampler_info);
+}
+
 std::vector<VkDescriptorSet> Device::CreateDescriptorSets(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorPool descriptor_pool, size_t count) const {
   const std::vector layouts(count, descriptor_set_layout);
 
@@ -465,18 +635,14 @@ Image Device::CreateImage(const VkImageUsageFlags usage, const VkMemoryPropertyF
   );
 }
 
-Swapchain Device::CreateSwapchain(const VkExtent2D size, VkSurfaceKHR surface) const {
+Swapchain Device::CreateSwapchain(const VkExtent2D size, VkSurfaceKHR surface, const VkPresentModeKHR desired_present_mode, VkSwapchainKHR old_swapchain) const {
   const PhysicalDevice::SurfaceSupportDetails device_support_details = physical_device_.surface_support_details(surface);
 
   const auto[format, colorSpace] = ChooseSurfaceFormat(device_support_details.formats);
-  const VkPresentModeKHR present_mode = ChoosePresentMode(device_support_details.present_modes);
+  const VkPresentModeKHR present_mode = ChoosePresentMode(device_support_details.present_modes, desired_present_mode);
 
   const VkExtent2D extent = ChooseExtent(size, device_support_details.capabilities);
-
-  uint32_t image_count = device_support_details.capabilities.minImageCount + 1;
-  if (device_support_details.capabilities.maxImageCount > 0 && image_count > device_support_details.capabilities.maxImageCount) {
-    image_count = device_support_details.capabilities.maxImageCount;
-  }
+  const uint32_t image_count = ChooseImageCount(device_support_details.capabilities, present_mode);
 
   VkSwapchainCreateInfoKHR create_info = {};
   create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -502,11 +668,13 @@ Swapchain Device::CreateSwapchain(const VkExtent2D size, VkSurfaceKHR surface) c
   create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
   create_info.presentMode = present_mode;
   create_info.clipped = VK_TRUE;
+  create_info.oldSwapchain = old_swapchain;
 
   return Swapchain(
     ExecuteCreate(vkCreateSwapchainKHR, vkDestroySwapchainKHR, &create_info),
     extent,
-    format
+    format,
+    present_mode
   );
 }
 
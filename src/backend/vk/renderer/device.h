@@ -3,9 +3,14 @@
 
 #include <vulkan/vulkan.h>
 
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "backend/vk/renderer/buffer.h"
+#include "backend/vk/renderer/deletion_queue.h"
 #include "backend/vk/renderer/handle.h"
 #include "backend/vk/renderer/image.h"
 #include "backend/vk/renderer/physical_device.h"
@@ -19,6 +24,32 @@ struct Queue {
   uint32_t family_index;
 };
 
+// With a null render pass the pipeline targets dynamic rendering with the given formats.
+struct RenderTarget {
+  VkRenderPass render_pass;
+  VkFormat color_format;
+  VkFormat depth_format;
+};
+
+struct DepthState {
+  VkCompareOp compare_op;
+  VkBool32 write;
+};
+
+// Optional features, enabled by the selector when the physical device supports them.
+struct DeviceFeatures {
+  bool dynamic_rendering;
+  bool draw_indirect_count;
+  bool memory_budget;
+  bool fragment_stores;
+};
+
+// Summed over the device local heaps.
+struct MemoryBudget {
+  VkDeviceSize usage;
+  VkDeviceSize budget;
+};
+
 class Device final : public Handle<VkDevice> {
 public:
   using Handle::Handle;
@@ -27,20 +58,46 @@ public:
 
   [[nodiscard]] const Queue& graphics_queue() const noexcept;
   [[nodiscard]] const Queue& present_queue() const noexcept;
+  [[nodiscard]] std::mutex& queue_mutex() const noexcept;
+  [[nodiscard]] bool dynamic_rendering() const noexcept;
+  [[nodiscard]] bool draw_indirect_count() const noexcept;
+  [[nodiscard]] bool fragment_stores() const noexcept;
+  // Empty without VK_EXT_memory_budget.
+  [[nodiscard]] std::optional<MemoryBudget> memory_budget() const;
+
+  void CmdBeginRendering(VkCommandBuffer cmd_buffer, const VkRenderingInfoKHR& rendering_info) const;
+  void CmdEndRendering(VkCommandBuffer cmd_buffer) const;
+  void CmdDrawIndexedIndirectCount(VkCommandBuffer cmd_buffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride) const;
+
+  // Destroys the resource once the frames in flight at the time of the call have completed.
+  template<typename Resource>
+  void Retire(Resource&& resource) const;
+  // Called after waiting for the fence of frame, frees what earlier frames retired.
+  void CollectGarbage(uint64_t frame, size_t frame_count) const;
+  void FlushGarbage() const;
 
   [[nodiscard]] DeviceHandle<VkShaderModule> CreateShaderModule(const std::vector<uint32_t>& shader_info) const;
   [[nodiscard]] DeviceHandle<VkRenderPass> CreateRenderPass(VkFormat image_format, VkFormat depth_format) const;
   [[nodiscard]] DeviceHandle<VkPipelineLayout> CreatePipelineLayout(const std::vector<VkDescriptorSetLayout>& descriptor_set_layouts) const;
-  [[nodiscard]] DeviceHandle<VkPipeline> CreatePipeline(VkPipelineLayout pipeline_layout, VkRenderPass render_pass, const std::vector<VkVertexInputAttributeDescription>& attribute_descriptions, const std::vector<VkVertexInputBindingDescription>& binding_descriptions, const std::vector<Shader>& shaders) const;
+  [[nodiscard]] DeviceHandle<VkPipelineCache> CreatePipelineCache(const std::vector<uint8_t>& initial_data) const;
+  [[nodiscard]] DeviceHandle<VkPipeline> CreatePipeline(VkPipelineCache pipeline_cache, VkPipelineLayout pipeline_layout, const RenderTarget& render_target, const DepthState& depth_state, const std::vector<VkVertexInputAttributeDescription>& attribute_descriptions, const std::vector<VkVertexInputBindingDescription>& binding_descriptions, const std::vector<Shader>& shaders) const;
+  [[nodiscard]] DeviceHandle<VkPipeline> CreateComputePipeline(VkPipelineCache pipeline_cache, VkPipelineLayout pipeline_layout, const Shader& shader) const;
   [[nodiscard]] DeviceHandle<VkCommandPool> CreateCommandPool() const;
   [[nodiscard]] DeviceHandle<VkSemaphore> CreateSemaphore() const;
   [[nodiscard]] DeviceHandle<VkFence> CreateFence() const;
+  [[nodiscard]] DeviceHandle<VkQueryPool> CreateQueryPool(VkQueryType query_type, uint32_t query_count) const;
   [[nodiscard]] DeviceHandle<VkDescriptorSetLayout> CreateUniformDescriptorSetLayout() const;
   [[nodiscard]] DeviceHandle<VkDescriptorSetLayout> CreateSamplerDescriptorSetLayout() const;
-  [[nodiscard]] DeviceHandle<VkDescriptorPool> CreateDescriptorPool(size_t uniform_count, size_t sampler_count) const;
-  [[nodiscard]] DeviceHandle<VkImageView> CreateImageView(VkImage image, VkImageAspectFlags aspect_flags, VkFormat format, uint32_t mip_levels = 1) const;
+  [[nodiscard]] DeviceHandle<VkDescriptorSetLayout> CreateCullDescriptorSetLayout() const;
+  // Page table, tile cache, parameters and feedback of a virtual texture.
+  [[nodiscard]] DeviceHandle<VkDescriptorSetLayout> CreateVirtualTextureDescriptorSetLayout() const;
+  // Every set is expected to hold at most one uniform or sampler descriptor, storage buffers come along with a uniform.
+  [[nodiscard]] DeviceHandle<VkDescriptorPool> CreateDescriptorPool(size_t uniform_count, size_t sampler_count, size_t storage_count = 0) const;
+  [[nodiscard]] DeviceHandle<VkImageView> CreateImageView(VkImage image, VkImageAspectFlags aspect_flags, VkFormat format, uint32_t mip_levels = 1, uint32_t base_mip_level = 0) const;
   [[nodiscard]] DeviceHandle<VkFramebuffer> CreateFramebuffer(const std::vector<VkImageView>& views, VkRenderPass render_pass, VkExtent2D extent) const;
   [[nodiscard]] DeviceHandle<VkSampler> CreateSampler(VkSamplerMipmapMode mipmap_mode, uint32_t mip_levels) const;
+  // Single level, clamped to the edge and without anisotropy, for images the shader addresses itself.
+  [[nodiscard]] DeviceHandle<VkSampler> CreateClampedSampler(VkFilter filter) const;
 
   [[nodiscard]] std::vector<VkDescriptorSet> CreateDescriptorSets(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorPool descriptor_pool, size_t count) const;
   [[nodiscard]] std::vector<VkCommandBuffer> CreateCommandBuffers(VkCommandPool cmd_pool, uint32_t count) const;
@@ -54,7 +111,7 @@ public:
                                   VkFormat format,
                                   VkImageTiling tiling,
                                   uint32_t mip_levels = 1) const;
-  [[nodiscard]] Swapchain CreateSwapchain(VkExtent2D size, VkSurfaceKHR surface) const;
+  [[nodiscard]] Swapchain CreateSwapchain(VkExtent2D size, VkSurfaceKHR surface, VkPresentModeKHR desired_present_mode, VkSwapchainKHR old_swapchain = VK_NULL_HANDLE) const;
 private:
   friend class DeviceSelector;
 
@@ -62,6 +119,13 @@ private:
 
   Queue graphics_queue_;
   Queue present_queue_;
+  std::unique_ptr<std::mutex> queue_mutex_;
+  std::unique_ptr<DeletionQueue> deletion_queue_;
+
+  DeviceFeatures features_;
+  PFN_vkCmdBeginRenderingKHR cmd_begin_rendering_;
+  PFN_vkCmdEndRenderingKHR cmd_end_rendering_;
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmd_draw_indexed_indirect_count_;
 
   template<typename HandleType, typename HandleInfo>
   using DeviceCreateFunc = VkResult(*)(VkDevice, const HandleInfo*, const VkAllocationCallbacks*, HandleType*);
@@ -78,17 +142,32 @@ private:
   template<typename Handle, typename HandleInfo>
   [[nodiscard]] std::vector<Handle> ExecuteAllocate(DeviceAllocateFunc<Handle, HandleInfo> allocate_func, uint32_t count, const HandleInfo* alloc_info) const;
 
-  explicit Device(Handle&& device, PhysicalDevice physical_device, Queue graphics_queue, Queue present_queue) noexcept;
+  explicit Device(Handle&& device, PhysicalDevice physical_device, Queue graphics_queue, Queue present_queue, DeviceFeatures features) noexcept;
 };
 
 inline Device::Device(Handle&& device,
                       const PhysicalDevice physical_device,
                       const Queue graphics_queue,
-                      const Queue present_queue) noexcept
+                      const Queue present_queue,
+                      const DeviceFeatures features) noexcept
   : Handle(std::move(device)),
     physical_device_(physical_device),
     graphics_queue_(graphics_queue),
-    present_queue_(present_queue) {}
+    present_queue_(present_queue),
+    queue_mutex_(std::make_unique<std::mutex>()),
+    deletion_queue_(std::make_unique<DeletionQueue>()),
+    features_(features),
+    cmd_begin_rendering_(nullptr),
+    cmd_end_rendering_(nullptr),
+    cmd_draw_indexed_indirect_count_(nullptr) {
+  if (features_.dynamic_rendering) {
+    cmd_begin_rendering_ = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(handle(), "vkCmdBeginRenderingKHR"));
+    cmd_end_rendering_ = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(handle(), "vkCmdEndRenderingKHR"));
+  }
+  if (features_.draw_indirect_count) {
+    cmd_draw_indexed_indirect_count_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(handle(), "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+}
 
 inline PhysicalDevice Device::physical_device() const noexcept {
   return physical_device_;
@@ -102,6 +181,53 @@ inline const Queue& Device::present_queue() const noexcept {
   return present_queue_;
 }
 
+inline std::mutex& Device::queue_mutex() const noexcept {
+  return *queue_mutex_;
+}
+
+inline bool Device::dynamic_rendering() const noexcept {
+  return features_.dynamic_rendering;
+}
+
+inline bool Device::draw_indirect_count() const noexcept {
+  return features_.draw_indirect_count;
+}
+
+inline bool Device::fragment_stores() const noexcept {
+  return features_.fragment_stores;
+}
+
+inline void Device::CmdBeginRendering(VkCommandBuffer cmd_buffer, const VkRenderingInfoKHR& rendering_info) const {
+  cmd_begin_rendering_(cmd_buffer, &rendering_info);
+}
+
+inline void Device::CmdEndRendering(VkCommandBuffer cmd_buffer) const {
+  cmd_end_rendering_(cmd_buffer);
+}
+
+inline void Device::CmdDrawIndexedIndirectCount(VkCommandBuffer cmd_buffer,
+                                                VkBuffer buffer,
+                                                const VkDeviceSize offset,
+                                                VkBuffer count_buffer,
+                                                const VkDeviceSize count_offset,
+                                                const uint32_t max_draw_count,
+                                                const uint32_t stride) const {
+  cmd_draw_indexed_indirect_count_(cmd_buffer, buffer, offset, count_buffer, count_offset, max_draw_count, stride);
+}
+
+template<typename Resource>
+void Device::Retire(Resource&& resource) const {
+  deletion_queue_->Push(std::forward<Resource>(resource));
+}
+
+inline void Device::CollectGarbage(const uint64_t frame, const size_t frame_count) const {
+  deletion_queue_->Collect(frame, frame_count);
+}
+
+inline void Device::FlushGarbage() const {
+  deletion_queue_->Flush();
+}
+
 } // namespace vk
 
 #endif // BACKEND_VK_RENDERER_DEVICE_H_
\ No newline at end of file
@@ -24,7 +24,7 @@ std::pair<bool, QueueFamilyIndices> DeviceIsSuitable(const PhysicalDevice& physi
     if (queue_family_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
       graphic = static_cast<uint32_t>(i);
     }
-    if (physical_device.surface_supported(requirements.surface, i)) {
+    if (requirements.present && physical_device.surface_supported(requirements.surface, i)) {
       present = static_cast<uint32_t>(i);
     }
     if ((requirements.graphic && !graphic.has_value()) ||
@@ -36,6 +36,9 @@ std::pair<bool, QueueFamilyIndices> DeviceIsSuitable(const PhysicalDevice& physi
         !physical_device.extensions_support(requirements.extensions)) {
       continue;
     }
+    if (!requirements.present) {
+      return {true, {graphic.value(), graphic.value()}};
+    }
     const PhysicalDevice::SurfaceSupportDetails details = physical_device.surface_support_details(requirements.surface);
     if (!details.formats.empty() && !details.present_modes.empty()) {
       return {true, {graphic.value(), present.value()}};
@@ -44,7 +47,7 @@ std::pair<bool, QueueFamilyIndices> DeviceIsSuitable(const PhysicalDevice& physi
   return {};
 }
 
-Handle<VkDevice> CreateDevice(VkPhysicalDevice physical_device, const QueueFamilyIndices& indices, const std::vector<const char*>& extensions, const VkAllocationCallbacks* allocator) {
+Handle<VkDevice> CreateDevice(VkPhysicalDevice physical_device, const QueueFamilyIndices& indices, const std::vector<const char*>& extensions, const DeviceFeatures& features, const VkAllocationCallbacks* allocator) {
   std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
   std::set unique_family_ids = {
     indices.graphic,
@@ -64,9 +67,16 @@ Handle<VkDevice> CreateDevice(VkPhysicalDevice physical_device, const QueueFamil
 #endif // DEBUG
   VkPhysicalDeviceFeatures device_features = {};
   device_features.samplerAnisotropy = VK_TRUE;
+  device_features.multiDrawIndirect = features.draw_indirect_count ? VK_TRUE : VK_FALSE;
+  device_features.fragmentStoresAndAtomics = features.fragment_stores ? VK_TRUE : VK_FALSE;
+
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features = {};
+  dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  dynamic_rendering_features.dynamicRendering = VK_TRUE;
 
   VkDeviceCreateInfo create_info = {};
   create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  create_info.pNext = features.dynamic_rendering ? &dynamic_rendering_features : nullptr;
   create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
   create_info.pQueueCreateInfos = queue_create_infos.data();
   create_info.pEnabledFeatures = &device_features;
@@ -95,7 +105,24 @@ std::optional<Device> DeviceSelector::Select(const Requirements& requirements, c
   for(VkPhysicalDevice vk_physical_device : physical_devices_) {
     PhysicalDevice physical_device(vk_physical_device);
     if (auto[suitable, indices] = DeviceIsSuitable(physical_device, requirements); suitable) {
-      Handle<VkDevice> device = CreateDevice(vk_physical_device, indices, requirements.extensions, allocator);
+      DeviceFeatures features = {};
+      features.dynamic_rendering = requirements.dynamic_rendering && physical_device.dynamic_rendering_supported();
+      features.draw_indirect_count = requirements.draw_indirect_count && physical_device.draw_indirect_count_supported();
+      features.memory_budget = requirements.memory_budget && physical_device.memory_budget_supported();
+      features.fragment_stores = requirements.fragment_stores && physical_device.features().fragmentStoresAndAtomics;
+
+      std::vector<const char*> extensions = requirements.extensions;
+      if (features.dynamic_rendering) {
+        const std::vector<const char*>& dynamic_rendering_extensions = PhysicalDevice::GetDynamicRenderingExtensions();
+        extensions.insert(extensions.end(), dynamic_rendering_extensions.begin(), dynamic_rendering_extensions.end());
+      }
+      if (features.draw_indirect_count) {
+        extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+      }
+      if (features.memory_budget) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      }
+      Handle<VkDevice> device = CreateDevice(vk_physical_device, indices, extensions, features, allocator);
 
       Queue graphics_queue = {};
       vkGetDeviceQueue(device.handle(), indices.graphic, 0, &graphics_queue.handle);
@@ -109,7 +136,8 @@ std::optional<Device> DeviceSelector::Select(const Requirements& requirements, c
         std::move(device),
         physical_device,
         graphics_queue,
-        present_queue
+        present_queue,
+        features
       );
     }
   }
@@ -16,6 +16,11 @@ public:
     bool present;
     bool graphic;
     bool anisotropy;
+    // Optional: enabled only when the physical device supports it.
+    bool dynamic_rendering;
+    bool draw_indirect_count;
+    bool memory_budget;
+    bool fragment_stores;
 
     VkSurfaceKHR surface;
 
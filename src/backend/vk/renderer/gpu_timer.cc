@@ -0,0 +1,121 @@
+#include "backend/vk/renderer/gpu_timer.h"
+
+#include <array>
+
+#include "backend/vk/renderer/error.h"
+
+namespace vk {
+
+namespace {
+
+// Query 0 and 1 bracket the render pass, each draw range takes the next pair.
+constexpr uint32_t kPassQueryCount = 2;
+constexpr uint32_t kQueryCount = kPassQueryCount + 2 * GpuTimer::kMaxRanges;
+
+} // namespace
+
+GpuTimer::GpuTimer(const Device& device, const size_t frame_count)
+  : device_(device.handle()),
+    period_ns_(device.physical_device().properties().limits.timestampPeriod),
+    valid_mask_(0) {
+  const std::vector<VkQueueFamilyProperties> queue_families = device.physical_device().queue_family_properties();
+  const uint32_t valid_bits = queue_families[device.graphics_queue().family_index].timestampValidBits;
+  if (valid_bits == 0) {
+    return;
+  }
+  valid_mask_ = valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+
+  frames_.resize(frame_count);
+  for (FrameQueries& frame : frames_) {
+    frame.pool = device.CreateQueryPool(VK_QUERY_TYPE_TIMESTAMP, kQueryCount);
+    frame.ranges.reserve(kMaxRanges);
+    frame.dropped = 0;
+    frame.range_active = false;
+    frame.pending = false;
+  }
+}
+
+void GpuTimer::Begin(VkCommandBuffer cmd_buffer, const size_t frame) {
+  if (!enabled()) {
+    return;
+  }
+  FrameQueries& queries = frames_[frame];
+  queries.ranges.clear();
+  queries.dropped = 0;
+  queries.pending = true;
+
+  vkCmdResetQueryPool(cmd_buffer, queries.pool.handle(), 0, kQueryCount);
+  vkCmdWriteTimestamp(cmd_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.pool.handle(), 0);
+}
+
+void GpuTimer::BeginRange(VkCommandBuffer cmd_buffer, const size_t frame, const size_t range) {
+  if (!enabled()) {
+    return;
+  }
+  FrameQueries& queries = frames_[frame];
+  if (queries.ranges.size() == kMaxRanges) {
+    ++queries.dropped;
+    return;
+  }
+  const auto query = static_cast<uint32_t>(kPassQueryCount + 2 * queries.ranges.size());
+
+  queries.ranges.push_back(range);
+  queries.range_active = true;
+  vkCmdWriteTimestamp(cmd_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.pool.handle(), query);
+}
+
+void GpuTimer::EndRange(VkCommandBuffer cmd_buffer, const size_t frame) {
+  if (!enabled() || !frames_[frame].range_active) {
+    return;
+  }
+  FrameQueries& queries = frames_[frame];
+  queries.range_active = false;
+  const auto query = static_cast<uint32_t>(kPassQueryCount + 2 * queries.ranges.size() - 1);
+
+  vkCmdWriteTimestamp(cmd_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queries.pool.handle(), query);
+}
+
+void GpuTimer::End(VkCommandBuffer cmd_buffer, const size_t frame) {
+  if (!enabled()) {
+    return;
+  }
+  vkCmdWriteTimestamp(cmd_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames_[frame].pool.handle(), 1);
+}
+
+void GpuTimer::Collect(const size_t frame, engine::FrameStats* frame_stats) {
+  if (!enabled() || !frames_[frame].pending) {
+    return;
+  }
+  FrameQueries& queries = frames_[frame];
+
+  std::array<uint64_t, kQueryCount> timestamps = {};
+  const auto query_count = static_cast<uint32_t>(kPassQueryCount + 2 * queries.ranges.size());
+  const VkResult result = vkGetQueryPoolResults(device_,
+                                                queries.pool.handle(),
+                                                0,
+                                                query_count,
+                                                query_count * sizeof(uint64_t),
+                                                timestamps.data(),
+                                                sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT);
+  if (result == VK_NOT_READY) {
+    return;
+  }
+  if (result != VK_SUCCESS) {
+    throw Error("failed to get query pool results").WithCode(result);
+  }
+  queries.pending = false;
+  if (frame_stats == nullptr) {
+    return;
+  }
+  const auto to_ms = [this](const uint64_t begin, const uint64_t end) {
+    return static_cast<double>((end - begin) & valid_mask_) * period_ns_ / 1e6;
+  };
+  frame_stats->AddGpuTime(to_ms(timestamps[0], timestamps[1]));
+  frame_stats->AddDroppedGpuRanges(queries.dropped);
+  for (size_t i = 0; i < queries.ranges.size(); ++i) {
+    frame_stats->AddGpuRangeTime(queries.ranges[i], to_ms(timestamps[kPassQueryCount + 2 * i], timestamps[kPassQueryCount + 2 * i + 1]));
+  }
+}
+
+} // namespace vk
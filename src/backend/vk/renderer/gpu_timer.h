@@ -0,0 +1,53 @@
+#ifndef BACKEND_VK_RENDERER_GPU_TIMER_H_
+#define BACKEND_VK_RENDERER_GPU_TIMER_H_
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+#include "backend/vk/renderer/device.h"
+#include "backend/vk/renderer/handle.h"
+#include "engine/frame_stats.h"
+
+namespace vk {
+
+class GpuTimer final {
+public:
+  static constexpr size_t kMaxRanges = engine::FrameStats::kMaxGpuRanges;
+
+  GpuTimer() noexcept;
+  GpuTimer(const Device& device, size_t frame_count);
+
+  [[nodiscard]] bool enabled() const noexcept;
+
+  void Begin(VkCommandBuffer cmd_buffer, size_t frame);
+  void BeginRange(VkCommandBuffer cmd_buffer, size_t frame, size_t range);
+  void EndRange(VkCommandBuffer cmd_buffer, size_t frame);
+  void End(VkCommandBuffer cmd_buffer, size_t frame);
+
+  void Collect(size_t frame, engine::FrameStats* frame_stats);
+private:
+  struct FrameQueries {
+    DeviceHandle<VkQueryPool> pool;
+    std::vector<size_t> ranges;
+    // ranges past kMaxRanges, counted instead of timed
+    size_t dropped;
+    bool range_active;
+    bool pending;
+  };
+
+  VkDevice device_;
+  double period_ns_;
+  uint64_t valid_mask_;
+  std::vector<FrameQueries> frames_;
+};
+
+inline GpuTimer::GpuTimer() noexcept : device_(VK_NULL_HANDLE), period_ns_(0), valid_mask_(0) {}
+
+inline bool GpuTimer::enabled() const noexcept {
+  return !frames_.empty();
+}
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_GPU_TIMER_H_
@@ -3,6 +3,9 @@
 
 #include <vulkan/vulkan.h>
 
+#include <atomic>
+#include <vector>
+
 #include "backend/vk/renderer/handle.h"
 #include "backend/vk/renderer/memory.h"
 
@@ -56,6 +59,18 @@ private:
       mip_levels_(mip_levels) {}
 };
 
+// A sampled image whose levels from resident_level on hold data. Streamed images keep a view per level they can become
+// resident from, level 0 is always sampled through the image's own view.
+struct TextureImage {
+  Image image;
+  std::vector<DeviceHandle<VkImageView>> views;
+  std::atomic<uint32_t> resident_level;
+
+  [[nodiscard]] VkImageView view(const uint32_t level) const noexcept {
+    return level == 0 ? image.view() : views[level].handle();
+  }
+};
+
 } // namespace vk
 
 #endif // BACKEND_VK_RENDERER_IMAGE_H_
@@ -77,7 +77,7 @@ VkInstance CreateInstance(const std::vector<const char*>& extensions, const VkAl
   app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   app_info.pEngineName = "Simple Engine";
   app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  app_info.apiVersion = VK_API_VERSION_1_0;
+  app_info.apiVersion = VK_API_VERSION_1_1;
 #ifdef DEBUG
   const std::vector<const char*> layers = Instance::GetLayers();
   if (!InstanceLayersAreSupported(layers)) {
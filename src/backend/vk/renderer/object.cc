@@ -1,5 +1,7 @@
 #include "backend/vk/renderer/object.h"
 
+#include <array>
+
 namespace vk {
 
 std::vector<VkVertexInputBindingDescription> Vertex::GetBindingDescriptions() {
@@ -31,6 +33,25 @@ std::vector<VkVertexInputAttributeDescription> Vertex::GetAttributeDescriptions(
   return attribute_descriptions;
 }
 
+std::vector<VkVertexInputBindingDescription> Vertex::GetPositionBindingDescriptions() {
+  std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
+  binding_descriptions[0].binding = 0;
+  binding_descriptions[0].stride = sizeof(glm::vec3);
+  binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  return binding_descriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> Vertex::GetPositionAttributeDescriptions() {
+  std::vector<VkVertexInputAttributeDescription> attribute_descriptions(1);
+  attribute_descriptions[0].binding = 0;
+  attribute_descriptions[0].location = 0;
+  attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+  attribute_descriptions[0].offset = 0;
+
+  return attribute_descriptions;
+}
+
 void UniformDescriptorSet::Update() const noexcept {
   VkDescriptorBufferInfo buffer_info = {};
   buffer_info.buffer = buffer.handle();
@@ -49,22 +70,44 @@ void UniformDescriptorSet::Update() const noexcept {
   vkUpdateDescriptorSets(buffer.creator(), 1, &descriptor_write, 0, nullptr);
 }
 
-void SamplerDescriptorSet::Update() const noexcept {
+void CullDescriptorSet::Update(const Buffer& uniforms, const Buffer& meshlets) const noexcept {
+  const std::array<VkDescriptorBufferInfo, 4> buffer_infos = {{
+    {uniforms.handle(), 0, sizeof(Uniforms)},
+    {meshlets.handle(), 0, VK_WHOLE_SIZE},
+    {draws.handle(), 0, VK_WHOLE_SIZE},
+    {counts.handle(), 0, VK_WHOLE_SIZE}
+  }};
+  std::array<VkWriteDescriptorSet, 4> descriptor_writes = {};
+  for (uint32_t i = 0; i < descriptor_writes.size(); ++i) {
+    descriptor_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[i].dstSet = handle;
+    descriptor_writes[i].dstBinding = i;
+    descriptor_writes[i].dstArrayElement = 0;
+    descriptor_writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_writes[i].descriptorCount = 1;
+    descriptor_writes[i].pBufferInfo = &buffer_infos[i];
+  }
+  vkUpdateDescriptorSets(draws.creator(), static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
+}
+
+void SamplerDescriptorSet::Update(const size_t frame) noexcept {
+  levels[frame] = image->resident_level.load(std::memory_order_acquire);
+
   VkDescriptorImageInfo image_info = {};
   image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  image_info.imageView = image.view();
-  image_info.sampler = sampler.handle();
+  image_info.imageView = image->view(levels[frame]);
+  image_info.sampler = sampler->handle();
 
   VkWriteDescriptorSet descriptor_write = {};
   descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  descriptor_write.dstSet = handle;
+  descriptor_write.dstSet = handles[frame];
   descriptor_write.dstBinding = 0;
   descriptor_write.dstArrayElement = 0;
   descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   descriptor_write.descriptorCount = 1;
   descriptor_write.pImageInfo = &image_info;
 
-  vkUpdateDescriptorSets(image.creator(), 1, &descriptor_write, 0, nullptr);
+  vkUpdateDescriptorSets(image->image.creator(), 1, &descriptor_write, 0, nullptr);
 }
 
 } // namespace vk
@@ -3,11 +3,13 @@
 
 #include <vulkan/vulkan.h>
 
+#include <memory>
 #include <vector>
 
 #include "backend/vk/renderer/buffer.h"
 #include "backend/vk/renderer/handle.h"
 #include "backend/vk/renderer/image.h"
+#include "backend/vk/renderer/virtual_texture.h"
 #include "engine/render/types.h"
 #include "obj/types.h"
 
@@ -16,6 +18,9 @@ namespace vk {
 struct Vertex : engine::Vertex {
   static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
   static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+
+  static std::vector<VkVertexInputBindingDescription> GetPositionBindingDescriptions();
+  static std::vector<VkVertexInputAttributeDescription> GetPositionAttributeDescriptions();
 };
 
 using Index = engine::Index;
@@ -42,12 +47,27 @@ struct UniformDescriptorSet {
   void Update() const noexcept;
 };
 
+// Image and sampler are owned by the texture cache and shared with every other material using them. There is a handle per
+// frame in flight, so a streamed image gaining levels is rebound to a frame's set only once that frame has completed.
+// A virtual texture is set instead of image and sampler, its sets are written once and never updated.
 struct SamplerDescriptorSet {
-  DeviceHandle<VkSampler> sampler;
-  Image image;
+  std::shared_ptr<const DeviceHandle<VkSampler>> sampler;
+  std::shared_ptr<const TextureImage> image;
+  std::shared_ptr<VirtualTexture> virtual_texture;
+  std::vector<VkDescriptorSet> handles;
+  // resident level written into each handle
+  std::vector<uint32_t> levels;
+
+  void Update(size_t frame) noexcept;
+};
+
+// Per frame draw commands and per range draw counts written by the cull shader.
+struct CullDescriptorSet {
+  Buffer draws;
+  Buffer counts;
   VkDescriptorSet handle;
 
-  void Update() const noexcept;
+  void Update(const Buffer& uniforms, const Buffer& meshlets) const noexcept;
 };
 
 struct UniformDescriptor {
@@ -60,11 +80,39 @@ struct SamplerDescriptor {
   DeviceHandle<VkDescriptorSetLayout> layout;
 };
 
+struct CullDescriptor {
+  std::vector<CullDescriptorSet> sets;
+  DeviceHandle<VkDescriptorSetLayout> layout;
+};
+
+struct MeshletRange {
+  uint32_t first;
+  uint32_t count;
+};
+
+// A level of detail lives in the shared index buffer, range_ends holds the end of every usemtl range of the level.
+struct Lod {
+  uint32_t first_index;
+  std::vector<uint32_t> range_ends;
+  float error;
+};
+
 struct Object {
   Buffer indices;
   Buffer vertices;
+  // only loaded for the depth prepass
+  Buffer positions;
 
   std::vector<obj::UseMtl> usemtl;
+  std::vector<engine::BoundingSphere> bounds;
+  // lods[0] is the full mesh, the coarser levels follow it in the index buffer
+  std::vector<Lod> lods;
+
+  // only loaded for gpu culling, meshlet_ranges has one entry per usemtl range
+  Buffer meshlets;
+  uint32_t meshlet_count;
+  std::vector<MeshletRange> meshlet_ranges;
+  CullDescriptor cull_descriptor;
 
   UniformDescriptor uniform_descriptor;
   SamplerDescriptor sampler_descriptor;
@@ -1,7 +1,16 @@
 #include "backend/vk/renderer/object_loader.h"
 
+#include <algorithm>
 #include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -10,6 +19,11 @@
 #include "backend/vk/renderer/commander.h"
 #include "backend/vk/renderer/error.h"
 #include "obj/parser.h"
+#include "texture/cache.h"
+#include "texture/error.h"
+#include "texture/ktx2.h"
+#include "texture/tiled.h"
+#include "trace/trace.h"
 
 namespace vk {
 
@@ -18,9 +32,116 @@ namespace {
 constexpr int kStbiFormat = STBI_rgb_alpha;
 constexpr VkFormat kVkFormat = VK_FORMAT_R8G8B8A8_SRGB;
 constexpr VkExtent2D kDummyImageExtent = {16,16};
+// Streamed images upload the levels up to this size with the model, the larger ones follow.
+constexpr uint32_t kResidentTailSize = 128;
+// Part of the device local budget streamed images may fill, the rest is left to other resources and processes.
+constexpr double kMaxBudgetShare = 0.8;
+
+struct DecodedImage {
+  std::unique_ptr<stbi_uc, void(*)(void*)> pixels;
+  VkExtent2D extent;
+};
+
+DecodedImage DecodeImage(const std::string& path) {
+  TRACE_ZONE("stbi_load");
+  int image_width, image_height, image_channels;
+  std::unique_ptr<stbi_uc, void(*)(void*)> pixels(stbi_load(path.c_str(), &image_width, &image_height, &image_channels, kStbiFormat), stbi_image_free);
+  if (pixels == nullptr) {
+    return {std::move(pixels), kDummyImageExtent};
+  }
+  return {std::move(pixels), {static_cast<uint32_t>(image_width), static_cast<uint32_t>(image_height)}};
+}
+
+VkFormat ToVkFormat(const texture::Format format) noexcept {
+  switch (format) {
+    case texture::Format::kBc1:
+      return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    case texture::Format::kBc3:
+      return VK_FORMAT_BC3_SRGB_BLOCK;
+    case texture::Format::kBc7:
+      return VK_FORMAT_BC7_SRGB_BLOCK;
+    default:
+      return kVkFormat;
+  }
+}
 
-inline uint32_t CalculateMipMaps(const VkExtent2D extent) {
-    return static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+// Block formats the device can sample with linear filtering, best quality first.
+std::vector<texture::Format> GetTextureFormats(const PhysicalDevice& physical_device) {
+  std::vector<texture::Format> formats;
+  for (const texture::Format format : {texture::Format::kBc7, texture::Format::kBc3, texture::Format::kBc1}) {
+    if (physical_device.format_feature_supported(ToVkFormat(format), VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+      formats.push_back(format);
+    }
+  }
+  return formats;
+}
+
+// The levels of a texture read into the staging ring, or kept in its data when staging is empty.
+struct LoadedTexture {
+  texture::Texture texture;
+  StagingRing::Region staging;
+};
+
+// KTX2 materials are uploaded in their stored format, other images get their mips and encoding once and are cached next to the source.
+// Without block formats the cache holds the rgba8 mip chain. KTX2 levels, stored or cached, are read straight into the
+// staging ring when there is one. Empty when the image cannot be decoded.
+std::optional<LoadedTexture> LoadTexture(const std::string& path, const std::vector<texture::Format>& formats, StagingRing* staging_ring) {
+  TRACE_ZONE("LoadTexture");
+  LoadedTexture loaded = {};
+  texture::Destination destination;
+  if (staging_ring != nullptr) {
+    destination = [&loaded, staging_ring](const size_t size) {
+      loaded.staging = staging_ring->Allocate(size);
+      return loaded.staging.data();
+    };
+  }
+  if (std::filesystem::path(path).extension() == ".ktx2") {
+    loaded.texture = texture::ReadKtx2(path, destination);
+    if (std::find(formats.begin(), formats.end(), loaded.texture.format) == formats.end() && loaded.texture.format != texture::Format::kRgba8) {
+      throw Error("texture format of " + path + " is not supported by the device");
+    }
+    return loaded;
+  }
+  if (std::optional<texture::Texture> cached = texture::LoadCached(path, formats.empty() ? std::vector{texture::Format::kRgba8} : formats, destination)) {
+    loaded.texture = std::move(*cached);
+    return loaded;
+  }
+  const auto [pixels, extent] = DecodeImage(path);
+  if (pixels == nullptr) {
+    return std::nullopt;
+  }
+  const texture::Format format = texture::ChooseFormat(formats, texture::HasAlpha(pixels.get(), extent.width, extent.height));
+  loaded.texture = texture::Compress(texture::BuildMips(pixels.get(), extent.width, extent.height), format);
+  texture::StoreCached(path, loaded.texture);
+  return loaded;
+}
+
+// Tile files are cut once from the decoded source and reused while it is unchanged. Empty when the image cannot be
+// decoded or the tiles cannot be written.
+std::optional<texture::TiledFile> LoadTiled(const std::string& path) {
+  TRACE_ZONE("LoadTiled");
+  if (std::optional<texture::TiledFile> tiled = texture::OpenTiled(path)) {
+    return tiled;
+  }
+  const auto [pixels, extent] = DecodeImage(path);
+  if (pixels == nullptr) {
+    return std::nullopt;
+  }
+  try {
+    texture::WriteTiled(texture::TiledPath(path), pixels.get(), extent.width, extent.height);
+    return texture::TiledFile(texture::TiledPath(path));
+  } catch (const texture::Error& error) {
+    std::clog << "failed to cut tiles of " << path << ": " << error.what() << std::endl;
+  }
+  return std::nullopt;
+}
+
+uint32_t GetTailLevel(const texture::Texture& texture) noexcept {
+  uint32_t level = 0;
+  while (level + 1 < texture.levels.size() && std::max(texture.levels[level].width, texture.levels[level].height) > kResidentTailSize) {
+    ++level;
+  }
+  return level;
 }
 
 } // namespace
@@ -29,49 +150,240 @@ void ObjectLoader::Init() noexcept {
   stbi_set_flip_vertically_on_load(true);
 }
 
-ObjectLoader::ObjectLoader(const Device& device, VkCommandPool cmd_pool) noexcept
+ObjectLoader::ObjectLoader(const Device& device, VkCommandPool cmd_pool, TextureCache& texture_cache, StagingRing& staging_ring, TextureStreamer* texture_streamer, TileCache* tile_cache) noexcept
   : device_(device),
-    cmd_pool_(cmd_pool) {}
-
-Object ObjectLoader::Load(const std::string& path, const size_t frame_count) const {
-  obj::Data data = obj::ParseFromFile(path);
-
-  auto[transfer_vertices, transfer_indices] = CreateTransferBuffers(data);
+    cmd_pool_(cmd_pool),
+    texture_cache_(texture_cache),
+    staging_ring_(staging_ring),
+    texture_streamer_(texture_streamer),
+    tile_cache_(tile_cache) {}
 
+Object ObjectLoader::Load(const std::string& path, const size_t frame_count, const Options& options) const {
   Object object = {};
-  object.vertices = CreateStagingBuffer(transfer_vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-  object.indices = CreateStagingBuffer(transfer_indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+  obj::Data data;
+  std::vector<mesh::Meshlet> meshlets;
+  std::vector<Lod> lods;
+  if (options.chunk_budget != 0) {
+    data = StreamGeometry(path, options, object);
+  } else {
+    data = obj::ParseFromFile(path);
+
+    TransferBuffers transfer_buffers = CreateTransferBuffers(data, options);
+
+    object.vertices = CreateStagingBuffer(transfer_buffers.vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    object.indices = CreateStagingBuffer(transfer_buffers.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    if (options.positions) {
+      object.positions = CreateStagingBuffer(transfer_buffers.positions, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    }
+    object.bounds = engine::data_util::ComputeBounds(data);
+    meshlets = std::move(transfer_buffers.meshlets);
+    lods = std::move(transfer_buffers.lods);
+  }
   object.usemtl = std::move(data.usemtl);
 
-  std::vector<Image> images = CreateStagingImages(data);
+  Lod full_lod = {};
+  for (const obj::UseMtl& usemtl : object.usemtl) {
+    full_lod.range_ends.push_back(usemtl.offset);
+  }
+  object.lods.push_back(std::move(full_lod));
+  std::move(lods.begin(), lods.end(), std::back_inserter(object.lods));
+
+  const bool cull = !meshlets.empty();
+  const size_t cull_set_count = cull ? frame_count : 0;
+
+  if (tile_cache_ != nullptr) {
+    std::vector<std::shared_ptr<VirtualTexture>> textures = CreateVirtualTextures(data);
+    // every virtual texture set holds the page table, the tile cache, its params and its feedback
+    const size_t virtual_set_count = textures.size() * frame_count;
+    object.descriptor_pool = device_.CreateDescriptorPool(frame_count + cull_set_count + virtual_set_count, 2 * virtual_set_count, 3 * cull_set_count + virtual_set_count);
+    object.uniform_descriptor = CreateUniformDescriptor(object.descriptor_pool.handle(), frame_count);
+    object.sampler_descriptor = CreateVirtualTextureDescriptor(object.descriptor_pool.handle(), std::move(textures), frame_count);
+  } else {
+    std::vector<std::shared_ptr<const TextureImage>> images = CreateStagingImages(data, options.compress_textures);
+    object.descriptor_pool = device_.CreateDescriptorPool(frame_count + cull_set_count, images.size() * frame_count, 3 * cull_set_count);
+    object.uniform_descriptor = CreateUniformDescriptor(object.descriptor_pool.handle(), frame_count);
+    object.sampler_descriptor = CreateSamplerDescriptor(object.descriptor_pool.handle(), std::move(images), frame_count);
+  }
 
-  object.descriptor_pool = device_.CreateDescriptorPool(frame_count, images.size());
-  object.uniform_descriptor = CreateUniformDescriptor(object.descriptor_pool.handle(), frame_count);
-  object.sampler_descriptor = CreateSamplerDescriptor(object.descriptor_pool.handle(), std::move(images));
+  if (cull) {
+    object.meshlets = CreateMeshletBuffer(meshlets);
+    object.meshlet_count = static_cast<uint32_t>(meshlets.size());
+    object.meshlet_ranges.resize(object.usemtl.size());
+    for (const mesh::Meshlet& meshlet : meshlets) {
+      object.meshlet_ranges[meshlet.range].first = meshlet.draw_offset;
+      ++object.meshlet_ranges[meshlet.range].count;
+    }
+    object.cull_descriptor = CreateCullDescriptor(object.descriptor_pool.handle(), object);
+  }
 
   return object;
 }
 
-std::pair<Buffer, Buffer> ObjectLoader::CreateTransferBuffers(const obj::Data& data) const {
+ObjectLoader::TransferBuffers ObjectLoader::CreateTransferBuffers(const obj::Data& data, const Options& options) const {
   Buffer transfer_vertices = device_.CreateBuffer(
     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
     sizeof(Vertex) * data.indices.size()
   );
-  Buffer transfer_indices = device_.CreateBuffer(
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    sizeof(Index) * data.indices.size()
-  );
+  Buffer transfer_positions;
+  glm::vec3* mapped_positions = nullptr;
+  if (options.positions) {
+    transfer_positions = device_.CreateBuffer(
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      sizeof(glm::vec3) * data.indices.size()
+    );
+    mapped_positions = static_cast<glm::vec3*>(transfer_positions.memory().Map());
+  }
   const auto mapped_vertices = static_cast<Vertex*>(transfer_vertices.memory().Map());
-  const auto mapped_indices = static_cast<Index*>(transfer_indices.memory().Map());
-
-  engine::data_util::RemoveDuplicates(data, mapped_vertices, mapped_indices);
 
+  Buffer transfer_indices;
+  std::vector<mesh::Meshlet> meshlets;
+  std::vector<Lod> lods;
+  if (options.meshlets || options.lod_count > 1) {
+    // clustering reorders and simplification appends indices, which is done in host memory instead of reading back the mapped buffers
+    std::vector<Vertex> vertices(data.indices.size());
+    std::vector<Index> indices(data.indices.size());
+    const size_t vertex_count = engine::data_util::RemoveDuplicates(data, vertices.data(), indices.data(), mapped_positions);
+
+    if (options.meshlets) {
+      meshlets = mesh::BuildMeshlets(&vertices.data()->pos, sizeof(Vertex), indices.data(), data.usemtl);
+    }
+    for (mesh::Lod& lod : mesh::BuildLods(&vertices.data()->pos, sizeof(Vertex), vertex_count, indices.data(), data.usemtl, options.lod_count)) {
+      const auto first_index = static_cast<uint32_t>(indices.size());
+      for (uint32_t& range_end : lod.range_ends) {
+        range_end += first_index;
+      }
+      indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+      lods.push_back({first_index, std::move(lod.range_ends), lod.error});
+    }
+    transfer_indices = device_.CreateBuffer(
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      sizeof(Index) * indices.size()
+    );
+    std::memcpy(mapped_vertices, vertices.data(), vertex_count * sizeof(Vertex));
+    std::memcpy(transfer_indices.memory().Map(), indices.data(), indices.size() * sizeof(Index));
+  } else {
+    transfer_indices = device_.CreateBuffer(
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      sizeof(Index) * data.indices.size()
+    );
+    const auto mapped_indices = static_cast<Index*>(transfer_indices.memory().Map());
+    engine::data_util::RemoveDuplicates(data, mapped_vertices, mapped_indices, mapped_positions);
+  }
   transfer_vertices.memory().Unmap();
   transfer_indices.memory().Unmap();
+  if (options.positions) {
+    transfer_positions.memory().Unmap();
+  }
+  return {std::move(transfer_vertices), std::move(transfer_indices), std::move(transfer_positions), std::move(meshlets), std::move(lods)};
+}
+
+obj::Data ObjectLoader::StreamGeometry(const std::string& path, const Options& options, Object& object) const {
+  TRACE_ZONE("vk::ObjectLoader::StreamGeometry");
+  static_assert(sizeof(obj::Vertex) == sizeof(Vertex), "chunk vertices are copied as they are");
+
+  struct ChunkBounds {
+    size_t first_index;
+    glm::vec3 min;
+    glm::vec3 max;
+  };
+
+  // Device local buffer the chunks are appended to, reallocated twice as large when one does not fit.
+  struct Destination {
+    Buffer buffer;
+    VkDeviceSize size;
+    VkDeviceSize capacity;
+    VkBufferUsageFlags usage;
+  };
+
+  const auto append = [this](Destination& dst, const StagingRing::Region& src, const VkDeviceSize src_offset, const VkDeviceSize size, const TransferCommander& commander, std::vector<Buffer>& retired) {
+    if (dst.size + size > dst.capacity) {
+      const VkDeviceSize capacity = std::max(2 * dst.capacity, dst.size + size);
+      Buffer grown = device_.CreateBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | dst.usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, capacity);
+      if (dst.size != 0) {
+        commander.CopyBuffer(dst.buffer, 0, grown, 0, dst.size);
+      }
+      retired.push_back(std::exchange(dst.buffer, std::move(grown)));
+      dst.capacity = capacity;
+    }
+    commander.CopyBuffer(src.buffer(), src.offset() + src_offset, dst.buffer, dst.size, size);
+    dst.size += size;
+  };
 
-  return {std::move(transfer_vertices), std::move(transfer_indices)};
+  std::vector<ChunkBounds> chunk_bounds;
+  Destination vertices = {Buffer(), 0, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT};
+  Destination indices = {Buffer(), 0, 0, VK_BUFFER_USAGE_INDEX_BUFFER_BIT};
+  Destination positions = {Buffer(), 0, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT};
+  // every chunk is staged in the ring and copied before the next one is parsed, so it is the only one in host memory
+  obj::Data data = obj::StreamFromFile(path, options.chunk_budget, [&](const obj::Chunk& chunk) {
+    const VkDeviceSize vertices_size = sizeof(Vertex) * chunk.vertex_count;
+    const VkDeviceSize indices_size = sizeof(Index) * chunk.index_count;
+    const VkDeviceSize positions_size = options.positions ? sizeof(glm::vec3) * chunk.vertex_count : 0;
+    const StagingRing::Region staging = staging_ring_.Allocate(vertices_size + indices_size + positions_size);
+
+    std::memcpy(staging.data(), chunk.vertices, vertices_size);
+    std::memcpy(staging.data() + vertices_size, chunk.indices, indices_size);
+    const auto staged_positions = reinterpret_cast<glm::vec3*>(staging.data() + vertices_size + indices_size);
+    ChunkBounds bounds = {chunk.first_index, glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+    for (size_t i = 0; i < chunk.vertex_count; ++i) {
+      const glm::vec3 pos(chunk.vertices[i].pos[0], chunk.vertices[i].pos[1], chunk.vertices[i].pos[2]);
+      if (options.positions) {
+        staged_positions[i] = pos;
+      }
+      bounds.min = glm::min(bounds.min, pos);
+      bounds.max = glm::max(bounds.max, pos);
+    }
+    chunk_bounds.push_back(bounds);
+
+    std::vector<Buffer> retired;
+    TransferCommander commander(device_.handle(), cmd_pool_, device_.graphics_queue().handle, device_.queue_mutex());
+    CommanderGuard commander_guard(commander);
+
+    append(vertices, staging, 0, vertices_size, commander, retired);
+    append(indices, staging, vertices_size, indices_size, commander, retired);
+    if (options.positions) {
+      append(positions, staging, vertices_size + indices_size, positions_size, commander, retired);
+    }
+  });
+
+  // the doubling leaves up to half of every buffer unused, which is not kept with the object
+  {
+    std::vector<Buffer> retired;
+    TransferCommander commander(device_.handle(), cmd_pool_, device_.graphics_queue().handle, device_.queue_mutex());
+    CommanderGuard commander_guard(commander);
+    for (Destination* dst : {&vertices, &indices, &positions}) {
+      if (dst->size != 0 && dst->size != dst->capacity) {
+        Buffer fitted = device_.CreateBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT | dst->usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, dst->size);
+        commander.CopyBuffer(dst->buffer, 0, fitted, 0, dst->size);
+        retired.push_back(std::exchange(dst->buffer, std::move(fitted)));
+      }
+    }
+  }
+  object.vertices = std::move(vertices.buffer);
+  object.indices = std::move(indices.buffer);
+  if (options.positions) {
+    object.positions = std::move(positions.buffer);
+  }
+
+  // chunks never span two ranges, the sphere around the boxes of a range's chunks bounds it a little loosely
+  object.bounds.reserve(data.usemtl.size());
+  size_t chunk = 0;
+  for (const obj::UseMtl& usemtl : data.usemtl) {
+    glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+    for (; chunk < chunk_bounds.size() && chunk_bounds[chunk].first_index < usemtl.offset; ++chunk) {
+      min = glm::min(min, chunk_bounds[chunk].min);
+      max = glm::max(max, chunk_bounds[chunk].max);
+    }
+    if (min.x > max.x) {
+      object.bounds.push_back({glm::vec3(0.0f), 0.0f});
+      continue;
+    }
+    object.bounds.push_back({(min + max) * 0.5f, glm::length(max - min) * 0.5f});
+  }
+  return data;
 }
 
 inline Buffer ObjectLoader::CreateStagingBuffer(const Buffer& transfer_buffer, const VkBufferUsageFlags usage) const {
@@ -81,7 +393,7 @@ inline Buffer ObjectLoader::CreateStagingBuffer(const Buffer& transfer_buffer, c
     transfer_buffer.size()
   );
 
-  BufferCommander commander(buffer, cmd_pool_, device_.graphics_queue().handle);
+  BufferCommander commander(buffer, cmd_pool_, device_.graphics_queue().handle, device_.queue_mutex());
   CommanderGuard commander_guard(commander);
 
   commander.CopyBuffer(transfer_buffer);
@@ -89,72 +401,167 @@ inline Buffer ObjectLoader::CreateStagingBuffer(const Buffer& transfer_buffer, c
   return buffer;
 }
 
-Image ObjectLoader::CreateStagingImageFromPixels(const unsigned char* pixels, const VkExtent2D extent, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties) const {
-  const VkDeviceSize image_size = extent.width * extent.height * kStbiFormat;
-
+Buffer ObjectLoader::CreateMeshletBuffer(const std::vector<mesh::Meshlet>& meshlets) const {
   const Buffer transfer_buffer = device_.CreateBuffer(
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      image_size
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    sizeof(mesh::Meshlet) * meshlets.size()
   );
-  void* mapped_buffer = transfer_buffer.memory().Map();
-  std::memcpy(mapped_buffer, pixels, image_size);
+  std::memcpy(transfer_buffer.memory().Map(), meshlets.data(), sizeof(mesh::Meshlet) * meshlets.size());
   transfer_buffer.memory().Unmap();
 
-  Image image = device_.CreateImage(
+  return CreateStagingBuffer(transfer_buffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+}
+
+std::shared_ptr<TextureImage> ObjectLoader::CreateTextureImage(const texture::Texture& texture, const StagingRing::Region& staging, const uint32_t first_level, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties) const {
+  // levels still in memory are staged from first_level on, those read into the ring are copied from where they landed
+  const size_t skipped_size = staging ? 0 : texture.levels[first_level].offset;
+  StagingRing::Region copied;
+  if (!staging) {
+    copied = staging_ring_.Allocate(texture.data.size() - skipped_size);
+    std::memcpy(copied.data(), texture.data.data() + skipped_size, texture.data.size() - skipped_size);
+  }
+  const StagingRing::Region& source = staging ? staging : copied;
+
+  const auto level_count = static_cast<uint32_t>(texture.levels.size());
+  auto image = std::make_shared<TextureImage>();
+  image->image = device_.CreateImage(
     usage,
     properties,
     VK_IMAGE_ASPECT_COLOR_BIT,
-    extent,
-    kVkFormat,
+    {texture.width, texture.height},
+    ToVkFormat(texture.format),
     VK_IMAGE_TILING_OPTIMAL,
-    CalculateMipMaps(extent)
+    level_count
   );
-  ImageCommander commander(image, cmd_pool_, device_.graphics_queue().handle);
+  for (uint32_t level = 0; level <= first_level; ++level) {
+    image->views.emplace_back(level == 0 ? DeviceHandle<VkImageView>() : device_.CreateImageView(image->image.handle(), VK_IMAGE_ASPECT_COLOR_BIT, image->image.format(), level_count - level, level));
+  }
+  image->resident_level = first_level;
+
+  std::vector<VkBufferImageCopy> regions(level_count - first_level);
+  for (uint32_t i = 0; i < regions.size(); ++i) {
+    const texture::Level& level = texture.levels[first_level + i];
+    regions[i].bufferOffset = source.offset() + level.offset - skipped_size;
+    regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    regions[i].imageSubresource.mipLevel = first_level + i;
+    regions[i].imageSubresource.baseArrayLayer = 0;
+    regions[i].imageSubresource.layerCount = 1;
+    regions[i].imageExtent = {level.width, level.height, 1};
+  }
+  ImageCommander commander(image->image, cmd_pool_, device_.graphics_queue().handle, device_.queue_mutex());
   CommanderGuard commander_guard(commander);
 
-  commander.TransitImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  commander.CopyBuffer(transfer_buffer);
-  commander.GenerateMipmaps();
+  commander.TransitImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, first_level);
+  commander.CopyBufferRegions(source.buffer(), regions);
+  commander.TransitImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, first_level);
 
   return image;
 }
 
-Image ObjectLoader::CreateStagingImage(const std::string& path,
-                                       const VkBufferUsageFlags usage,
-                                       const VkMemoryPropertyFlags properties) const {
-  int image_width, image_height, image_channels;
-  const std::unique_ptr<stbi_uc, void(*)(void*)> pixels(stbi_load(path.c_str(), &image_width, &image_height, &image_channels, kStbiFormat), stbi_image_free);
-  if (pixels == nullptr) {
-    constexpr size_t dummy_size = kDummyImageExtent.width * kDummyImageExtent.height;
-    const std::vector<unsigned char> dummy_colors(dummy_size, 0xff);
-    return CreateStagingImageFromPixels(dummy_colors.data(), kDummyImageExtent, usage, properties);
+std::shared_ptr<const TextureImage> ObjectLoader::GetFallbackImage(const VkImageUsageFlags usage, const VkMemoryPropertyFlags properties) const {
+  if (std::shared_ptr<const TextureImage> fallback = texture_cache_.Find({})) {
+    return fallback;
   }
-  const VkExtent2D image_extent = { static_cast<uint32_t>(image_width), static_cast<uint32_t>(image_height) };
-
-  return CreateStagingImageFromPixels(pixels.get(), image_extent, usage, properties);
+  const std::vector<unsigned char> dummy_colors(kDummyImageExtent.width * kDummyImageExtent.height * kStbiFormat, 0xff);
+  const texture::Texture dummy = texture::BuildMips(dummy_colors.data(), kDummyImageExtent.width, kDummyImageExtent.height);
+  return texture_cache_.Insert({}, CreateTextureImage(dummy, {}, 0, usage, properties));
 }
 
-std::vector<Image> ObjectLoader::CreateStagingImages(const obj::Data& data) const {
-  if (!device_.physical_device().format_feature_supported(kVkFormat, VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-    throw Error("image format does not support linear blitting");
-  }
-  constexpr VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-                                      VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                                      VK_IMAGE_USAGE_SAMPLED_BIT;
+std::vector<std::shared_ptr<const TextureImage>> ObjectLoader::CreateStagingImages(const obj::Data& data, const bool compress_textures) const {
+  constexpr VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
   constexpr VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
-  std::vector<Image> images;
+  const std::vector<texture::Format> formats = compress_textures ? GetTextureFormats(device_.physical_device()) : std::vector<texture::Format>();
+
+  // materials often share an atlas, every distinct file is hashed, loaded and uploaded once
+  std::unordered_map<std::string, std::future<std::string>> keys;
+  for(const obj::NewMtl& mtl : data.mtl) {
+    if (keys.find(mtl.map_kd) == keys.end()) {
+      keys.emplace(mtl.map_kd, std::async(std::launch::async, TextureCache::GetKey, mtl.map_kd));
+    }
+  }
+  std::unordered_map<std::string, std::string> path_keys;
+  std::unordered_map<std::string, std::shared_ptr<const TextureImage>> key_images;
+  std::unordered_map<std::string, std::future<std::optional<LoadedTexture>>> textures;
+  // streamed textures keep their levels in memory for the streamer
+  StagingRing* staging_ring = texture_streamer_ == nullptr ? &staging_ring_ : nullptr;
+  for (auto& [path, key_future] : keys) {
+    std::string key = key_future.get();
+    if (key.empty() || key_images.find(key) != key_images.end() || textures.find(key) != textures.end()) {
+      path_keys.emplace(path, std::move(key));
+      continue;
+    }
+    if (std::shared_ptr<const TextureImage> image = texture_cache_.Find(key)) {
+      key_images.emplace(key, std::move(image));
+    } else {
+      textures.emplace(key, std::async(std::launch::async, LoadTexture, path, formats, staging_ring));
+    }
+    path_keys.emplace(path, std::move(key));
+  }
+  for (auto& [key, texture] : textures) {
+    std::optional<LoadedTexture> loaded = texture.get();
+    if (!loaded) {
+      continue;
+    }
+    if (texture_streamer_ == nullptr) {
+      key_images.emplace(key, texture_cache_.Insert(key, CreateTextureImage(loaded->texture, loaded->staging, 0, usage, properties)));
+      continue;
+    }
+    // the tail is uploaded now, the levels above it are streamed when the device local heaps have room for them
+    const uint32_t tail_level = GetTailLevel(loaded->texture);
+    const std::optional<MemoryBudget> budget = device_.memory_budget();
+    if (budget && static_cast<double>(budget->usage + loaded->texture.data.size()) > static_cast<double>(budget->budget) * kMaxBudgetShare) {
+      loaded->texture = texture::DropLevels(loaded->texture, tail_level);
+      key_images.emplace(key, texture_cache_.Insert(key, CreateTextureImage(loaded->texture, {}, 0, usage, properties)));
+      continue;
+    }
+    const std::shared_ptr<TextureImage> image = CreateTextureImage(loaded->texture, {}, tail_level, usage, properties);
+    const std::shared_ptr<const TextureImage> cached = texture_cache_.Insert(key, image);
+    if (cached == image && tail_level != 0) {
+      texture_streamer_->Push(image, std::move(loaded->texture));
+    }
+    key_images.emplace(key, cached);
+  }
+  std::vector<std::shared_ptr<const TextureImage>> images;
   images.reserve(data.mtl.size());
 
   for(const obj::NewMtl& mtl : data.mtl) {
-    const std::string& path = mtl.map_kd;
-    Image image = CreateStagingImage(path, usage, properties);
-    images.emplace_back(std::move(image));
+    const auto it = key_images.find(path_keys.at(mtl.map_kd));
+    images.emplace_back(it != key_images.end() ? it->second : GetFallbackImage(usage, properties));
   }
   return images;
 }
 
+std::vector<std::shared_ptr<VirtualTexture>> ObjectLoader::CreateVirtualTextures(const obj::Data& data) const {
+  // tiles are cut on worker threads, the page tables are uploaded from the calling thread with its command pool
+  std::unordered_map<std::string, std::future<std::optional<texture::TiledFile>>> files;
+  std::unordered_map<std::string, std::shared_ptr<VirtualTexture>> textures;
+  for (const obj::NewMtl& mtl : data.mtl) {
+    if (mtl.map_kd.empty() || files.find(mtl.map_kd) != files.end() || textures.find(mtl.map_kd) != textures.end()) {
+      continue;
+    }
+    if (std::shared_ptr<VirtualTexture> texture = tile_cache_->Find(mtl.map_kd)) {
+      textures.emplace(mtl.map_kd, std::move(texture));
+    } else {
+      files.emplace(mtl.map_kd, std::async(std::launch::async, LoadTiled, mtl.map_kd));
+    }
+  }
+  for (auto& [path, file] : files) {
+    if (std::optional<texture::TiledFile> loaded = file.get()) {
+      textures.emplace(path, tile_cache_->Create(path, std::move(loaded), cmd_pool_));
+    }
+  }
+  std::vector<std::shared_ptr<VirtualTexture>> object_textures;
+  object_textures.reserve(data.mtl.size());
+
+  for (const obj::NewMtl& mtl : data.mtl) {
+    const auto it = textures.find(mtl.map_kd);
+    object_textures.emplace_back(it != textures.end() ? it->second : tile_cache_->Create({}, std::nullopt, cmd_pool_));
+  }
+  return object_textures;
+}
+
 UniformDescriptor ObjectLoader::CreateUniformDescriptor(VkDescriptorPool descriptor_pool, const size_t frame_count) const {
   DeviceHandle<VkDescriptorSetLayout> descriptor_set_layout = device_.CreateUniformDescriptorSetLayout();
   const std::vector<VkDescriptorSet> descriptor_sets = device_.CreateDescriptorSets(descriptor_set_layout.handle(), descriptor_pool, frame_count);
@@ -181,20 +588,44 @@ UniformDescriptor ObjectLoader::CreateUniformDescriptor(VkDescriptorPool descrip
   };
 }
 
-SamplerDescriptor ObjectLoader::CreateSamplerDescriptor(VkDescriptorPool descriptor_pool, std::vector<Image>&& images) const {
+SamplerDescriptor ObjectLoader::CreateSamplerDescriptor(VkDescriptorPool descriptor_pool, std::vector<std::shared_ptr<const TextureImage>>&& images, const size_t frame_count) const {
   DeviceHandle<VkDescriptorSetLayout> descriptor_set_layout =  device_.CreateSamplerDescriptorSetLayout();
-  const std::vector<VkDescriptorSet> descriptor_sets = device_.CreateDescriptorSets(descriptor_set_layout.handle(), descriptor_pool, images.size());
+  const std::vector<VkDescriptorSet> descriptor_sets = device_.CreateDescriptorSets(descriptor_set_layout.handle(), descriptor_pool, images.size() * frame_count);
   std::vector<SamplerDescriptorSet> sampler_descriptor_sets;
   sampler_descriptor_sets.reserve(images.size());
 
   for(size_t i = 0; i < images.size(); ++i) {
     SamplerDescriptorSet sampler_descriptor_set = {};
 
-    sampler_descriptor_set.sampler = device_.CreateSampler(VK_SAMPLER_MIPMAP_MODE_LINEAR, images[i].mip_levels());
+    sampler_descriptor_set.sampler = texture_cache_.sampler();
     sampler_descriptor_set.image = std::move(images[i]);
-    sampler_descriptor_set.handle = descriptor_sets[i];
-    sampler_descriptor_set.Update();
+    sampler_descriptor_set.handles.assign(descriptor_sets.begin() + i * frame_count, descriptor_sets.begin() + (i + 1) * frame_count);
+    sampler_descriptor_set.levels.resize(frame_count);
+    for (size_t frame = 0; frame < frame_count; ++frame) {
+      sampler_descriptor_set.Update(frame);
+    }
+    sampler_descriptor_sets.emplace_back(std::move(sampler_descriptor_set));
+  }
+  return {
+    std::move(sampler_descriptor_sets),
+    std::move(descriptor_set_layout),
+  };
+}
+
+SamplerDescriptor ObjectLoader::CreateVirtualTextureDescriptor(VkDescriptorPool descriptor_pool, std::vector<std::shared_ptr<VirtualTexture>>&& textures, const size_t frame_count) const {
+  DeviceHandle<VkDescriptorSetLayout> descriptor_set_layout = device_.CreateVirtualTextureDescriptorSetLayout();
+  const std::vector<VkDescriptorSet> descriptor_sets = device_.CreateDescriptorSets(descriptor_set_layout.handle(), descriptor_pool, textures.size() * frame_count);
+  std::vector<SamplerDescriptorSet> sampler_descriptor_sets;
+  sampler_descriptor_sets.reserve(textures.size());
 
+  for (size_t i = 0; i < textures.size(); ++i) {
+    SamplerDescriptorSet sampler_descriptor_set = {};
+
+    sampler_descriptor_set.virtual_texture = std::move(textures[i]);
+    sampler_descriptor_set.handles.assign(descriptor_sets.begin() + i * frame_count, descriptor_sets.begin() + (i + 1) * frame_count);
+    for (size_t frame = 0; frame < frame_count; ++frame) {
+      tile_cache_->WriteDescriptorSet(*sampler_descriptor_set.virtual_texture, sampler_descriptor_set.handles[frame], frame);
+    }
     sampler_descriptor_sets.emplace_back(std::move(sampler_descriptor_set));
   }
   return {
@@ -203,4 +634,35 @@ SamplerDescriptor ObjectLoader::CreateSamplerDescriptor(VkDescriptorPool descrip
   };
 }
 
+CullDescriptor ObjectLoader::CreateCullDescriptor(VkDescriptorPool descriptor_pool, const Object& object) const {
+  DeviceHandle<VkDescriptorSetLayout> descriptor_set_layout = device_.CreateCullDescriptorSetLayout();
+  const std::vector<UniformDescriptorSet>& uniform_sets = object.uniform_descriptor.sets;
+  const std::vector<VkDescriptorSet> descriptor_sets = device_.CreateDescriptorSets(descriptor_set_layout.handle(), descriptor_pool, uniform_sets.size());
+
+  std::vector<CullDescriptorSet> cull_descriptor_sets;
+  cull_descriptor_sets.reserve(descriptor_sets.size());
+
+  for(size_t i = 0; i < descriptor_sets.size(); ++i) {
+    CullDescriptorSet cull_descriptor_set = {};
+    cull_descriptor_set.draws = device_.CreateBuffer(
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      sizeof(VkDrawIndexedIndirectCommand) * object.meshlet_count
+    );
+    cull_descriptor_set.counts = device_.CreateBuffer(
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      sizeof(uint32_t) * object.meshlet_ranges.size()
+    );
+    cull_descriptor_set.handle = descriptor_sets[i];
+    cull_descriptor_set.Update(uniform_sets[i].buffer, object.meshlets);
+
+    cull_descriptor_sets.emplace_back(std::move(cull_descriptor_set));
+  }
+  return {
+    std::move(cull_descriptor_sets),
+    std::move(descriptor_set_layout),
+  };
+}
+
 } // namespace vk
\ No newline at end of file
@@ -1,33 +1,75 @@
 #ifndef BACKEND_VK_RENDERER_OBJECT_LOADER_H_
 #define BACKEND_VK_RENDERER_OBJECT_LOADER_H_
 
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include "backend/vk/renderer/device.h"
 #include "backend/vk/renderer/object.h"
+#include "backend/vk/renderer/staging_ring.h"
+#include "backend/vk/renderer/texture_cache.h"
+#include "backend/vk/renderer/texture_streamer.h"
+#include "backend/vk/renderer/tile_cache.h"
+#include "mesh/meshlet.h"
+#include "mesh/simplify.h"
+#include "texture/texture.h"
 
 namespace vk {
 
 class ObjectLoader {
 public:
+  struct Options {
+    // packed position stream for the depth prepass
+    bool positions;
+    // meshlets and indirect draw buffers for gpu culling
+    bool meshlets;
+    // detail levels counting the full mesh, the culled path only draws the full one
+    size_t lod_count;
+    // block compressed textures, falls back to rgba8 without device support, mips are precomputed either way
+    bool compress_textures;
+    // parses the geometry in chunks of about this many bytes written straight to upload buffers, 0 parses it whole,
+    // only without meshlets and lods
+    size_t chunk_budget;
+  };
+
   static void Init() noexcept;
 
-  ObjectLoader(const Device& device, VkCommandPool cmd_pool) noexcept;
+  // Without a streamer every texture is uploaded whole. With a tile cache materials are sampled as virtual textures instead.
+  ObjectLoader(const Device& device, VkCommandPool cmd_pool, TextureCache& texture_cache, StagingRing& staging_ring, TextureStreamer* texture_streamer = nullptr, TileCache* tile_cache = nullptr) noexcept;
   ~ObjectLoader() = default;
 
-  [[nodiscard]] Object Load(const std::string& path, size_t frame_count) const;
+  [[nodiscard]] Object Load(const std::string& path, size_t frame_count, const Options& options = {}) const;
 private:
-  [[nodiscard]] std::pair<Buffer, Buffer> CreateTransferBuffers(const obj::Data& data) const;
+  struct TransferBuffers {
+    Buffer vertices;
+    Buffer indices;
+    Buffer positions;
+    std::vector<mesh::Meshlet> meshlets;
+    std::vector<Lod> lods;
+  };
+
+  [[nodiscard]] TransferBuffers CreateTransferBuffers(const obj::Data& data, const Options& options) const;
+  // Loads the vertices, indices, positions and bounds of object chunk by chunk, the returned data has its materials.
+  [[nodiscard]] obj::Data StreamGeometry(const std::string& path, const Options& options, Object& object) const;
+  [[nodiscard]] Buffer CreateMeshletBuffer(const std::vector<mesh::Meshlet>& meshlets) const;
   [[nodiscard]] Buffer CreateStagingBuffer(const Buffer& transfer_buffer, VkBufferUsageFlags usage) const;
-  [[nodiscard]] Image CreateStagingImageFromPixels(const unsigned char* pixels, VkExtent2D extent, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) const;
-  [[nodiscard]] Image CreateStagingImage(const std::string& path, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) const;
-  [[nodiscard]] std::vector<Image> CreateStagingImages(const obj::Data& data) const;
+  // Allocates every level and uploads those from first_level on, from staging when the levels were read into it.
+  [[nodiscard]] std::shared_ptr<TextureImage> CreateTextureImage(const texture::Texture& texture, const StagingRing::Region& staging, uint32_t first_level, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) const;
+  [[nodiscard]] std::shared_ptr<const TextureImage> GetFallbackImage(VkImageUsageFlags usage, VkMemoryPropertyFlags properties) const;
+  [[nodiscard]] std::vector<std::shared_ptr<const TextureImage>> CreateStagingImages(const obj::Data& data, bool compress_textures) const;
+  [[nodiscard]] std::vector<std::shared_ptr<VirtualTexture>> CreateVirtualTextures(const obj::Data& data) const;
   [[nodiscard]] UniformDescriptor CreateUniformDescriptor(VkDescriptorPool descriptor_pool, size_t frame_count) const;
-  [[nodiscard]] SamplerDescriptor CreateSamplerDescriptor(VkDescriptorPool descriptor_pool, std::vector<Image>&& images) const;
+  [[nodiscard]] SamplerDescriptor CreateSamplerDescriptor(VkDescriptorPool descriptor_pool, std::vector<std::shared_ptr<const TextureImage>>&& images, size_t frame_count) const;
+  [[nodiscard]] SamplerDescriptor CreateVirtualTextureDescriptor(VkDescriptorPool descriptor_pool, std::vector<std::shared_ptr<VirtualTexture>>&& textures, size_t frame_count) const;
+  [[nodiscard]] CullDescriptor CreateCullDescriptor(VkDescriptorPool descriptor_pool, const Object& object) const;
 
   const Device& device_;
   VkCommandPool cmd_pool_;
+  TextureCache& texture_cache_;
+  StagingRing& staging_ring_;
+  TextureStreamer* texture_streamer_;
+  TileCache* tile_cache_;
 };
 
 } // namespace vk
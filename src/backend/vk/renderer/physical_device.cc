@@ -111,4 +111,43 @@ VkPhysicalDeviceFeatures PhysicalDevice::features() const {
   return device_features;
 }
 
+VkPhysicalDeviceProperties PhysicalDevice::properties() const {
+  VkPhysicalDeviceProperties device_properties;
+  vkGetPhysicalDeviceProperties(physical_device_, &device_properties);
+
+  return device_properties;
+}
+
+bool PhysicalDevice::dynamic_rendering_supported() const {
+  if (properties().apiVersion < VK_API_VERSION_1_1 || !extensions_support(GetDynamicRenderingExtensions())) {
+    return false;
+  }
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features = {};
+  dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+  VkPhysicalDeviceFeatures2 device_features = {};
+  device_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  device_features.pNext = &dynamic_rendering_features;
+  vkGetPhysicalDeviceFeatures2(physical_device_, &device_features);
+
+  return dynamic_rendering_features.dynamicRendering == VK_TRUE;
+}
+
+bool PhysicalDevice::draw_indirect_count_supported() const {
+  return features().multiDrawIndirect == VK_TRUE && extensions_support({VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME});
+}
+
+bool PhysicalDevice::memory_budget_supported() const {
+  return properties().apiVersion >= VK_API_VERSION_1_1 && extensions_support({VK_EXT_MEMORY_BUDGET_EXTENSION_NAME});
+}
+
+const std::vector<const char*>& PhysicalDevice::GetDynamicRenderingExtensions() noexcept {
+  static const std::vector<const char*> extensions = {
+    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+    VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+    VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME
+  };
+  return extensions;
+}
+
 } // namespace vk
\ No newline at end of file
@@ -28,6 +28,12 @@ public:
   [[nodiscard]] std::vector<VkQueueFamilyProperties> queue_family_properties() const;
   [[nodiscard]] VkBool32 surface_supported(VkSurfaceKHR surface, uint32_t queue_family_idx) const;
   [[nodiscard]] VkPhysicalDeviceFeatures features() const;
+  [[nodiscard]] VkPhysicalDeviceProperties properties() const;
+  [[nodiscard]] bool dynamic_rendering_supported() const;
+  [[nodiscard]] bool draw_indirect_count_supported() const;
+  [[nodiscard]] bool memory_budget_supported() const;
+
+  static const std::vector<const char*>& GetDynamicRenderingExtensions() noexcept;
 private:
   VkPhysicalDevice physical_device_;
 };
@@ -0,0 +1,101 @@
+#include "backend/vk/renderer/pipeline_cache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "backend/vk/renderer/error.h"
+
+namespace vk {
+
+namespace {
+
+std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return {};
+  }
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+bool HeaderMatches(const std::vector<uint8_t>& data, const VkPhysicalDeviceProperties& properties) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  return header.headerSize >= sizeof(header) &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+} // namespace
+
+std::filesystem::path PipelineCache::DefaultPath() {
+  std::filesystem::path cache_dir;
+#ifdef _WIN32
+  if (const char* local_app_data = std::getenv("LOCALAPPDATA")) {
+    cache_dir = local_app_data;
+  }
+#else
+  if (const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME"); xdg_cache_home && *xdg_cache_home) {
+    cache_dir = xdg_cache_home;
+  } else if (const char* home = std::getenv("HOME")) {
+    cache_dir = std::filesystem::path(home) / ".cache";
+  }
+#endif
+  if (cache_dir.empty()) {
+    cache_dir = std::filesystem::temp_directory_path();
+  }
+  return cache_dir / "vulkan_engine" / "pipeline_cache.bin";
+}
+
+PipelineCache::PipelineCache(const Device& device, std::filesystem::path path)
+  : path_(std::move(path)), warm_(false) {
+  std::vector<uint8_t> data = ReadFile(path_);
+  if (HeaderMatches(data, device.physical_device().properties())) {
+    warm_ = true;
+  } else {
+    data.clear();
+  }
+  NonDispatchableHandle::operator=(device.CreatePipelineCache(data));
+}
+
+void PipelineCache::Save() const {
+  size_t data_size = 0;
+  if (const VkResult result = vkGetPipelineCacheData(creator(), handle(), &data_size, nullptr); result != VK_SUCCESS) {
+    throw Error("failed to get pipeline cache data size").WithCode(result);
+  }
+  std::vector<uint8_t> data(data_size);
+  if (const VkResult result = vkGetPipelineCacheData(creator(), handle(), &data_size, data.data()); result != VK_SUCCESS) {
+    throw Error("failed to get pipeline cache data").WithCode(result);
+  }
+  std::error_code error_code;
+  std::filesystem::create_directories(path_.parent_path(), error_code);
+  if (error_code) {
+    throw Error("failed to create pipeline cache directory: " + error_code.message());
+  }
+  std::filesystem::path tmp_path = path_;
+  tmp_path += ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      throw Error("failed to open pipeline cache file: " + tmp_path.string());
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data_size));
+    if (!file) {
+      throw Error("failed to write pipeline cache file: " + tmp_path.string());
+    }
+  }
+  std::filesystem::rename(tmp_path, path_, error_code);
+  if (error_code) {
+    throw Error("failed to replace pipeline cache file: " + error_code.message());
+  }
+}
+
+} // namespace vk
@@ -0,0 +1,36 @@
+#ifndef BACKEND_VK_RENDERER_PIPELINE_CACHE_H_
+#define BACKEND_VK_RENDERER_PIPELINE_CACHE_H_
+
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+
+#include "backend/vk/renderer/device.h"
+#include "backend/vk/renderer/handle.h"
+
+namespace vk {
+
+class PipelineCache final : public DeviceHandle<VkPipelineCache> {
+public:
+  static std::filesystem::path DefaultPath();
+
+  PipelineCache() noexcept;
+  PipelineCache(const Device& device, std::filesystem::path path);
+
+  [[nodiscard]] bool warm() const noexcept;
+
+  void Save() const;
+private:
+  std::filesystem::path path_;
+  bool warm_;
+};
+
+inline PipelineCache::PipelineCache() noexcept : warm_(false) {}
+
+inline bool PipelineCache::warm() const noexcept {
+  return warm_;
+}
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_PIPELINE_CACHE_H_
@@ -4,10 +4,8 @@
 #include "backend/vk/renderer/renderer.h"
 #include "backend/vk/renderer/window.h"
 
-constexpr size_t kFrameCount = 2;
-
-engine::Renderer* ENGINE_CONV PluginCreateRenderer(engine::Window& window) {
-  return new vk::Renderer(NAMED_DYNAMIC_CAST(vk::Window&, window), kFrameCount);
+engine::Renderer* ENGINE_CONV PluginCreateRenderer(engine::Window& window, const engine::RenderSettings& settings) {
+  return new vk::Renderer(NAMED_DYNAMIC_CAST(vk::Window&, window), settings);
 }
 
 void ENGINE_CONV PluginDestroyRenderer(engine::Renderer* renderer) {
@@ -1,12 +1,19 @@
 #include "backend/vk/renderer/renderer.h"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
 
 #include "backend/vk/renderer/device_selector.h"
 #include "backend/vk/renderer/error.h"
 #include "backend/vk/renderer/object_loader.h"
 #include "backend/vk/renderer/shader.h"
+#include "trace/trace.h"
 
 #include <thread>
 
@@ -14,6 +21,11 @@ namespace vk {
 
 namespace {
 
+// Bytes of streamed texture levels uploaded per rendered frame.
+constexpr VkDeviceSize kTextureStreamBudget = 8 << 20;
+// Host visible memory texture uploads are staged in, a texture larger than what is free gets a buffer of its own.
+constexpr VkDeviceSize kStagingRingSize = 64 << 20;
+
 std::vector<const char*> GetInstanceExtension(const Window& window) {
   std::vector<const char*> extensions = {
 #ifdef DEBUG
@@ -41,14 +53,74 @@ std::vector<const char*> GetDeviceExtension() {
   };
 }
 
+VkPresentModeKHR ToVkPresentMode(const engine::PresentMode present_mode) noexcept {
+  switch (present_mode) {
+    case engine::PresentMode::kMailbox:
+    case engine::PresentMode::kFrameLimited:
+      return VK_PRESENT_MODE_MAILBOX_KHR;
+    case engine::PresentMode::kImmediate:
+      return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    default:
+      return VK_PRESENT_MODE_FIFO_KHR;
+  }
+}
+
+VkImageAspectFlags GetDepthAspect(const VkFormat format) noexcept {
+  if (format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT) {
+    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+  }
+  return VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+VkImageMemoryBarrier GetImageBarrier(VkImage image, const VkImageAspectFlags aspect, const VkImageLayout old_layout, const VkImageLayout new_layout, const VkAccessFlags src_access, const VkAccessFlags dst_access) noexcept {
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = aspect;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  return barrier;
+}
+
+// Largest axis scale of the model matrix, bounds and errors are stretched by it.
+float GetModelScale(const glm::mat4& model) noexcept {
+  return std::sqrt(std::max({
+    glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+    glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+    glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))
+  }));
+}
+
 } // namespace
 
-Renderer::Renderer(Window& window, const size_t frame_count)
+Renderer::Renderer(Window& window, const engine::RenderSettings& settings)
   : window_(window),
-    frame_count_(frame_count),
+    frame_count_(settings.frames_in_flight),
+    present_mode_(ToVkPresentMode(settings.present_mode)),
+    depth_prepass_(settings.depth_prepass),
+    sort_draws_(settings.sort_draws),
+    gpu_culling_(settings.gpu_culling),
+    lod_count_(settings.lod_count),
+    forced_lod_(settings.forced_lod),
+    compress_textures_(settings.compress_textures),
+    stream_textures_(settings.stream_textures),
+    virtual_textures_(settings.virtual_textures),
+    geometry_chunk_budget_(settings.geometry_chunk_budget),
     framebuffer_resized_(false),
     curr_frame_(0),
-    instance_(GetInstanceExtension(window)) {
+    frame_number_(0),
+    instance_(GetInstanceExtension(window)),
+    lod_(0),
+    frame_stats_(nullptr) {
   ObjectLoader::Init();
 
   window.SetWindowResizedCallback([this]([[maybe_unused]] int width, [[maybe_unused]] int height) {
@@ -64,6 +136,10 @@ Renderer::Renderer(Window& window, const size_t frame_count)
   requirements.present = true;
   requirements.graphic = true;
   requirements.anisotropy = true;
+  requirements.dynamic_rendering = true;
+  requirements.draw_indirect_count = gpu_culling_;
+  requirements.memory_budget = stream_textures_;
+  requirements.fragment_stores = virtual_textures_;
   requirements.surface = surface_.handle();
   requirements.extensions = GetDeviceExtension();
 
@@ -74,18 +150,93 @@ Renderer::Renderer(Window& window, const size_t frame_count)
     throw Error("failed to find suitable device");
   }
   device_ = std::move(*device);
+  if (gpu_culling_ && !device_.draw_indirect_count()) {
+    std::clog << "gpu culling disabled, indirect count draws are not supported" << std::endl;
+    gpu_culling_ = false;
+  }
+  if (virtual_textures_ && !device_.fragment_stores()) {
+    std::clog << "virtual textures disabled, fragment stores are not supported" << std::endl;
+    virtual_textures_ = false;
+  }
+  if (virtual_textures_ && stream_textures_) {
+    std::clog << "texture streaming disabled, virtual textures are loaded by tiles" << std::endl;
+    stream_textures_ = false;
+  }
+  if (geometry_chunk_budget_ != 0 && (gpu_culling_ || lod_count_ > 1)) {
+    std::clog << "geometry streaming disabled, meshlets and lods are built from the whole mesh" << std::endl;
+    geometry_chunk_budget_ = 0;
+  }
 
-  std::tie(swapchain_, depth_image_) = CreateSwapchainAndDepthImage();
-  render_pass_ = device_.CreateRenderPass(swapchain_.format(),  depth_image_.format());
-  std::tie(swapchain_framebuffers_, sync_objects_) = CreateSwapchainImagesAndSyncObjects();
+  std::tie(swapchain_, depth_image_) = CreateSwapchainAndDepthImage(VK_NULL_HANDLE);
+  std::clog << "present mode " << PresentModeName(swapchain_.present_mode()) << " with " << swapchain_.images().size() << " swapchain images, " << frame_count_ << " frames in flight" << std::endl;
+  if (device_.dynamic_rendering()) {
+    std::clog << "using dynamic rendering" << std::endl;
+  } else {
+    render_pass_ = device_.CreateRenderPass(swapchain_.format(),  depth_image_.format());
+  }
+  swapchain_framebuffers_ = CreateSwapchainFramebuffers();
+  sync_objects_ = CreateSyncObjects();
 
   cmd_pool_ = device_.CreateCommandPool();
   cmd_buffers_ = device_.CreateCommandBuffers(cmd_pool_.handle(), frame_count_);
+  gpu_timer_ = GpuTimer(device_, frame_count_);
+
+  pipeline_cache_ = PipelineCache(device_, PipelineCache::DefaultPath());
+  texture_cache_ = TextureCache(device_);
+  staging_ring_ = std::make_unique<StagingRing>(device_, kStagingRingSize);
+  if (stream_textures_) {
+    texture_streamer_ = std::make_unique<TextureStreamer>(device_, *staging_ring_, kTextureStreamBudget);
+  }
+  if (virtual_textures_) {
+    tile_cache_ = std::make_unique<TileCache>(device_, frame_count_);
+  }
+
+  uniform_layout_ = device_.CreateUniformDescriptorSetLayout();
+  sampler_layout_ = virtual_textures_ ? device_.CreateVirtualTextureDescriptorSetLayout() : device_.CreateSamplerDescriptorSetLayout();
+  pipeline_layout_ = device_.CreatePipelineLayout({uniform_layout_.handle(), sampler_layout_.handle()});
+
+  const auto pipeline_start = std::chrono::steady_clock::now();
+  pipeline_ = CreatePipeline(virtual_textures_ ? Shader::GetVirtualInfos() : Shader::GetInfos());
+  if (depth_prepass_) {
+    depth_pipeline_ = CreateDepthPipeline(Shader::GetDepthInfos());
+  }
+  if (gpu_culling_) {
+    cull_layout_ = device_.CreateCullDescriptorSetLayout();
+    cull_pipeline_layout_ = device_.CreatePipelineLayout({cull_layout_.handle()});
+    cull_pipeline_ = CreateCullPipeline(Shader::GetCullInfos());
+  }
+  const std::chrono::duration<double, std::milli> pipeline_time = std::chrono::steady_clock::now() - pipeline_start;
+
+  std::clog << "pipeline created in " << pipeline_time.count() << " ms (" << (pipeline_cache_.warm() ? "warm" : "cold") << " cache)" << std::endl;
+#ifdef ENGINE_SHADER_HOT_RELOAD
+  shader_watcher_ = std::make_unique<ShaderWatcher>(ENGINE_SHADER_DIR, [this] { ReloadPipeline(); });
+#endif // ENGINE_SHADER_HOT_RELOAD
 }
 
-Renderer::~Renderer() { vkDeviceWaitIdle(device_.handle()); }
+Renderer::~Renderer() {
+#ifdef ENGINE_SHADER_HOT_RELOAD
+  shader_watcher_.reset();
+#endif // ENGINE_SHADER_HOT_RELOAD
+  for (std::future<void>& load_task : load_tasks_) {
+    load_task.wait();
+  }
+  texture_streamer_.reset();
+  {
+    // the frame fences do not cover the last present, which may still be reading the swapchain and its semaphores
+    std::lock_guard lock(device_.queue_mutex());
+    vkDeviceWaitIdle(device_.handle());
+  }
+  tile_cache_.reset();
+  device_.FlushGarbage();
+  try {
+    pipeline_cache_.Save();
+  } catch (const Error& error) {
+    std::cerr << error.what() << std::endl;
+  }
+}
 
 void Renderer::RenderFrame() {
+  TRACE_ZONE("vk::Renderer::RenderFrame");
   uint32_t image_idx;
 
   VkFence fence = sync_objects_[curr_frame_].fence.handle();
@@ -95,24 +246,48 @@ void Renderer::RenderFrame() {
   VkCommandBuffer cmd_buffer = cmd_buffers_[curr_frame_];
   VkSwapchainKHR swapchain = swapchain_.handle();
 
-  if (const VkResult result = vkWaitForFences(device_.handle(), 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max()); result != VK_SUCCESS) {
-    throw Error("failed to wait for fences").WithCode(result);
+  {
+    engine::FrameStats::Scope fence_wait_scope(frame_stats_, engine::FrameStats::Phase::kFenceWait);
+    if (const VkResult result = vkWaitForFences(device_.handle(), 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max()); result != VK_SUCCESS) {
+      throw Error("failed to wait for fences").WithCode(result);
+    }
   }
-  if (const VkResult result = vkAcquireNextImageKHR(device_.handle(), swapchain_.handle(), std::numeric_limits<uint64_t>::max(), wait_semaphore, VK_NULL_HANDLE, &image_idx); result != VK_SUCCESS) {
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+  gpu_timer_.Collect(curr_frame_, frame_stats_);
+  device_.CollectGarbage(frame_number_, frame_count_);
+  FulfilDrawnPromises();
+  SwapObject();
+  UpdateSamplers();
+  if (texture_streamer_) {
+    texture_streamer_->OnFrame();
+  }
+  if (tile_cache_) {
+    tile_cache_->Update(curr_frame_);
+  }
+#ifdef ENGINE_SHADER_HOT_RELOAD
+  SwapPipeline();
+#endif // ENGINE_SHADER_HOT_RELOAD
+  if (const VkResult result = vkAcquireNextImageKHR(device_.handle(), swapchain_.handle(), std::numeric_limits<uint64_t>::max(), wait_semaphore, VK_NULL_HANDLE, &image_idx); result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+    // a suboptimal image is still rendered and presented, its semaphore is already signalled and the swapchain gets recreated after present
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
       RecreateSwapchain();
       return;
     }
     throw Error("failed to acquire next image").WithCode(result);
   }
-  UpdateUniforms();
+  {
+    engine::FrameStats::Scope uniform_update_scope(frame_stats_, engine::FrameStats::Phase::kUniformUpdate);
+    UpdateUniforms();
+  }
   if (const VkResult result = vkResetFences(device_.handle(), 1, &fence); result != VK_SUCCESS) {
     throw Error("failed to reset fences").WithCode(result);
   }
   if (const VkResult result = vkResetCommandBuffer(cmd_buffer, 0); result != VK_SUCCESS) {
     throw Error("failed to reset command buffer").WithCode(result);
   }
-  RecordCommandBuffer(cmd_buffer, image_idx);
+  {
+    engine::FrameStats::Scope record_scope(frame_stats_, engine::FrameStats::Phase::kRecord);
+    RecordCommandBuffer(cmd_buffer, image_idx);
+  }
 
   const std::vector<VkPipelineStageFlags> pipeline_stages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
@@ -126,8 +301,12 @@ void Renderer::RenderFrame() {
   submit_info.signalSemaphoreCount = 1;
   submit_info.pSignalSemaphores = &signal_semaphore;
 
-  if (const VkResult result = vkQueueSubmit(device_.graphics_queue().handle, 1, &submit_info, fence); result != VK_SUCCESS) {
-    throw Error("failed to submit draw command buffer").WithCode(result);
+  std::unique_lock queue_lock(device_.queue_mutex());
+  {
+    engine::FrameStats::Scope submit_scope(frame_stats_, engine::FrameStats::Phase::kSubmit);
+    if (const VkResult result = vkQueueSubmit(device_.graphics_queue().handle, 1, &submit_info, fence); result != VK_SUCCESS) {
+      throw Error("failed to submit draw command buffer").WithCode(result);
+    }
   }
 
   VkPresentInfoKHR present_info = {};
@@ -138,25 +317,110 @@ void Renderer::RenderFrame() {
   present_info.pSwapchains = &swapchain;
   present_info.pImageIndices = &image_idx;
 
-  if (const VkResult result = vkQueuePresentKHR(device_.present_queue().handle, &present_info);
-      result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebuffer_resized_) {
+  VkResult present_result;
+  {
+    engine::FrameStats::Scope present_scope(frame_stats_, engine::FrameStats::Phase::kPresent);
+    present_result = vkQueuePresentKHR(device_.present_queue().handle, &present_info);
+  }
+  queue_lock.unlock();
+
+  if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR || framebuffer_resized_) {
     framebuffer_resized_ = false;
     RecreateSwapchain();
-  } else if (result != VK_SUCCESS) {
-    throw Error("failed to queue present").WithCode(result);
+  } else if (present_result != VK_SUCCESS) {
+    throw Error("failed to queue present").WithCode(present_result);
   }
   curr_frame_ = (curr_frame_ + 1) % frame_count_;
+  ++frame_number_;
 }
 
 void Renderer::LoadModel(const std::string& path) {
-  object_ = ObjectLoader(device_, cmd_pool_.handle()).Load(path, frame_count_);
+  SetObject(std::make_unique<Object>(ObjectLoader(device_, cmd_pool_.handle(), texture_cache_, *staging_ring_, texture_streamer_.get(), tile_cache_.get()).Load(path, frame_count_, {depth_prepass_, gpu_culling_, lod_count_, compress_textures_, geometry_chunk_budget_})));
+}
 
-  const std::vector descriptor_set_layouts = { object_.uniform_descriptor.layout.handle(), object_.sampler_descriptor.layout.handle() };
+std::future<void> Renderer::LoadModelAsync(const std::string& path) {
+  load_tasks_.erase(
+    std::remove_if(load_tasks_.begin(), load_tasks_.end(), [](const std::future<void>& load_task) {
+      return load_task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }),
+    load_tasks_.end()
+  );
+  std::promise<void> promise;
+  std::future<void> future = promise.get_future();
+
+  load_tasks_.emplace_back(std::async(std::launch::async, [this, path, promise = std::move(promise)]() mutable {
+    std::unique_ptr<Object> object;
+    try {
+      const DeviceHandle<VkCommandPool> cmd_pool = device_.CreateCommandPool();
+      object = std::make_unique<Object>(ObjectLoader(device_, cmd_pool.handle(), texture_cache_, *staging_ring_, texture_streamer_.get(), tile_cache_.get()).Load(path, frame_count_, {depth_prepass_, gpu_culling_, lod_count_, compress_textures_, geometry_chunk_budget_}));
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+      return;
+    }
+    std::lock_guard lock(pending_objects_mutex_);
+    pending_objects_.push_back({std::move(object), std::move(promise)});
+  }));
+  return future;
+}
 
-  pipeline_layout_ = device_.CreatePipelineLayout(descriptor_set_layouts);
+void Renderer::SetObject(std::unique_ptr<Object> object) {
+  if (object_) {
+    device_.Retire(std::move(object_));
+  }
+  object_ = std::move(object);
+  draw_order_.clear();
+  lod_ = 0;
+  for (size_t i = 0; i < object_->lods.size(); ++i) {
+    const Lod& lod = object_->lods[i];
+    const uint32_t index_count = lod.range_ends.empty() ? 0 : lod.range_ends.back() - lod.first_index;
+    std::clog << "lod " << i << ": " << index_count / 3 << " triangles, error " << lod.error << std::endl;
+  }
 
-  const std::vector<ShaderInfo> shader_infos = Shader::GetInfos();
+  uniforms_buff_.clear();
+  uniforms_buff_.reserve(object_->uniform_descriptor.sets.size());
+  for(const UniformDescriptorSet& descriptor_set : object_->uniform_descriptor.sets) {
+    auto uniforms = static_cast<Uniforms*>(descriptor_set.buffer.memory().Map());
+    uniforms_buff_.emplace_back(uniforms);
+  }
+}
 
+void Renderer::SwapObject() {
+  std::unique_lock lock(pending_objects_mutex_, std::try_to_lock);
+  if (!lock.owns_lock() || pending_objects_.empty()) {
+    return;
+  }
+  std::vector<PendingObject> pending_objects = std::move(pending_objects_);
+  pending_objects_.clear();
+  lock.unlock();
+
+  for (PendingObject& pending_object : pending_objects) {
+    SetObject(std::move(pending_object.object));
+    drawn_promises_.push_back({frame_number_, std::move(pending_object.promise)});
+  }
+}
+
+void Renderer::FulfilDrawnPromises() {
+  // the fence just waited for is the one of the frame frame_count_ frames back
+  size_t drawn = 0;
+  for (; drawn < drawn_promises_.size() && drawn_promises_[drawn].frame_number + frame_count_ <= frame_number_; ++drawn) {
+    drawn_promises_[drawn].promise.set_value();
+  }
+  drawn_promises_.erase(drawn_promises_.begin(), drawn_promises_.begin() + static_cast<std::ptrdiff_t>(drawn));
+}
+
+// The frame's fence was waited for, its descriptor sets can pick up levels streamed in since they were last written.
+void Renderer::UpdateSamplers() {
+  if (!texture_streamer_ || !object_) {
+    return;
+  }
+  for (SamplerDescriptorSet& set : object_->sampler_descriptor.sets) {
+    if (set.levels[curr_frame_] != set.image->resident_level.load(std::memory_order_acquire)) {
+      set.Update(curr_frame_);
+    }
+  }
+}
+
+std::vector<Shader> Renderer::CreateShaders(const std::vector<ShaderInfo>& shader_infos) const {
   std::vector<Shader> shaders;
   shaders.reserve(shader_infos.size());
   for(const auto& [description, spirv] : shader_infos) {
@@ -166,33 +430,125 @@ void Renderer::LoadModel(const std::string& path) {
 
     shaders.emplace_back(std::move(shader));
   }
-  pipeline_ = device_.CreatePipeline(pipeline_layout_.handle(), render_pass_.handle(), Vertex::GetAttributeDescriptions(), Vertex::GetBindingDescriptions(), shaders);
+  return shaders;
+}
 
-  uniforms_buff_.reserve(object_.uniform_descriptor.sets.size());
-  for(const UniformDescriptorSet& descriptor_set : object_.uniform_descriptor.sets) {
-    auto uniforms = static_cast<Uniforms*>(descriptor_set.buffer.memory().Map());
-    uniforms_buff_.emplace_back(uniforms);
+DeviceHandle<VkPipeline> Renderer::CreatePipeline(const std::vector<ShaderInfo>& shader_infos) const {
+  RenderTarget render_target = {};
+  render_target.render_pass = render_pass_.handle();
+  render_target.color_format = swapchain_.format();
+  render_target.depth_format = depth_image_.format();
+
+  // after the prepass every visible fragment already has its final depth, so only the nearest one is shaded
+  DepthState depth_state = {};
+  depth_state.compare_op = depth_prepass_ ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+  depth_state.write = depth_prepass_ ? VK_FALSE : VK_TRUE;
+
+  return device_.CreatePipeline(pipeline_cache_.handle(), pipeline_layout_.handle(), render_target, depth_state, Vertex::GetAttributeDescriptions(), Vertex::GetBindingDescriptions(), CreateShaders(shader_infos));
+}
+
+DeviceHandle<VkPipeline> Renderer::CreateDepthPipeline(const std::vector<ShaderInfo>& shader_infos) const {
+  RenderTarget render_target = {};
+  render_target.render_pass = render_pass_.handle();
+  render_target.color_format = swapchain_.format();
+  render_target.depth_format = depth_image_.format();
+
+  DepthState depth_state = {};
+  depth_state.compare_op = VK_COMPARE_OP_LESS;
+  depth_state.write = VK_TRUE;
+
+  return device_.CreatePipeline(pipeline_cache_.handle(), pipeline_layout_.handle(), render_target, depth_state, Vertex::GetPositionAttributeDescriptions(), Vertex::GetPositionBindingDescriptions(), CreateShaders(shader_infos));
+}
+
+DeviceHandle<VkPipeline> Renderer::CreateCullPipeline(const std::vector<ShaderInfo>& shader_infos) const {
+  return device_.CreateComputePipeline(pipeline_cache_.handle(), cull_pipeline_layout_.handle(), CreateShaders(shader_infos).front());
+}
+
+#ifdef ENGINE_SHADER_HOT_RELOAD
+
+// runs on the watcher thread, so it only compiles, the pipelines read the swapchain and are built on the render thread
+void Renderer::ReloadPipeline() {
+  const auto compile_start = std::chrono::steady_clock::now();
+  std::vector<ShaderInfo> infos = virtual_textures_ ? Shader::CompileVirtualInfos() : Shader::CompileInfos();
+  std::vector<ShaderInfo> depth_infos;
+  if (depth_prepass_) {
+    depth_infos = Shader::CompileDepthInfos();
+  }
+  std::vector<ShaderInfo> cull_infos;
+  if (gpu_culling_) {
+    cull_infos = Shader::CompileCullInfos();
   }
+  const std::chrono::duration<double, std::milli> compile_time = std::chrono::steady_clock::now() - compile_start;
+
+  std::clog << "shaders compiled in " << compile_time.count() << " ms" << std::endl;
+
+  std::lock_guard lock(pending_pipeline_mutex_);
+  pending_infos_ = std::move(infos);
+  pending_depth_infos_ = std::move(depth_infos);
+  pending_cull_infos_ = std::move(cull_infos);
 }
 
+void Renderer::SwapPipeline() {
+  std::vector<ShaderInfo> infos, depth_infos, cull_infos;
+  {
+    std::unique_lock lock(pending_pipeline_mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || pending_infos_.empty()) {
+      return;
+    }
+    infos = std::move(pending_infos_);
+    depth_infos = std::move(pending_depth_infos_);
+    cull_infos = std::move(pending_cull_infos_);
+    pending_infos_.clear();
+  }
+  const auto build_start = std::chrono::steady_clock::now();
+  DeviceHandle<VkPipeline> pipeline = CreatePipeline(infos);
+  DeviceHandle<VkPipeline> depth_pipeline;
+  if (depth_prepass_) {
+    depth_pipeline = CreateDepthPipeline(depth_infos);
+  }
+  DeviceHandle<VkPipeline> cull_pipeline;
+  if (gpu_culling_) {
+    cull_pipeline = CreateCullPipeline(cull_infos);
+  }
+  const std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - build_start;
+
+  std::clog << "pipelines rebuilt in " << build_time.count() << " ms" << std::endl;
+
+  device_.Retire(std::move(pipeline_));
+  pipeline_ = std::move(pipeline);
+  // both stages are swapped together, the equal depth test relies on them computing identical positions
+  if (depth_prepass_) {
+    device_.Retire(std::move(depth_pipeline_));
+    depth_pipeline_ = std::move(depth_pipeline);
+  }
+  if (gpu_culling_) {
+    device_.Retire(std::move(cull_pipeline_));
+    cull_pipeline_ = std::move(cull_pipeline);
+  }
+}
+
+#endif // ENGINE_SHADER_HOT_RELOAD
+
 void Renderer::RecreateSwapchain() {
   window_.WaitUntilResized();
 
-  if (const VkResult result = vkDeviceWaitIdle(device_.handle()); result != VK_SUCCESS) {
-    throw Error("failed to idle device");
-  }
-  swapchain_ = Swapchain();
+  // frames in flight may still render into the old images, they are released once their fences signal
+  Swapchain old_swapchain = std::move(swapchain_);
+  device_.Retire(std::move(swapchain_framebuffers_));
+  device_.Retire(std::move(depth_image_));
 
-  std::tie(swapchain_, depth_image_) = CreateSwapchainAndDepthImage();
-  std::tie(swapchain_framebuffers_, sync_objects_) = CreateSwapchainImagesAndSyncObjects();
+  std::tie(swapchain_, depth_image_) = CreateSwapchainAndDepthImage(old_swapchain.handle());
+  swapchain_framebuffers_ = CreateSwapchainFramebuffers();
+
+  device_.Retire(std::move(old_swapchain));
 }
 
-std::pair<Swapchain, Image> Renderer::CreateSwapchainAndDepthImage() const {
+std::pair<Swapchain, Image> Renderer::CreateSwapchainAndDepthImage(VkSwapchainKHR old_swapchain) const {
   VkExtent2D swapchain_extent = {};
   swapchain_extent.width = window_.GetWidth();
   swapchain_extent.height = window_.GetHeight();
 
-  Swapchain swapchain = device_.CreateSwapchain(swapchain_extent, surface_.handle());
+  Swapchain swapchain = device_.CreateSwapchain(swapchain_extent, surface_.handle(), present_mode_, old_swapchain);
 
   const VkFormat depth_format = device_.physical_device().FindSupportedFormat(
       {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
@@ -209,18 +565,25 @@ std::pair<Swapchain, Image> Renderer::CreateSwapchainAndDepthImage() const {
   return { std::move(swapchain), std::move(depth_image) };
 }
 
-std::pair<std::vector<SwapchainFramebuffer>, std::vector<SyncObject>> Renderer::CreateSwapchainImagesAndSyncObjects() const {
+std::vector<SwapchainFramebuffer> Renderer::CreateSwapchainFramebuffers() const {
   const std::vector<VkImage> images = swapchain_.images();
   std::vector<SwapchainFramebuffer> swapchain_framebuffers;
   swapchain_framebuffers.reserve(images.size());
 
   for(VkImage image : images) {
     SwapchainFramebuffer swapchain_framebuffer = {};
+    swapchain_framebuffer.image = image;
     swapchain_framebuffer.view = device_.CreateImageView(image, VK_IMAGE_ASPECT_COLOR_BIT, swapchain_.format());
-    swapchain_framebuffer.framebuffer = device_.CreateFramebuffer({swapchain_framebuffer.view.handle(), depth_image_.view()}, render_pass_.handle(), swapchain_.extent());
+    if (render_pass_.handle() != VK_NULL_HANDLE) {
+      swapchain_framebuffer.framebuffer = device_.CreateFramebuffer({swapchain_framebuffer.view.handle(), depth_image_.view()}, render_pass_.handle(), swapchain_.extent());
+    }
 
     swapchain_framebuffers.emplace_back(std::move(swapchain_framebuffer));
   }
+  return swapchain_framebuffers;
+}
+
+std::vector<SyncObject> Renderer::CreateSyncObjects() const {
   std::vector<SyncObject> sync_objects;
   sync_objects.reserve(frame_count_);
 
@@ -233,34 +596,131 @@ std::pair<std::vector<SwapchainFramebuffer>, std::vector<SyncObject>> Renderer::
     sync_objects.emplace_back(std::move(sync_object));
   }
 
-  return { std::move(swapchain_framebuffers), std::move(sync_objects) };
+  return sync_objects;
 }
 
 inline void Renderer::UpdateUniforms() const {
+  if (!object_) {
+    return;
+  }
   const engine::Uniforms& uniforms = model_.GetUniforms();
   std::memcpy(uniforms_buff_[curr_frame_], &uniforms, sizeof(Uniforms));
 }
 
+void Renderer::SortDraws() {
+  const size_t range_count = object_->usemtl.size();
+  if (draw_order_.size() != range_count) {
+    draw_order_.resize(range_count);
+    std::iota(draw_order_.begin(), draw_order_.end(), 0);
+  }
+  if (!sort_draws_) {
+    return;
+  }
+  const engine::Uniforms& uniforms = model_.GetUniforms();
+  const glm::mat4 model_view = uniforms.view * uniforms.model;
+  const float scale = GetModelScale(uniforms.model);
+  draw_distances_.resize(range_count);
+  for (size_t i = 0; i < range_count; ++i) {
+    const engine::BoundingSphere& bounds = object_->bounds[i];
+    const glm::vec3 view_center(model_view * glm::vec4(bounds.center, 1.0f));
+    // distance to the nearest point of the sphere, ranges the camera is inside of come first
+    draw_distances_[i] = glm::length(view_center) - bounds.radius * scale;
+  }
+  // the previous frame's order is nearly sorted already, insertion keeps it cheap while the model rotates
+  for (size_t i = 1; i < range_count; ++i) {
+    const size_t range_idx = draw_order_[i];
+    size_t j = i;
+    for (; j > 0 && draw_distances_[draw_order_[j - 1]] > draw_distances_[range_idx]; --j) {
+      draw_order_[j] = draw_order_[j - 1];
+    }
+    draw_order_[j] = range_idx;
+  }
+}
+
+void Renderer::SelectLod() {
+  const size_t lod_count = object_->lods.size();
+  if (lod_count <= 1 || !object_->cull_descriptor.sets.empty()) {
+    lod_ = 0;
+    return;
+  }
+  if (forced_lod_) {
+    lod_ = std::min(*forced_lod_, lod_count - 1);
+    return;
+  }
+  // a simplification error under a pixel at the nearest range of the model is not visible
+  constexpr float kMaxPixelError = 1.0f;
+  constexpr float kMinDistance = 1e-3f;
+
+  const engine::Uniforms& uniforms = model_.GetUniforms();
+  const glm::mat4 model_view = uniforms.view * uniforms.model;
+  const float scale = GetModelScale(uniforms.model);
+
+  float distance = std::numeric_limits<float>::max();
+  for (const engine::BoundingSphere& bounds : object_->bounds) {
+    const glm::vec3 view_center(model_view * glm::vec4(bounds.center, 1.0f));
+    distance = std::min(distance, glm::length(view_center) - bounds.radius * scale);
+  }
+  const float pixels_per_unit = scale * std::abs(uniforms.proj[1][1]) * 0.5f * static_cast<float>(swapchain_.extent().height) / std::max(distance, kMinDistance);
+
+  lod_ = 0;
+  while (lod_ + 1 < lod_count && object_->lods[lod_ + 1].error * pixels_per_unit <= kMaxPixelError) {
+    ++lod_;
+  }
+}
+
+void Renderer::CullMeshlets(VkCommandBuffer cmd_buffer) const {
+  const CullDescriptorSet& cull_set = object_->cull_descriptor.sets[curr_frame_];
+
+  vkCmdFillBuffer(cmd_buffer, cull_set.counts.handle(), 0, VK_WHOLE_SIZE, 0);
+
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  constexpr uint32_t kWorkgroupSize = 64;
+  vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_.handle());
+  vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout_.handle(), 0, 1, &cull_set.handle, 0, nullptr);
+  vkCmdDispatch(cmd_buffer, (object_->meshlet_count + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1);
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void Renderer::DrawRange(VkCommandBuffer cmd_buffer, const size_t range_idx) const {
+  if (!object_->cull_descriptor.sets.empty()) {
+    const CullDescriptorSet& cull_set = object_->cull_descriptor.sets[curr_frame_];
+    const MeshletRange& meshlet_range = object_->meshlet_ranges[range_idx];
+    if (meshlet_range.count == 0) {
+      return;
+    }
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    device_.CmdDrawIndexedIndirectCount(cmd_buffer, cull_set.draws.handle(), meshlet_range.first * stride, cull_set.counts.handle(), range_idx * sizeof(uint32_t), meshlet_range.count, stride);
+    return;
+  }
+  const Lod& lod = object_->lods[lod_];
+  const uint32_t first_index = range_idx == 0 ? lod.first_index : lod.range_ends[range_idx - 1];
+  const uint32_t index_count = lod.range_ends[range_idx] - first_index;
+
+  vkCmdDrawIndexed(cmd_buffer, index_count, 1, first_index, 0, 0);
+}
+
 void Renderer::RecordCommandBuffer(VkCommandBuffer cmd_buffer, const size_t image_idx) {
   VkCommandBufferBeginInfo cmd_buffer_begin_info = {};
   cmd_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   if (const VkResult result = vkBeginCommandBuffer(cmd_buffer, &cmd_buffer_begin_info); result != VK_SUCCESS) {
     throw Error("failed to begin recording command buffer").WithCode(result);
   }
-  std::array<VkClearValue, 2> clear_values = {};
-  clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-  clear_values[1].depthStencil = {1.0f, 0};
-
-  VkRenderPassBeginInfo render_pass_begin_info = {};
-  render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  render_pass_begin_info.renderPass = render_pass_.handle();
-  render_pass_begin_info.framebuffer = swapchain_framebuffers_[image_idx].framebuffer.handle();
-  render_pass_begin_info.renderArea.offset = {0, 0};
-  render_pass_begin_info.renderArea.extent = swapchain_.extent();
-  render_pass_begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-  render_pass_begin_info.pClearValues = clear_values.data();
-  vkCmdBeginRenderPass(cmd_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-  vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_.handle());
+  gpu_timer_.Begin(cmd_buffer, curr_frame_);
+  if (object_ && !object_->cull_descriptor.sets.empty()) {
+    CullMeshlets(cmd_buffer);
+  }
+  if (tile_cache_) {
+    tile_cache_->Record(cmd_buffer, curr_frame_);
+  }
+  BeginRendering(cmd_buffer, image_idx);
 
   VkViewport viewport = {};
   viewport.x = 0.0f;
@@ -276,26 +736,119 @@ void Renderer::RecordCommandBuffer(VkCommandBuffer cmd_buffer, const size_t imag
   scissor.extent = swapchain_.extent();
   vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
 
-  VkBuffer vertices_buffer = object_.vertices.handle();
-  VkBuffer indices_buffer = object_.indices.handle();
+  if (object_) {
+    SortDraws();
+    SelectLod();
 
-  VkDeviceSize prev_offset = 0;
-  constexpr std::array vertex_offsets = {VkDeviceSize{0}};
+    constexpr std::array vertex_offsets = {VkDeviceSize{0}};
 
-  vkCmdBindVertexBuffers(cmd_buffer, 0, vertex_offsets.size(), &vertices_buffer, vertex_offsets.data());
-  vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_.handle(), 0, 1, &object_.uniform_descriptor.sets[curr_frame_].handle, 0, nullptr);
+    vkCmdBindIndexBuffer(cmd_buffer, object_->indices.handle(), 0, IndexType<Index>::value);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_.handle(), 0, 1, &object_->uniform_descriptor.sets[curr_frame_].handle, 0, nullptr);
 
-  for(const auto[index, offset] : object_.usemtl) {
-    vkCmdBindIndexBuffer(cmd_buffer, indices_buffer, prev_offset * sizeof(Index), IndexType<Index>::value);
-    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_.handle(), 1, 1, &object_.sampler_descriptor.sets[index].handle, 0, nullptr);
-    vkCmdDrawIndexed(cmd_buffer, static_cast<uint32_t>(offset - prev_offset), 1, 0, 0, 0);
+    if (depth_prepass_) {
+      VkBuffer positions_buffer = object_->positions.handle();
 
-    prev_offset = offset;
+      vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depth_pipeline_.handle());
+      vkCmdBindVertexBuffers(cmd_buffer, 0, vertex_offsets.size(), &positions_buffer, vertex_offsets.data());
+      for(const size_t range_idx : draw_order_) {
+        DrawRange(cmd_buffer, range_idx);
+      }
+    }
+    VkBuffer vertices_buffer = object_->vertices.handle();
+
+    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_.handle());
+    vkCmdBindVertexBuffers(cmd_buffer, 0, vertex_offsets.size(), &vertices_buffer, vertex_offsets.data());
+    for(const size_t range_idx : draw_order_) {
+      const unsigned int index = object_->usemtl[range_idx].index;
+
+      vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_.handle(), 1, 1, &object_->sampler_descriptor.sets[index].handles[curr_frame_], 0, nullptr);
+      gpu_timer_.BeginRange(cmd_buffer, curr_frame_, index);
+      DrawRange(cmd_buffer, range_idx);
+      gpu_timer_.EndRange(cmd_buffer, curr_frame_);
+    }
   }
-  vkCmdEndRenderPass(cmd_buffer);
+  EndRendering(cmd_buffer, image_idx);
+  if (tile_cache_) {
+    TileCache::RecordFeedbackBarrier(cmd_buffer);
+  }
+  gpu_timer_.End(cmd_buffer, curr_frame_);
   if (const VkResult result = vkEndCommandBuffer(cmd_buffer); result != VK_SUCCESS) {
     throw Error("failed to record command buffer").WithCode(result);
   }
 }
 
+void Renderer::BeginRendering(VkCommandBuffer cmd_buffer, const size_t image_idx) const {
+  const SwapchainFramebuffer& swapchain_framebuffer = swapchain_framebuffers_[image_idx];
+
+  std::array<VkClearValue, 2> clear_values = {};
+  clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+  clear_values[1].depthStencil = {1.0f, 0};
+
+  if (!device_.dynamic_rendering()) {
+    VkRenderPassBeginInfo render_pass_begin_info = {};
+    render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_begin_info.renderPass = render_pass_.handle();
+    render_pass_begin_info.framebuffer = swapchain_framebuffer.framebuffer.handle();
+    render_pass_begin_info.renderArea.offset = {0, 0};
+    render_pass_begin_info.renderArea.extent = swapchain_.extent();
+    render_pass_begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+    render_pass_begin_info.pClearValues = clear_values.data();
+    vkCmdBeginRenderPass(cmd_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    return;
+  }
+  // without a render pass the layout transitions and the write-after-write dependency on the depth image are explicit
+  const std::array barriers = {
+    GetImageBarrier(swapchain_framebuffer.image, VK_IMAGE_ASPECT_COLOR_BIT,
+                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                    0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT),
+    GetImageBarrier(depth_image_.handle(), GetDepthAspect(depth_image_.format()),
+                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)
+  };
+  constexpr VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  vkCmdPipelineBarrier(cmd_buffer, stages, stages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  VkRenderingAttachmentInfoKHR color_attachment = {};
+  color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  color_attachment.imageView = swapchain_framebuffer.view.handle();
+  color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  color_attachment.clearValue = clear_values[0];
+
+  VkRenderingAttachmentInfoKHR depth_attachment = {};
+  depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  depth_attachment.imageView = depth_image_.view();
+  depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depth_attachment.clearValue = clear_values[1];
+
+  VkRenderingInfoKHR rendering_info = {};
+  rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+  rendering_info.renderArea.offset = {0, 0};
+  rendering_info.renderArea.extent = swapchain_.extent();
+  rendering_info.layerCount = 1;
+  rendering_info.colorAttachmentCount = 1;
+  rendering_info.pColorAttachments = &color_attachment;
+  rendering_info.pDepthAttachment = &depth_attachment;
+
+  device_.CmdBeginRendering(cmd_buffer, rendering_info);
+}
+
+void Renderer::EndRendering(VkCommandBuffer cmd_buffer, const size_t image_idx) const {
+  if (!device_.dynamic_rendering()) {
+    vkCmdEndRenderPass(cmd_buffer);
+    return;
+  }
+  device_.CmdEndRendering(cmd_buffer);
+
+  const VkImageMemoryBarrier barrier = GetImageBarrier(
+    swapchain_framebuffers_[image_idx].image, VK_IMAGE_ASPECT_COLOR_BIT,
+    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0
+  );
+  vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 } // namespace vk
\ No newline at end of file
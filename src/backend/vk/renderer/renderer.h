@@ -1,6 +1,10 @@
 #ifndef BACKEND_VK_RENDERER_RENDERER_H_
 #define BACKEND_VK_RENDERER_RENDERER_H_
 
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 #include <utility>
@@ -12,18 +16,31 @@
 #include <vulkan/vulkan.h>
 
 #include "backend/vk/renderer/device.h"
+#include "backend/vk/renderer/gpu_timer.h"
 #include "backend/vk/renderer/instance.h"
 #include "backend/vk/renderer/object.h"
+#include "backend/vk/renderer/pipeline_cache.h"
+#include "backend/vk/renderer/shader.h"
+#include "backend/vk/renderer/staging_ring.h"
+#ifdef ENGINE_SHADER_HOT_RELOAD
+#include "backend/vk/renderer/shader_watcher.h"
+#endif // ENGINE_SHADER_HOT_RELOAD
 #include "backend/vk/renderer/swapchain.h"
+#include "backend/vk/renderer/texture_cache.h"
+#include "backend/vk/renderer/texture_streamer.h"
+#include "backend/vk/renderer/tile_cache.h"
 #include "backend/vk/renderer/window.h"
 #include "engine/render/model.h"
 #include "engine/render/renderer.h"
+#include "engine/render/settings.h"
 
 namespace vk {
 
 struct SwapchainFramebuffer {
+  // null when the device renders without a render pass
   DeviceHandle<VkFramebuffer> framebuffer;
   DeviceHandle<VkImageView> view;
+  VkImage image;
 };
 
 struct SyncObject {
@@ -32,27 +49,72 @@ struct SyncObject {
   DeviceHandle<VkFence> fence;
 };
 
+struct PendingObject {
+  std::unique_ptr<Object> object;
+  std::promise<void> promise;
+};
+
+// Fulfilled once the fence of frame_number, the first frame drawing the loaded object, has signalled.
+struct DrawnPromise {
+  size_t frame_number;
+  std::promise<void> promise;
+};
+
 class Renderer final : public engine::Renderer {
 public:
-  explicit Renderer(Window& window, size_t frame_count);
+  Renderer(Window& window, const engine::RenderSettings& settings);
   ~Renderer() override;
 
   void RenderFrame() override;
   void LoadModel(const std::string& path) override;
+  std::future<void> LoadModelAsync(const std::string& path) override;
   engine::Model& GetModel() noexcept override;
+  void SetFrameStats(engine::FrameStats* frame_stats) noexcept override;
 private:
   void RecreateSwapchain();
-  std::pair<Swapchain, Image> CreateSwapchainAndDepthImage() const;
-  std::pair<std::vector<SwapchainFramebuffer>, std::vector<SyncObject>> CreateSwapchainImagesAndSyncObjects() const;
+  std::pair<Swapchain, Image> CreateSwapchainAndDepthImage(VkSwapchainKHR old_swapchain) const;
+  std::vector<SwapchainFramebuffer> CreateSwapchainFramebuffers() const;
+  std::vector<SyncObject> CreateSyncObjects() const;
+
+  void SetObject(std::unique_ptr<Object> object);
+  void SwapObject();
+  void FulfilDrawnPromises();
+  void UpdateSamplers();
+
+  [[nodiscard]] std::vector<Shader> CreateShaders(const std::vector<ShaderInfo>& shader_infos) const;
+  [[nodiscard]] DeviceHandle<VkPipeline> CreatePipeline(const std::vector<ShaderInfo>& shader_infos) const;
+  [[nodiscard]] DeviceHandle<VkPipeline> CreateDepthPipeline(const std::vector<ShaderInfo>& shader_infos) const;
+  [[nodiscard]] DeviceHandle<VkPipeline> CreateCullPipeline(const std::vector<ShaderInfo>& shader_infos) const;
+#ifdef ENGINE_SHADER_HOT_RELOAD
+  void ReloadPipeline();
+  void SwapPipeline();
+#endif // ENGINE_SHADER_HOT_RELOAD
 
   void UpdateUniforms() const;
+  void SortDraws();
+  void SelectLod();
+  void CullMeshlets(VkCommandBuffer cmd_buffer) const;
+  void DrawRange(VkCommandBuffer cmd_buffer, size_t range_idx) const;
   void RecordCommandBuffer(VkCommandBuffer cmd_buffer, size_t image_idx);
+  void BeginRendering(VkCommandBuffer cmd_buffer, size_t image_idx) const;
+  void EndRendering(VkCommandBuffer cmd_buffer, size_t image_idx) const;
 
   Window& window_;
   size_t frame_count_;
+  VkPresentModeKHR present_mode_;
+  bool depth_prepass_;
+  bool sort_draws_;
+  bool gpu_culling_;
+  size_t lod_count_;
+  std::optional<size_t> forced_lod_;
+  bool compress_textures_;
+  bool stream_textures_;
+  bool virtual_textures_;
+  size_t geometry_chunk_budget_;
 
   bool framebuffer_resized_;
   mutable size_t curr_frame_;
+  size_t frame_number_;
 
   Instance instance_;
 #ifdef DEBUG
@@ -70,19 +132,54 @@ private:
 
   DeviceHandle<VkCommandPool> cmd_pool_;
   std::vector<VkCommandBuffer> cmd_buffers_;
-
+  GpuTimer gpu_timer_;
+
+  PipelineCache pipeline_cache_;
+  TextureCache texture_cache_;
+  std::unique_ptr<StagingRing> staging_ring_;
+  // null unless textures are streamed
+  std::unique_ptr<TextureStreamer> texture_streamer_;
+  // null unless materials are virtual textures
+  std::unique_ptr<TileCache> tile_cache_;
+  DeviceHandle<VkDescriptorSetLayout> uniform_layout_;
+  DeviceHandle<VkDescriptorSetLayout> sampler_layout_;
   DeviceHandle<VkPipelineLayout> pipeline_layout_;
   DeviceHandle<VkPipeline> pipeline_;
-
-  Object object_;
+  DeviceHandle<VkPipeline> depth_pipeline_;
+  DeviceHandle<VkDescriptorSetLayout> cull_layout_;
+  DeviceHandle<VkPipelineLayout> cull_pipeline_layout_;
+  DeviceHandle<VkPipeline> cull_pipeline_;
+#ifdef ENGINE_SHADER_HOT_RELOAD
+  std::mutex pending_pipeline_mutex_;
+  // compiled by the watcher, empty until a reload is pending
+  std::vector<ShaderInfo> pending_infos_;
+  std::vector<ShaderInfo> pending_depth_infos_;
+  std::vector<ShaderInfo> pending_cull_infos_;
+  std::unique_ptr<ShaderWatcher> shader_watcher_;
+#endif // ENGINE_SHADER_HOT_RELOAD
+
+  std::unique_ptr<Object> object_;
   std::vector<Uniforms*> uniforms_buff_;
+  std::vector<size_t> draw_order_;
+  std::vector<float> draw_distances_;
+  size_t lod_;
   engine::Model model_;
+  engine::FrameStats* frame_stats_;
+
+  std::mutex pending_objects_mutex_;
+  std::vector<PendingObject> pending_objects_;
+  std::vector<DrawnPromise> drawn_promises_;
+  std::vector<std::future<void>> load_tasks_;
 };
 
 inline engine::Model& Renderer::GetModel() noexcept {
   return model_;
 }
 
+inline void Renderer::SetFrameStats(engine::FrameStats* frame_stats) noexcept {
+  frame_stats_ = frame_stats;
+}
+
 } // namespace vk
 
 #endif // BACKEND_VK_RENDERER_RENDERER_H_
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "backend/vk/renderer/shader.h"
+
+#include <iterator>
+
+#include "trace/trace.h"
+
+#ifdef ENGINE_SHADER_HOT_RELOAD
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include <shaderc/shaderc.hpp>
+
+#include "backend/vk/renderer/error.h"
+#endif // ENGINE_SHADER_HOT_RELOAD
+
+namespace vk {
+
+namespace {
+
+constexpr uint32_t kSimpleVertSpirv[] = {
+#include "shaders/simple.vert.inc"
+};
+
+constexpr uint32_t kSimpleFragSpirv[] = {
+#include "shaders/simple.frag.inc"
+};
+
+constexpr uint32_t kDepthVertSpirv[] = {
+#include "shaders/depth.vert.inc"
+};
+
+constexpr uint32_t kCullCompSpirv[] = {
+#include "shaders/cull.comp.inc"
+};
+
+constexpr uint32_t kVirtualFragSpirv[] = {
+#include "shaders/virtual.frag.inc"
+};
+
+template <size_t N>
+std::vector<uint32_t> ToVector(const uint32_t (&spirv)[N]) {
+  return {std::begin(spirv), std::end(spirv)};
+}
+
+#ifdef ENGINE_SHADER_HOT_RELOAD
+
+std::string ReadSource(const std::string& path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw Error("failed to open shader source: " + path);
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  return stream.str();
+}
+
+// Last compiled revision of a shader, a source that did not change is not compiled again.
+struct CompiledShader {
+  shaderc_shader_kind kind;
+  std::string source;
+  std::vector<uint32_t> spirv;
+};
+
+std::vector<uint32_t> CompileToSpv(const shaderc::Compiler& compiler, shaderc_shader_kind kind, const std::string& name) {
+  static std::mutex cache_mutex;
+  static std::unordered_map<std::string, CompiledShader> cache;
+
+  std::string source = ReadSource(std::string(ENGINE_SHADER_DIR) + "/" + name);
+  {
+    std::lock_guard lock(cache_mutex);
+    if (const auto it = cache.find(name); it != cache.end() && it->second.kind == kind && it->second.source == source) {
+      return it->second.spirv;
+    }
+  }
+  shaderc::CompileOptions options;
+  options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+  const shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source, kind, name.c_str(), options);
+  if (module.GetCompilationStatus() != shaderc_compilation_status_success) {
+    throw Error("failed to compile shaders: " + module.GetErrorMessage());
+  }
+  std::vector<uint32_t> spirv(module.cbegin(), module.cend());
+
+  std::lock_guard lock(cache_mutex);
+  cache[name] = CompiledShader{kind, std::move(source), spirv};
+  return spirv;
+}
+
+#endif // ENGINE_SHADER_HOT_RELOAD
+
+} // namespace
+
+std::vector<ShaderInfo> Shader::GetInfos() {
+  TRACE_ZONE("Shader::GetInfos");
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_VERTEX_BIT, "main"},
+      ToVector(kSimpleVertSpirv)
+    },
+    {
+      ShaderDescription{VK_SHADER_STAGE_FRAGMENT_BIT, "main"},
+      ToVector(kSimpleFragSpirv)
+    }
+  };
+}
+
+std::vector<ShaderInfo> Shader::GetDepthInfos() {
+  TRACE_ZONE("Shader::GetDepthInfos");
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_VERTEX_BIT, "main"},
+      ToVector(kDepthVertSpirv)
+    }
+  };
+}
+
+std::vector<ShaderInfo> Shader::GetCullInfos() {
+  TRACE_ZONE("Shader::GetCullInfos");
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_COMPUTE_BIT, "main"},
+      ToVector(kCullCompSpirv)
+    }
+  };
+}
+
+std::vector<ShaderInfo> Shader::GetVirtualInfos() {
+  TRACE_ZONE("Shader::GetVirtualInfos");
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_VERTEX_BIT, "main"},
+      ToVector(kSimpleVertSpirv)
+    },
+    {
+      ShaderDescription{VK_SHADER_STAGE_FRAGMENT_BIT, "main"},
+      ToVector(kVirtualFragSpirv)
+    }
+  };
+}
+
+#ifdef ENGINE_SHADER_HOT_RELOAD
+
+std::vector<ShaderInfo> Shader::CompileInfos() {
+  TRACE_ZONE("Shader::CompileInfos");
+  shaderc::Compiler compiler;
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_VERTEX_BIT, "main"},
+      CompileToSpv(compiler, shaderc_vertex_shader, "simple.vert")
+    },
+    {
+      ShaderDescription{VK_SHADER_STAGE_FRAGMENT_BIT, "main"},
+      CompileToSpv(compiler, shaderc_fragment_shader, "simple.frag")
+    }
+  };
+}
+
+std::vector<ShaderInfo> Shader::CompileDepthInfos() {
+  TRACE_ZONE("Shader::CompileDepthInfos");
+  shaderc::Compiler compiler;
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_VERTEX_BIT, "main"},
+      CompileToSpv(compiler, shaderc_vertex_shader, "depth.vert")
+    }
+  };
+}
+
+std::vector<ShaderInfo> Shader::CompileCullInfos() {
+  TRACE_ZONE("Shader::CompileCullInfos");
+  shaderc::Compiler compiler;
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_COMPUTE_BIT, "main"},
+      CompileToSpv(compiler, shaderc_compute_shader, "cull.comp")
+    }
+  };
+}
+
+std::vector<ShaderInfo> Shader::CompileVirtualInfos() {
+  TRACE_ZONE("Shader::CompileVirtualInfos");
+  shaderc::Compiler compiler;
+  return {
+    {
+      ShaderDescription{VK_SHADER_STAGE_VERTEX_BIT, "main"},
+      CompileToSpv(compiler, shaderc_vertex_shader, "simple.vert")
+    },
+    {
+      ShaderDescription{VK_SHADER_STAGE_FRAGMENT_BIT, "main"},
+      CompileToSpv(compiler, shaderc_fragment_shader, "virtual.frag")
+    }
+  };
+}
+
+#endif // ENGINE_SHADER_HOT_RELOAD
+
+} // namespace vk
@@ -22,6 +22,15 @@ struct ShaderInfo {
 
 struct Shader {
   static std::vector<ShaderInfo> GetInfos();
+  static std::vector<ShaderInfo> GetDepthInfos();
+  static std::vector<ShaderInfo> GetCullInfos();
+  static std::vector<ShaderInfo> GetVirtualInfos();
+#ifdef ENGINE_SHADER_HOT_RELOAD
+  static std::vector<ShaderInfo> CompileInfos();
+  static std::vector<ShaderInfo> CompileDepthInfos();
+  static std::vector<ShaderInfo> CompileCullInfos();
+  static std::vector<ShaderInfo> CompileVirtualInfos();
+#endif // ENGINE_SHADER_HOT_RELOAD
 
   DeviceHandle<VkShaderModule> module;
   ShaderDescription description;
@@ -0,0 +1,95 @@
+#include "backend/vk/renderer/shader_watcher.h"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include "backend/vk/renderer/error.h"
+
+namespace vk {
+
+namespace {
+
+constexpr int kPollTimeoutMs = 100;
+constexpr int kDebounceMs = 50;
+
+bool IsShaderSource(const std::string_view name) {
+  const size_t dot = name.rfind('.');
+  if (dot == std::string_view::npos) {
+    return false;
+  }
+  const std::string_view extension = name.substr(dot);
+  return extension == ".vert" || extension == ".frag";
+}
+
+} // namespace
+
+ShaderWatcher::ShaderWatcher(const std::string& dir, Callback callback)
+  : inotify_fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+    watch_fd_(-1),
+    callback_(std::move(callback)),
+    running_(true) {
+  if (inotify_fd_ < 0) {
+    throw Error(std::string("failed to init inotify: ") + std::strerror(errno));
+  }
+  watch_fd_ = inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if (watch_fd_ < 0) {
+    close(inotify_fd_);
+    throw Error("failed to watch shader directory " + dir + ": " + std::strerror(errno));
+  }
+  thread_ = std::thread(&ShaderWatcher::Run, this);
+}
+
+ShaderWatcher::~ShaderWatcher() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  inotify_rm_watch(inotify_fd_, watch_fd_);
+  close(inotify_fd_);
+}
+
+bool ShaderWatcher::ReadEvents() const {
+  alignas(inotify_event) std::array<char, 4096> buffer;
+  bool changed = false;
+  ssize_t length;
+  while ((length = read(inotify_fd_, buffer.data(), buffer.size())) > 0) {
+    for (ssize_t offset = 0; offset < length;) {
+      const auto event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+      if (event->len > 0 && IsShaderSource(event->name)) {
+        changed = true;
+      }
+      offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+    }
+  }
+  return changed;
+}
+
+void ShaderWatcher::Run() const {
+  pollfd poll_fd = {};
+  poll_fd.fd = inotify_fd_;
+  poll_fd.events = POLLIN;
+
+  while (running_) {
+    if (poll(&poll_fd, 1, kPollTimeoutMs) <= 0 || !ReadEvents()) {
+      continue;
+    }
+    // Editors tend to save through several writes and renames, so let the
+    // burst settle before recompiling.
+    std::this_thread::sleep_for(std::chrono::milliseconds(kDebounceMs));
+    [[maybe_unused]] const bool drained = ReadEvents();
+    try {
+      callback_();
+    } catch (const std::exception& error) {
+      std::cerr << "shader reload failed: " << error.what() << std::endl;
+    }
+  }
+}
+
+} // namespace vk
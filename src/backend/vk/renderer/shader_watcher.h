@@ -0,0 +1,33 @@
+#ifndef BACKEND_VK_RENDERER_SHADER_WATCHER_H_
+#define BACKEND_VK_RENDERER_SHADER_WATCHER_H_
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace vk {
+
+class ShaderWatcher final {
+public:
+  using Callback = std::function<void()>;
+
+  ShaderWatcher(const std::string& dir, Callback callback);
+  ShaderWatcher(const ShaderWatcher&) = delete;
+  ~ShaderWatcher();
+
+  ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+private:
+  void Run() const;
+  [[nodiscard]] bool ReadEvents() const;
+
+  int inotify_fd_;
+  int watch_fd_;
+  Callback callback_;
+  std::atomic_bool running_;
+  std::thread thread_;
+};
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_SHADER_WATCHER_H_
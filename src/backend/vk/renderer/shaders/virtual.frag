@@ -0,0 +1,61 @@
+#version 450
+
+const uint kTileSize = 128;
+const uint kTileBorder = 4;
+const uint kTileStride = kTileSize + 2 * kTileBorder;
+const uint kSlotColumns = 30;
+// one fragment of every 4x4 block reports the page it wanted
+const uint kFeedbackStride = 4;
+
+layout(set = 1, binding = 0) uniform usampler2D pageTable;
+layout(set = 1, binding = 1) uniform sampler2D tileCache;
+layout(set = 1, binding = 2) uniform VirtualTexture {
+    vec2 size;
+    uint levelCount;
+    uvec4 levelOffsets[4];
+} params;
+layout(set = 1, binding = 3) buffer Feedback {
+    uint pages[];
+} feedback;
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+uvec2 GetPage(vec2 texel, uint level) {
+    uvec2 page = uvec2(texel / float(kTileSize << level));
+    return min(page, uvec2(textureSize(pageTable, int(level)) - 1));
+}
+
+vec4 SampleLevel(vec2 uv, uint level) {
+    vec2 texel = uv * params.size;
+    uint entry = texelFetch(pageTable, ivec2(GetPage(texel, level)), int(level)).r;
+    uint slot = entry & 0xffffu;
+    uint residentLevel = entry >> 16;
+
+    vec2 inTile = clamp(texel / float(1u << residentLevel) - vec2(GetPage(texel, residentLevel) * kTileSize), vec2(0.0), vec2(kTileSize));
+    vec2 slotOrigin = vec2(slot % kSlotColumns, slot / kSlotColumns) * float(kTileStride);
+    return textureLod(tileCache, (slotOrigin + float(kTileBorder) + inTile) / vec2(textureSize(tileCache, 0)), 0.0);
+}
+
+void main() {
+    vec2 texel = fragTexCoord * params.size;
+    float lod = log2(max(max(length(dFdx(texel)), length(dFdy(texel))), 1.0));
+    lod = min(lod, float(params.levelCount - 1));
+    uint level = uint(lod);
+    uint nextLevel = min(level + 1, params.levelCount - 1);
+
+    vec2 uv = fract(fragTexCoord);
+    outColor = mix(SampleLevel(uv, level), SampleLevel(uv, nextLevel), fract(lod));
+
+    uvec2 pixel = uvec2(gl_FragCoord.xy);
+    if (pixel.x % kFeedbackStride == 0 && pixel.y % kFeedbackStride == 0) {
+        uvec2 page = GetPage(uv * params.size, level);
+        uint bit = params.levelOffsets[level / 4][level % 4] + page.y * uint(textureSize(pageTable, int(level)).x) + page.x;
+        uint mask = 1u << (bit % 32);
+        if ((feedback.pages[bit / 32] & mask) == 0) {
+            atomicOr(feedback.pages[bit / 32], mask);
+        }
+    }
+}
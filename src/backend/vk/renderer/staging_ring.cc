@@ -0,0 +1,117 @@
+#include "backend/vk/renderer/staging_ring.h"
+
+#include <optional>
+#include <utility>
+
+#include "trace/trace.h"
+
+namespace vk {
+
+namespace {
+
+// Covers the texel block size of every format and the 4 byte alignment of buffer to image copies.
+constexpr VkDeviceSize kAlignment = 16;
+
+VkDeviceSize AlignUp(const VkDeviceSize value) noexcept {
+  return (value + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+} // namespace
+
+StagingRing::Region::Region(Region&& other) noexcept
+  : ring_(std::exchange(other.ring_, nullptr)),
+    buffer_(std::move(other.buffer_)),
+    offset_(other.offset_),
+    data_(std::exchange(other.data_, nullptr)) {}
+
+StagingRing::Region::~Region() {
+  Release();
+}
+
+StagingRing::Region& StagingRing::Region::operator=(Region&& other) noexcept {
+  if (this != &other) {
+    Release();
+    ring_ = std::exchange(other.ring_, nullptr);
+    buffer_ = std::move(other.buffer_);
+    offset_ = other.offset_;
+    data_ = std::exchange(other.data_, nullptr);
+  }
+  return *this;
+}
+
+void StagingRing::Region::Release() noexcept {
+  if (ring_ != nullptr) {
+    ring_->Release(offset_);
+    ring_ = nullptr;
+  }
+  buffer_ = Buffer();
+  data_ = nullptr;
+}
+
+StagingRing::StagingRing(const Device& device, const VkDeviceSize size)
+  : device_(device),
+    buffer_(device.CreateBuffer(
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      size
+    )),
+    data_(static_cast<uint8_t*>(buffer_.memory().Map())),
+    size_(size),
+    head_(0) {}
+
+StagingRing::Region StagingRing::Allocate(const VkDeviceSize size) {
+  TRACE_ZONE("StagingRing::Allocate");
+  Region region;
+  {
+    std::lock_guard lock(mutex_);
+    const VkDeviceSize head = AlignUp(head_);
+    std::optional<VkDeviceSize> offset;
+    if (blocks_.empty()) {
+      if (size <= size_) {
+        offset = 0;
+      }
+    } else if (blocks_.back().offset >= blocks_.front().offset) {
+      // the free space runs from the head to the end of the buffer and on from its start to the oldest region
+      if (head + size <= size_) {
+        offset = head;
+      } else if (size <= blocks_.front().offset) {
+        offset = 0;
+      }
+    } else if (head + size <= blocks_.front().offset) {
+      offset = head;
+    }
+    if (offset) {
+      blocks_.push_back({*offset, false});
+      head_ = *offset + size;
+      region.ring_ = this;
+      region.offset_ = *offset;
+      region.data_ = data_ + *offset;
+      return region;
+    }
+  }
+  region.buffer_ = device_.CreateBuffer(
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    size
+  );
+  region.data_ = static_cast<uint8_t*>(region.buffer_.memory().Map());
+  return region;
+}
+
+void StagingRing::Release(const VkDeviceSize offset) noexcept {
+  std::lock_guard lock(mutex_);
+  for (Block& block : blocks_) {
+    if (block.offset == offset && !block.released) {
+      block.released = true;
+      break;
+    }
+  }
+  while (!blocks_.empty() && blocks_.front().released) {
+    blocks_.pop_front();
+  }
+  if (blocks_.empty()) {
+    head_ = 0;
+  }
+}
+
+} // namespace vk
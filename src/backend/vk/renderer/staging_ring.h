@@ -0,0 +1,93 @@
+#ifndef BACKEND_VK_RENDERER_STAGING_RING_H_
+#define BACKEND_VK_RENDERER_STAGING_RING_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "backend/vk/renderer/buffer.h"
+#include "backend/vk/renderer/device.h"
+
+namespace vk {
+
+// One persistently mapped host visible buffer that texture uploads are staged in, so loading a texture neither allocates
+// a buffer of its own nor maps one. Regions are handed out front to back and their space comes back once every region
+// handed out before them is released too. Thread safe.
+class StagingRing final {
+public:
+  // Released when destroyed, which its owner does once the upload reading it has completed.
+  class Region final {
+  public:
+    Region() noexcept = default;
+    Region(const Region&) = delete;
+    Region(Region&& other) noexcept;
+    ~Region();
+
+    Region& operator=(const Region&) = delete;
+    Region& operator=(Region&& other) noexcept;
+
+    explicit operator bool() const noexcept;
+
+    [[nodiscard]] const Buffer& buffer() const noexcept;
+    [[nodiscard]] VkDeviceSize offset() const noexcept;
+    [[nodiscard]] uint8_t* data() const noexcept;
+  private:
+    friend class StagingRing;
+
+    StagingRing* ring_ = nullptr;
+    // only for regions that did not fit the ring
+    Buffer buffer_;
+    VkDeviceSize offset_ = 0;
+    uint8_t* data_ = nullptr;
+
+    void Release() noexcept;
+  };
+
+  StagingRing(const Device& device, VkDeviceSize size);
+  StagingRing(const StagingRing&) = delete;
+  ~StagingRing() = default;
+
+  StagingRing& operator=(const StagingRing&) = delete;
+
+  // A region larger than the free part of the ring gets a buffer of its own rather than waiting for space.
+  [[nodiscard]] Region Allocate(VkDeviceSize size);
+private:
+  struct Block {
+    VkDeviceSize offset;
+    bool released;
+  };
+
+  void Release(VkDeviceSize offset) noexcept;
+
+  const Device& device_;
+  Buffer buffer_;
+  uint8_t* data_;
+  VkDeviceSize size_;
+
+  std::mutex mutex_;
+  // live regions in the order they were handed out, the oldest one marks where the free space ends
+  std::deque<Block> blocks_;
+  VkDeviceSize head_;
+};
+
+inline StagingRing::Region::operator bool() const noexcept {
+  return data_ != nullptr;
+}
+
+inline const Buffer& StagingRing::Region::buffer() const noexcept {
+  return ring_ != nullptr ? ring_->buffer_ : buffer_;
+}
+
+inline VkDeviceSize StagingRing::Region::offset() const noexcept {
+  return offset_;
+}
+
+inline uint8_t* StagingRing::Region::data() const noexcept {
+  return data_;
+}
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_STAGING_RING_H_
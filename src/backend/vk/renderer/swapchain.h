@@ -3,6 +3,7 @@
 
 #include <vulkan/vulkan.h>
 
+#include <string_view>
 #include <vector>
 
 #include "backend/vk/renderer/handle.h"
@@ -16,14 +17,16 @@ public:
   [[nodiscard]] std::vector<VkImage> images() const;
   [[nodiscard]] VkExtent2D extent() const noexcept;
   [[nodiscard]] VkFormat format() const noexcept;
+  [[nodiscard]] VkPresentModeKHR present_mode() const noexcept;
 private:
   friend class Device;
 
   VkExtent2D extent_;
   VkFormat format_;
+  VkPresentModeKHR present_mode_;
 
-  explicit Swapchain(DeviceHandle<VkSwapchainKHR>&& swapchain, const VkExtent2D extent, const VkFormat format) noexcept
-    : DeviceHandle<VkSwapchainKHR>(std::move(swapchain)), extent_(extent), format_(format) {}
+  explicit Swapchain(DeviceHandle<VkSwapchainKHR>&& swapchain, const VkExtent2D extent, const VkFormat format, const VkPresentModeKHR present_mode) noexcept
+    : DeviceHandle<VkSwapchainKHR>(std::move(swapchain)), extent_(extent), format_(format), present_mode_(present_mode) {}
 };
 
 inline VkExtent2D Swapchain::extent() const noexcept {
@@ -34,6 +37,25 @@ inline VkFormat Swapchain::format() const noexcept {
   return format_;
 }
 
+inline VkPresentModeKHR Swapchain::present_mode() const noexcept {
+  return present_mode_;
+}
+
+constexpr std::string_view PresentModeName(const VkPresentModeKHR present_mode) noexcept {
+  switch (present_mode) {
+    case VK_PRESENT_MODE_FIFO_KHR:
+      return "fifo";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      return "mailbox";
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      return "immediate";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+      return "fifo_relaxed";
+    default:
+      return "unknown";
+  }
+}
+
 } // namespace vk
 
 #endif // BACKEND_VK_RENDERER_SWAPCHAIN_H_
@@ -0,0 +1,66 @@
+#include "backend/vk/renderer/texture_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+#include "trace/trace.h"
+
+namespace vk {
+
+namespace {
+
+// Enough levels for any image the device can create, the view clamps sampling to the levels an image has.
+constexpr uint32_t kMaxMipLevels = 32;
+
+} // namespace
+
+std::string TextureCache::GetKey(const std::string& path) {
+  TRACE_ZONE("TextureCache::GetKey");
+  std::error_code error_code;
+  const std::filesystem::path canonical_path = std::filesystem::canonical(path, error_code);
+  if (error_code) {
+    return {};
+  }
+  std::ifstream file(canonical_path, std::ios::binary);
+  if (!file) {
+    return {};
+  }
+  const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return canonical_path.string() + '#' + std::to_string(std::hash<std::string_view>{}(contents));
+}
+
+TextureCache::TextureCache(const Device& device)
+  : mutex_(std::make_unique<std::mutex>()),
+    sampler_(std::make_shared<DeviceHandle<VkSampler>>(device.CreateSampler(VK_SAMPLER_MIPMAP_MODE_LINEAR, kMaxMipLevels))) {}
+
+std::shared_ptr<const TextureImage> TextureCache::Find(const std::string& key) const {
+  std::lock_guard lock(*mutex_);
+  if (key.empty()) {
+    return fallback_;
+  }
+  const auto it = images_.find(key);
+  return it == images_.end() ? nullptr : it->second.lock();
+}
+
+std::shared_ptr<const TextureImage> TextureCache::Insert(const std::string& key, std::shared_ptr<TextureImage> image) {
+  std::lock_guard lock(*mutex_);
+  if (key.empty()) {
+    if (!fallback_) {
+      fallback_ = std::move(image);
+    }
+    return fallback_;
+  }
+  for (auto it = images_.begin(); it != images_.end();) {
+    it = it->second.expired() ? images_.erase(it) : std::next(it);
+  }
+  std::weak_ptr<const TextureImage>& cached = images_[key];
+  if (std::shared_ptr<const TextureImage> existing = cached.lock()) {
+    return existing;
+  }
+  cached = image;
+  return image;
+}
+
+} // namespace vk
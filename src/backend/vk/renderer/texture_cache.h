@@ -0,0 +1,44 @@
+#ifndef BACKEND_VK_RENDERER_TEXTURE_CACHE_H_
+#define BACKEND_VK_RENDERER_TEXTURE_CACHE_H_
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "backend/vk/renderer/device.h"
+#include "backend/vk/renderer/handle.h"
+#include "backend/vk/renderer/image.h"
+
+namespace vk {
+
+// Uploaded textures shared by every material and model referring to the same file, an image lives while a descriptor set holds it.
+class TextureCache final {
+public:
+  // Canonical path and content hash, an edited file gets a new key. Empty for unreadable paths, which names the fallback texture.
+  [[nodiscard]] static std::string GetKey(const std::string& path);
+
+  TextureCache() noexcept = default;
+  explicit TextureCache(const Device& device);
+
+  [[nodiscard]] std::shared_ptr<const DeviceHandle<VkSampler>> sampler() const noexcept;
+
+  [[nodiscard]] std::shared_ptr<const TextureImage> Find(const std::string& key) const;
+  // Returns the image cached meanwhile by another loader when there is one. The fallback stays cached for the lifetime of the cache.
+  std::shared_ptr<const TextureImage> Insert(const std::string& key, std::shared_ptr<TextureImage> image);
+private:
+  std::unique_ptr<std::mutex> mutex_;
+  std::unordered_map<std::string, std::weak_ptr<const TextureImage>> images_;
+  std::shared_ptr<const TextureImage> fallback_;
+  std::shared_ptr<const DeviceHandle<VkSampler>> sampler_;
+};
+
+inline std::shared_ptr<const DeviceHandle<VkSampler>> TextureCache::sampler() const noexcept {
+  return sampler_;
+}
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_TEXTURE_CACHE_H_
@@ -0,0 +1,114 @@
+#include "backend/vk/renderer/texture_streamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "backend/vk/renderer/commander.h"
+#include "backend/vk/renderer/error.h"
+#include "trace/trace.h"
+
+namespace vk {
+
+TextureStreamer::TextureStreamer(const Device& device, StagingRing& staging_ring, const VkDeviceSize frame_budget)
+  : device_(device),
+    staging_ring_(staging_ring),
+    cmd_pool_(device.CreateCommandPool()),
+    frame_budget_(static_cast<int64_t>(frame_budget)),
+    credit_(0),
+    running_(true) {
+  thread_ = std::thread(&TextureStreamer::Run, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+  {
+    std::lock_guard lock(mutex_);
+    running_ = false;
+  }
+  condition_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void TextureStreamer::Push(const std::shared_ptr<TextureImage>& image, texture::Texture&& texture) {
+  {
+    std::lock_guard lock(mutex_);
+    requests_.push_back({image, std::move(texture)});
+  }
+  condition_.notify_one();
+}
+
+void TextureStreamer::OnFrame() {
+  {
+    std::lock_guard lock(mutex_);
+    credit_ = std::min(credit_ + frame_budget_, frame_budget_);
+  }
+  condition_.notify_one();
+}
+
+void TextureStreamer::Run() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] {
+      return !running_ || (!requests_.empty() && credit_ > 0);
+    });
+    if (!running_) {
+      return;
+    }
+    Request request = std::move(requests_.front());
+    requests_.pop_front();
+
+    const std::shared_ptr<TextureImage> image = request.image.lock();
+    if (image == nullptr) {
+      continue;
+    }
+    const uint32_t level = image->resident_level.load(std::memory_order_relaxed) - 1;
+    credit_ -= static_cast<int64_t>(request.texture.levels[level].size);
+
+    lock.unlock();
+    try {
+      UploadLevel(*image, request.texture, level);
+    } catch (const Error& error) {
+      // the image keeps the levels it has, rendering goes on with them
+      std::clog << "failed to stream texture level: " << error.what() << std::endl;
+      lock.lock();
+      continue;
+    }
+    lock.lock();
+
+    // round robin, every image gains its next level before any gains two
+    if (level != 0) {
+      requests_.push_back(std::move(request));
+    }
+  }
+}
+
+void TextureStreamer::UploadLevel(TextureImage& image, const texture::Texture& texture, const uint32_t level) const {
+  TRACE_ZONE("TextureStreamer::UploadLevel");
+  const texture::Level& texture_level = texture.levels[level];
+
+  const StagingRing::Region staging = staging_ring_.Allocate(texture_level.size);
+  std::memcpy(staging.data(), texture.data.data() + texture_level.offset, texture_level.size);
+
+  VkBufferImageCopy region = {};
+  region.bufferOffset = staging.offset();
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = level;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {texture_level.width, texture_level.height, 1};
+  {
+    ImageCommander commander(image.image, cmd_pool_.handle(), device_.graphics_queue().handle, device_.queue_mutex());
+    CommanderGuard commander_guard(commander);
+
+    commander.TransitImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, level, 1);
+    commander.CopyBufferRegions(staging.buffer(), {region});
+    commander.TransitImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, level, 1);
+  }
+  // the commander waited for the copy, the render thread picks the level up when it next rewrites the frame's descriptor sets
+  image.resident_level.store(level, std::memory_order_release);
+}
+
+} // namespace vk
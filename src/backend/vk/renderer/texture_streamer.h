@@ -0,0 +1,59 @@
+#ifndef BACKEND_VK_RENDERER_TEXTURE_STREAMER_H_
+#define BACKEND_VK_RENDERER_TEXTURE_STREAMER_H_
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "backend/vk/renderer/device.h"
+#include "backend/vk/renderer/handle.h"
+#include "backend/vk/renderer/image.h"
+#include "backend/vk/renderer/staging_ring.h"
+#include "texture/texture.h"
+
+namespace vk {
+
+// Uploads the levels above the resident tail of loaded images on a worker thread, one level at a time and smallest
+// first, spending about frame_budget bytes per rendered frame. Images released before they are complete are dropped.
+class TextureStreamer final {
+public:
+  TextureStreamer(const Device& device, StagingRing& staging_ring, VkDeviceSize frame_budget);
+  TextureStreamer(const TextureStreamer&) = delete;
+  ~TextureStreamer();
+
+  TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+  // texture holds every level of image, including the resident ones.
+  void Push(const std::shared_ptr<TextureImage>& image, texture::Texture&& texture);
+  // Grants the worker the budget of the next frame, bytes not spent are not carried over.
+  void OnFrame();
+private:
+  struct Request {
+    std::weak_ptr<TextureImage> image;
+    texture::Texture texture;
+  };
+
+  void Run();
+  void UploadLevel(TextureImage& image, const texture::Texture& texture, uint32_t level) const;
+
+  const Device& device_;
+  StagingRing& staging_ring_;
+  DeviceHandle<VkCommandPool> cmd_pool_;
+  // a level larger than the budget is uploaded on credit and repaid by the following frames
+  int64_t frame_budget_;
+  int64_t credit_;
+  bool running_;
+  std::deque<Request> requests_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread thread_;
+};
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_TEXTURE_STREAMER_H_
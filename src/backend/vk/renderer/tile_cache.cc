@@ -0,0 +1,554 @@
+#include "backend/vk/renderer/tile_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+
+#include "backend/vk/renderer/commander.h"
+#include "backend/vk/renderer/error.h"
+#include "texture/error.h"
+#include "trace/trace.h"
+
+namespace vk {
+
+namespace {
+
+// Slots per side of the cache image, 30 tiles of 136 texels stay within a 4096 texel image.
+constexpr uint32_t kSlotColumns = 30;
+constexpr uint32_t kSlotCount = kSlotColumns * kSlotColumns;
+constexpr uint32_t kWhiteSlot = 0;
+constexpr uint32_t kNoSlot = UINT32_MAX;
+// Tiles copied into the cache per frame and tiles requested from the loader at once.
+constexpr size_t kMaxTileUploads = 16;
+constexpr size_t kMaxPendingTiles = 64;
+constexpr VkDeviceSize kPageTableStagingSize = 4 << 20;
+constexpr VkFormat kTileFormat = VK_FORMAT_R8G8B8A8_SRGB;
+constexpr VkFormat kPageTableFormat = VK_FORMAT_R32_UINT;
+
+// Page table entries keep the slot in the low 16 bits and the level of its tile above them.
+uint32_t GetEntry(const uint32_t slot, const uint32_t level) noexcept {
+  return slot | level << 16;
+}
+
+std::vector<VkBufferImageCopy> GetPageTableRegions(const texture::TileLayout& layout, const VkDeviceSize offset) {
+  std::vector<VkBufferImageCopy> regions(layout.level_count);
+  for (uint32_t level = 0; level < layout.level_count; ++level) {
+    regions[level].bufferOffset = offset + layout.FirstTile(level) * sizeof(uint32_t);
+    regions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    regions[level].imageSubresource.mipLevel = level;
+    regions[level].imageSubresource.baseArrayLayer = 0;
+    regions[level].imageSubresource.layerCount = 1;
+    regions[level].imageExtent = {layout.LevelColumns(level), layout.LevelRows(level), 1};
+  }
+  return regions;
+}
+
+VkBufferImageCopy GetTileRegion(const VkDeviceSize offset, const uint32_t slot) noexcept {
+  VkBufferImageCopy region = {};
+  region.bufferOffset = offset;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {static_cast<int32_t>(slot % kSlotColumns * texture::kTileStride), static_cast<int32_t>(slot / kSlotColumns * texture::kTileStride), 0};
+  region.imageExtent = {texture::kTileStride, texture::kTileStride, 1};
+  return region;
+}
+
+VkImageMemoryBarrier GetImageBarrier(VkImage image, const VkImageLayout old_layout, const VkImageLayout new_layout, const VkAccessFlags src_access, const VkAccessFlags dst_access) noexcept {
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  return barrier;
+}
+
+// Pages without a resident tile take the entry of the page above them, the coarsest level falls back to white.
+void BuildEntries(VirtualTexture& texture) noexcept {
+  const texture::TileLayout& layout = texture.layout;
+  for (uint32_t level = layout.level_count; level-- > 0;) {
+    const uint32_t first = layout.FirstTile(level), columns = layout.LevelColumns(level);
+    const uint32_t parent_first = layout.FirstTile(level + 1), parent_columns = layout.LevelColumns(level + 1);
+    for (uint32_t y = 0; y < layout.LevelRows(level); ++y) {
+      for (uint32_t x = 0; x < columns; ++x) {
+        const uint32_t tile = first + y * columns + x;
+        if (texture.slots[tile] != kNoSlot) {
+          texture.entries[tile] = GetEntry(texture.slots[tile], level);
+        } else if (level + 1 == layout.level_count) {
+          texture.entries[tile] = GetEntry(kWhiteSlot, level);
+        } else {
+          texture.entries[tile] = texture.entries[parent_first + y / 2 * parent_columns + x / 2];
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+TileCache::TileCache(const Device& device, const size_t frame_count)
+  : device_(device),
+    frame_count_(frame_count),
+    cmd_pool_(device.CreateCommandPool()),
+    image_(device.CreateImage(
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      VK_IMAGE_ASPECT_COLOR_BIT,
+      {kSlotColumns * texture::kTileStride, kSlotColumns * texture::kTileStride},
+      kTileFormat,
+      VK_IMAGE_TILING_OPTIMAL
+    )),
+    tile_sampler_(device.CreateClampedSampler(VK_FILTER_LINEAR)),
+    page_sampler_(device.CreateClampedSampler(VK_FILTER_NEAREST)),
+    slots_(kSlotCount, Slot{0, 0, 0, false}),
+    tick_(0),
+    next_id_(1),
+    running_(true),
+    pending_count_(0) {
+  slots_[kWhiteSlot].pinned = true;
+  for (uint32_t slot = kSlotCount - 1; slot > kWhiteSlot; --slot) {
+    free_slots_.push_back(slot);
+  }
+  for (size_t i = 0; i < frame_count; ++i) {
+    Buffer buffer = device.CreateBuffer(
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      kMaxTileUploads * texture::kTileBytes + kPageTableStagingSize
+    );
+    auto data = static_cast<uint8_t*>(buffer.memory().Map());
+    staging_.push_back({std::move(buffer), data, {}, {}});
+  }
+  const Buffer transfer_buffer = device.CreateBuffer(
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    texture::kTileBytes
+  );
+  std::memset(transfer_buffer.memory().Map(), 0xff, texture::kTileBytes);
+  transfer_buffer.memory().Unmap();
+  {
+    ImageCommander commander(image_, cmd_pool_.handle(), device.graphics_queue().handle, device.queue_mutex());
+    CommanderGuard commander_guard(commander);
+
+    commander.TransitImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    commander.CopyBufferRegions(transfer_buffer, {GetTileRegion(0, kWhiteSlot)});
+    commander.TransitImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
+  thread_ = std::thread(&TileCache::Run, this);
+}
+
+TileCache::~TileCache() {
+  {
+    std::lock_guard lock(loader_mutex_);
+    running_ = false;
+  }
+  condition_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+std::shared_ptr<VirtualTexture> TileCache::Find(const std::string& key) const {
+  std::lock_guard lock(textures_mutex_);
+  for (const auto& [id, weak_texture] : textures_) {
+    if (std::shared_ptr<VirtualTexture> texture = weak_texture.lock(); texture && texture->key == key) {
+      return texture;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<VirtualTexture> TileCache::Create(const std::string& key, std::optional<texture::TiledFile>&& file, VkCommandPool cmd_pool) {
+  TRACE_ZONE("TileCache::Create");
+  if (std::shared_ptr<VirtualTexture> texture = Find(key)) {
+    return texture;
+  }
+  auto texture = std::make_shared<VirtualTexture>();
+  texture->key = key;
+  texture->layout = file ? file->layout() : texture::GetTileLayout(1, 1);
+  texture->file = std::move(file);
+
+  const texture::TileLayout& layout = texture->layout;
+  if (layout.level_count > kMaxVirtualLevels) {
+    throw Error("virtual texture " + key + " has too many levels");
+  }
+  const uint32_t tile_count = layout.TileCount();
+  texture->slots.assign(tile_count, kNoSlot);
+  texture->requested.assign(tile_count, false);
+  texture->entries.assign(tile_count, GetEntry(kWhiteSlot, layout.level_count - 1));
+  texture->dirty = false;
+
+  VirtualTextureParams params = {};
+  params.width = static_cast<float>(layout.width);
+  params.height = static_cast<float>(layout.height);
+  params.level_count = layout.level_count;
+  for (uint32_t level = 0; level < layout.level_count; ++level) {
+    params.level_offsets[level] = layout.FirstTile(level);
+  }
+  texture->params = device_.CreateBuffer(
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    sizeof(VirtualTextureParams)
+  );
+  std::memcpy(texture->params.memory().Map(), &params, sizeof(VirtualTextureParams));
+  texture->params.memory().Unmap();
+
+  const uint32_t feedback_words = (tile_count + 31) / 32;
+  for (size_t i = 0; i < frame_count_; ++i) {
+    Buffer feedback = device_.CreateBuffer(
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      feedback_words * sizeof(uint32_t)
+    );
+    auto bits = static_cast<uint32_t*>(feedback.memory().Map());
+    std::fill_n(bits, feedback_words, 0u);
+    texture->feedback.push_back(std::move(feedback));
+    texture->feedback_bits.push_back(bits);
+  }
+
+  texture->page_table = device_.CreateImage(
+    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    VK_IMAGE_ASPECT_COLOR_BIT,
+    {layout.columns, layout.rows},
+    kPageTableFormat,
+    VK_IMAGE_TILING_OPTIMAL,
+    layout.level_count
+  );
+  const Buffer transfer_buffer = device_.CreateBuffer(
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    tile_count * sizeof(uint32_t)
+  );
+  std::memcpy(transfer_buffer.memory().Map(), texture->entries.data(), tile_count * sizeof(uint32_t));
+  transfer_buffer.memory().Unmap();
+  {
+    ImageCommander commander(texture->page_table, cmd_pool, device_.graphics_queue().handle, device_.queue_mutex());
+    CommanderGuard commander_guard(commander);
+
+    commander.TransitImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    commander.CopyBufferRegions(transfer_buffer, GetPageTableRegions(layout, 0));
+    commander.TransitImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
+  {
+    std::lock_guard lock(textures_mutex_);
+    for (const auto& [id, weak_texture] : textures_) {
+      if (std::shared_ptr<VirtualTexture> existing = weak_texture.lock(); existing && existing->key == key) {
+        return existing;
+      }
+    }
+    texture->id = next_id_++;
+    if (texture->file) {
+      texture->requested.back() = true;
+    }
+    textures_.emplace(texture->id, texture);
+  }
+  if (texture->file) {
+    // the coarsest tile replaces white as soon as it is read, whether the texture is visible yet or not
+    {
+      std::lock_guard lock(loader_mutex_);
+      requests_.push_front({texture, tile_count - 1, layout.level_count - 1});
+      ++pending_count_;
+    }
+    condition_.notify_one();
+  }
+  return texture;
+}
+
+void TileCache::WriteDescriptorSet(const VirtualTexture& texture, VkDescriptorSet set, const size_t frame) const noexcept {
+  const std::array image_infos = {
+    VkDescriptorImageInfo{page_sampler_.handle(), texture.page_table.view(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+    VkDescriptorImageInfo{tile_sampler_.handle(), image_.view(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}
+  };
+  const std::array buffer_infos = {
+    VkDescriptorBufferInfo{texture.params.handle(), 0, sizeof(VirtualTextureParams)},
+    VkDescriptorBufferInfo{texture.feedback[frame].handle(), 0, VK_WHOLE_SIZE}
+  };
+  std::array<VkWriteDescriptorSet, 4> descriptor_writes = {};
+  for (uint32_t i = 0; i < descriptor_writes.size(); ++i) {
+    descriptor_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[i].dstSet = set;
+    descriptor_writes[i].dstBinding = i;
+    descriptor_writes[i].dstArrayElement = 0;
+    descriptor_writes[i].descriptorCount = 1;
+    if (i < image_infos.size()) {
+      descriptor_writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      descriptor_writes[i].pImageInfo = &image_infos[i];
+    } else {
+      descriptor_writes[i].descriptorType = i == 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      descriptor_writes[i].pBufferInfo = &buffer_infos[i - image_infos.size()];
+    }
+  }
+  vkUpdateDescriptorSets(device_.handle(), static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
+}
+
+void TileCache::Update(const size_t frame) {
+  TRACE_ZONE("TileCache::Update");
+  ++tick_;
+  const std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>> textures = LockTextures();
+
+  std::vector<TileRequest> requests;
+  for (const auto& [id, texture] : textures) {
+    ReadFeedback(texture, frame, requests);
+  }
+  PushRequests(std::move(requests));
+
+  Staging& staging = staging_[frame];
+  // a frame that returned before recording, to recreate the swapchain, still holds what it staged
+  if (!staging.tile_copies.empty() || !staging.page_table_copies.empty()) {
+    return;
+  }
+  StageTiles(staging, textures);
+  StagePageTables(staging, textures);
+}
+
+void TileCache::Record(VkCommandBuffer cmd_buffer, const size_t frame) {
+  Staging& staging = staging_[frame];
+  if (staging.tile_copies.empty() && staging.page_table_copies.empty()) {
+    return;
+  }
+  std::vector<VkImage> images;
+  if (!staging.tile_copies.empty()) {
+    images.push_back(image_.handle());
+  }
+  for (const PageTableCopy& copy : staging.page_table_copies) {
+    images.push_back(copy.texture->page_table.handle());
+  }
+  // earlier frames only sampled the images, their reads just have to finish before the copies
+  std::vector<VkImageMemoryBarrier> barriers;
+  for (VkImage image : images) {
+    barriers.push_back(GetImageBarrier(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+  }
+  vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  if (!staging.tile_copies.empty()) {
+    vkCmdCopyBufferToImage(cmd_buffer, staging.buffer.handle(), image_.handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(staging.tile_copies.size()), staging.tile_copies.data());
+  }
+  for (const PageTableCopy& copy : staging.page_table_copies) {
+    vkCmdCopyBufferToImage(cmd_buffer, staging.buffer.handle(), copy.texture->page_table.handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copy.regions.size()), copy.regions.data());
+  }
+
+  barriers.clear();
+  for (VkImage image : images) {
+    barriers.push_back(GetImageBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+  }
+  vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  // the copies write the page tables until the frame completes, a texture released meanwhile waits for it
+  std::vector<std::shared_ptr<VirtualTexture>> copied_textures;
+  for (PageTableCopy& copy : staging.page_table_copies) {
+    copied_textures.push_back(std::move(copy.texture));
+  }
+  if (!copied_textures.empty()) {
+    device_.Retire(std::move(copied_textures));
+  }
+  staging.tile_copies.clear();
+  staging.page_table_copies.clear();
+}
+
+void TileCache::RecordFeedbackBarrier(VkCommandBuffer cmd_buffer) noexcept {
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void TileCache::Run() {
+  std::unique_lock lock(loader_mutex_);
+  while (true) {
+    condition_.wait(lock, [this] {
+      return !running_ || !requests_.empty();
+    });
+    if (!running_) {
+      return;
+    }
+    TileRequest request = std::move(requests_.front());
+    requests_.pop_front();
+    lock.unlock();
+
+    LoadedTile loaded = {request.texture, request.tile, {}};
+    if (const std::shared_ptr<VirtualTexture> texture = request.texture.lock()) {
+      loaded.texels.resize(texture::kTileBytes);
+      try {
+        texture->file->ReadTile(request.tile, loaded.texels.data());
+      } catch (const texture::Error& error) {
+        // the page keeps sampling a coarser tile and is asked for again while it stays visible
+        std::clog << "failed to read tile: " << error.what() << std::endl;
+        loaded.texels.clear();
+      }
+    }
+    lock.lock();
+    loaded_.push_back(std::move(loaded));
+  }
+}
+
+std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>> TileCache::LockTextures() {
+  std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>> textures;
+  std::vector<uint32_t> expired_ids;
+  {
+    std::lock_guard lock(textures_mutex_);
+    for (auto it = textures_.begin(); it != textures_.end();) {
+      if (std::shared_ptr<VirtualTexture> texture = it->second.lock()) {
+        textures.emplace(it->first, std::move(texture));
+        ++it;
+      } else {
+        expired_ids.push_back(it->first);
+        it = textures_.erase(it);
+      }
+    }
+  }
+  // the frames that sampled a released texture have completed, its slots are free right away
+  for (uint32_t slot = 0; slot < slots_.size() && !expired_ids.empty(); ++slot) {
+    if (std::find(expired_ids.begin(), expired_ids.end(), slots_[slot].texture_id) != expired_ids.end()) {
+      slots_[slot] = {0, 0, 0, false};
+      free_slots_.push_back(slot);
+    }
+  }
+  return textures;
+}
+
+void TileCache::ReadFeedback(const std::shared_ptr<VirtualTexture>& texture, const size_t frame, std::vector<TileRequest>& requests) {
+  if (!texture->file) {
+    return;
+  }
+  const texture::TileLayout& layout = texture->layout;
+  uint32_t* bits = texture->feedback_bits[frame];
+  const uint32_t word_count = (layout.TileCount() + 31) / 32;
+  for (uint32_t word = 0; word < word_count; ++word) {
+    for (uint32_t bit = 0; bit < 32 && bits[word] != 0; ++bit) {
+      if ((bits[word] & (1u << bit)) == 0) {
+        continue;
+      }
+      bits[word] &= ~(1u << bit);
+      const uint32_t wanted = word * 32 + bit;
+      uint32_t level = 0;
+      while (level + 1 < layout.level_count && wanted >= layout.FirstTile(level + 1)) {
+        ++level;
+      }
+      uint32_t x = (wanted - layout.FirstTile(level)) % layout.LevelColumns(level);
+      uint32_t y = (wanted - layout.FirstTile(level)) / layout.LevelColumns(level);
+      // the coarser tiles above are sampled for the blend between levels and while the wanted one loads
+      for (; level < layout.level_count; ++level, x /= 2, y /= 2) {
+        const uint32_t tile = layout.FirstTile(level) + y * layout.LevelColumns(level) + x;
+        if (texture->slots[tile] != kNoSlot) {
+          slots_[texture->slots[tile]].last_used = tick_;
+        } else if (!texture->requested[tile]) {
+          texture->requested[tile] = true;
+          requests.push_back({texture, tile, level});
+        }
+      }
+    }
+  }
+}
+
+void TileCache::PushRequests(std::vector<TileRequest>&& requests) {
+  if (requests.empty()) {
+    return;
+  }
+  // coarse tiles first, each one sharpens every page below it
+  std::stable_sort(requests.begin(), requests.end(), [](const TileRequest& lhs, const TileRequest& rhs) {
+    return lhs.level > rhs.level;
+  });
+  {
+    std::lock_guard lock(loader_mutex_);
+    for (TileRequest& request : requests) {
+      if (pending_count_ >= kMaxPendingTiles) {
+        // asked for again by the next feedback that still wants it
+        if (const std::shared_ptr<VirtualTexture> texture = request.texture.lock()) {
+          texture->requested[request.tile] = false;
+        }
+        continue;
+      }
+      requests_.push_back(std::move(request));
+      ++pending_count_;
+    }
+  }
+  condition_.notify_one();
+}
+
+std::optional<uint32_t> TileCache::AllocateSlot(const std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>>& textures) {
+  if (!free_slots_.empty()) {
+    const uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+  }
+  // tiles wanted by the feedback just read are never evicted, the cache is full when nothing else is left
+  std::optional<uint32_t> victim;
+  for (uint32_t slot = 0; slot < slots_.size(); ++slot) {
+    if (!slots_[slot].pinned && slots_[slot].last_used < tick_ && (!victim || slots_[slot].last_used < slots_[*victim].last_used)) {
+      victim = slot;
+    }
+  }
+  if (!victim) {
+    return std::nullopt;
+  }
+  if (const auto it = textures.find(slots_[*victim].texture_id); it != textures.end()) {
+    it->second->slots[slots_[*victim].tile] = kNoSlot;
+    it->second->dirty = true;
+  }
+  return victim;
+}
+
+void TileCache::StageTiles(Staging& staging, const std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>>& textures) {
+  std::vector<LoadedTile> loaded;
+  {
+    std::lock_guard lock(loader_mutex_);
+    while (!loaded_.empty() && loaded.size() < kMaxTileUploads) {
+      loaded.push_back(std::move(loaded_.front()));
+      loaded_.pop_front();
+      --pending_count_;
+    }
+  }
+  for (LoadedTile& tile : loaded) {
+    const std::shared_ptr<VirtualTexture> texture = tile.texture.lock();
+    if (texture == nullptr) {
+      continue;
+    }
+    texture->requested[tile.tile] = false;
+    if (tile.texels.empty()) {
+      continue;
+    }
+    const std::optional<uint32_t> slot = AllocateSlot(textures);
+    if (!slot) {
+      continue;
+    }
+    const VkDeviceSize offset = staging.tile_copies.size() * texture::kTileBytes;
+    std::memcpy(staging.data + offset, tile.texels.data(), texture::kTileBytes);
+    staging.tile_copies.push_back(GetTileRegion(offset, *slot));
+
+    texture->slots[tile.tile] = *slot;
+    texture->dirty = true;
+    slots_[*slot] = {texture->id, tile.tile, tick_, tile.tile + 1 == texture->layout.TileCount()};
+  }
+}
+
+// Evictions and new tiles land in the same frame as the page tables pointing at them, the staging area is sized so
+// every dirty table fits.
+void TileCache::StagePageTables(Staging& staging, const std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>>& textures) const {
+  VkDeviceSize offset = kMaxTileUploads * texture::kTileBytes;
+  const VkDeviceSize end = offset + kPageTableStagingSize;
+  for (const auto& [id, texture] : textures) {
+    const VkDeviceSize size = texture->entries.size() * sizeof(uint32_t);
+    if (!texture->dirty || offset + size > end) {
+      continue;
+    }
+    BuildEntries(*texture);
+    std::memcpy(staging.data + offset, texture->entries.data(), size);
+    staging.page_table_copies.push_back({texture, GetPageTableRegions(texture->layout, offset)});
+    texture->dirty = false;
+    offset += size;
+  }
+}
+
+} // namespace vk
@@ -0,0 +1,119 @@
+#ifndef BACKEND_VK_RENDERER_TILE_CACHE_H_
+#define BACKEND_VK_RENDERER_TILE_CACHE_H_
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "backend/vk/renderer/device.h"
+#include "backend/vk/renderer/handle.h"
+#include "backend/vk/renderer/image.h"
+#include "backend/vk/renderer/virtual_texture.h"
+#include "texture/tiled.h"
+
+namespace vk {
+
+// Physical tiles of every virtual texture, in slots of one image whose size bounds the device memory they take. Slot 0
+// is white. Tiles the shaders asked for are read from the tile files on a worker thread and copied in by the frame's
+// command buffer, evicting the least recently wanted ones. The coarsest tile of every texture stays once loaded.
+class TileCache final {
+public:
+  TileCache(const Device& device, size_t frame_count);
+  TileCache(const TileCache&) = delete;
+  ~TileCache();
+
+  TileCache& operator=(const TileCache&) = delete;
+
+  // Thread safe, a texture already registered under key is returned while it lives. Without a file the texture is white.
+  [[nodiscard]] std::shared_ptr<VirtualTexture> Find(const std::string& key) const;
+  [[nodiscard]] std::shared_ptr<VirtualTexture> Create(const std::string& key, std::optional<texture::TiledFile>&& file, VkCommandPool cmd_pool);
+
+  void WriteDescriptorSet(const VirtualTexture& texture, VkDescriptorSet set, size_t frame) const noexcept;
+
+  // After waiting for the frame's fence, reads its feedback, requests the missing tiles and stages the loaded ones.
+  void Update(size_t frame);
+  // Copies the staged tiles and page tables ahead of the frame's draws.
+  void Record(VkCommandBuffer cmd_buffer, size_t frame);
+  // Makes the feedback written by the frame's draws visible to the host once its fence has signalled.
+  static void RecordFeedbackBarrier(VkCommandBuffer cmd_buffer) noexcept;
+private:
+  struct Slot {
+    uint32_t texture_id;
+    uint32_t tile;
+    uint64_t last_used;
+    bool pinned;
+  };
+
+  struct TileRequest {
+    std::weak_ptr<VirtualTexture> texture;
+    uint32_t tile;
+    uint32_t level;
+  };
+
+  struct LoadedTile {
+    std::weak_ptr<VirtualTexture> texture;
+    uint32_t tile;
+    // empty when the tile could not be read
+    std::vector<uint8_t> texels;
+  };
+
+  struct PageTableCopy {
+    std::shared_ptr<VirtualTexture> texture;
+    std::vector<VkBufferImageCopy> regions;
+  };
+
+  // Per frame in flight, reused once its fence has signalled.
+  struct Staging {
+    Buffer buffer;
+    uint8_t* data;
+    std::vector<VkBufferImageCopy> tile_copies;
+    std::vector<PageTableCopy> page_table_copies;
+  };
+
+  void Run();
+  [[nodiscard]] std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>> LockTextures();
+  void ReadFeedback(const std::shared_ptr<VirtualTexture>& texture, size_t frame, std::vector<TileRequest>& requests);
+  void PushRequests(std::vector<TileRequest>&& requests);
+  [[nodiscard]] std::optional<uint32_t> AllocateSlot(const std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>>& textures);
+  void StageTiles(Staging& staging, const std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>>& textures);
+  void StagePageTables(Staging& staging, const std::unordered_map<uint32_t, std::shared_ptr<VirtualTexture>>& textures) const;
+
+  const Device& device_;
+  size_t frame_count_;
+  DeviceHandle<VkCommandPool> cmd_pool_;
+  Image image_;
+  DeviceHandle<VkSampler> tile_sampler_;
+  DeviceHandle<VkSampler> page_sampler_;
+  std::vector<Staging> staging_;
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  uint64_t tick_;
+
+  mutable std::mutex textures_mutex_;
+  std::unordered_map<uint32_t, std::weak_ptr<VirtualTexture>> textures_;
+  uint32_t next_id_;
+
+  bool running_;
+  // requests queued or being read, the queue is kept short so it follows the camera
+  size_t pending_count_;
+  std::deque<TileRequest> requests_;
+  std::deque<LoadedTile> loaded_;
+  std::mutex loader_mutex_;
+  std::condition_variable condition_;
+  std::thread thread_;
+};
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_TILE_CACHE_H_
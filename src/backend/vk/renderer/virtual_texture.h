@@ -0,0 +1,53 @@
+#ifndef BACKEND_VK_RENDERER_VIRTUAL_TEXTURE_H_
+#define BACKEND_VK_RENDERER_VIRTUAL_TEXTURE_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "backend/vk/renderer/buffer.h"
+#include "backend/vk/renderer/image.h"
+#include "texture/tiled.h"
+
+namespace vk {
+
+constexpr uint32_t kMaxVirtualLevels = 16;
+
+// Uniform block of virtual.frag, std140.
+struct VirtualTextureParams {
+  float width;
+  float height;
+  uint32_t level_count;
+  uint32_t padding;
+  // index of the first feedback bit of every level
+  uint32_t level_offsets[kMaxVirtualLevels];
+};
+
+// A texture sampled through the tile cache. Every page table entry names the cache slot and level of the finest resident
+// tile covering its page, the shader samples that tile until the one it wants arrives. The pages it wanted are flagged
+// in the frame's feedback bits, indexed like the tiles of the file. Only the loader thread reads the file, the residency
+// state below it belongs to the tile cache on the render thread.
+struct VirtualTexture {
+  uint32_t id;
+  std::string key;
+  texture::TileLayout layout;
+  // empty for materials without a texture, their single page stays on the white slot
+  std::optional<texture::TiledFile> file;
+  Image page_table;
+  Buffer params;
+  // one per frame in flight, mapped for as long as the texture lives
+  std::vector<Buffer> feedback;
+  std::vector<uint32_t*> feedback_bits;
+
+  std::vector<uint32_t> slots;
+  std::vector<uint32_t> entries;
+  std::vector<bool> requested;
+  bool dirty;
+};
+
+} // namespace vk
+
+#endif // BACKEND_VK_RENDERER_VIRTUAL_TEXTURE_H_
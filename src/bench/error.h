@@ -0,0 +1,14 @@
+#ifndef BENCH_ERROR_H_
+#define BENCH_ERROR_H_
+
+#include <stdexcept>
+
+namespace bench {
+
+struct Error final : std::runtime_error {
+  using runtime_error::runtime_error;
+};
+
+} // namespace bench
+
+#endif // BENCH_ERROR_H_
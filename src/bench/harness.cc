@@ -0,0 +1,98 @@
+#include "bench/harness.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+#include "bench/error.h"
+
+namespace bench {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void WriteString(std::ofstream& file, const std::string& value) {
+  file << '"';
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      file << '\\';
+    }
+    file << c;
+  }
+  file << '"';
+}
+
+} // namespace
+
+void Harness::Run(const std::string& name, const size_t bytes, const std::function<void()>& fn) {
+  fn();
+
+  std::vector<double> times_ms;
+  const Clock::time_point start = Clock::now();
+  while (times_ms.size() < min_iterations_ || Clock::now() - start < min_time_) {
+    const Clock::time_point iteration_start = Clock::now();
+    fn();
+    times_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - iteration_start).count());
+  }
+  std::sort(times_ms.begin(), times_ms.end());
+
+  Result result = {};
+  result.name = name;
+  result.iterations = times_ms.size();
+  result.bytes = bytes;
+  result.mean_ms = std::accumulate(times_ms.begin(), times_ms.end(), 0.0) / static_cast<double>(times_ms.size());
+  result.median_ms = times_ms[times_ms.size() / 2];
+  result.min_ms = times_ms.front();
+  result.max_ms = times_ms.back();
+  result.mb_per_s = bytes == 0 || result.median_ms == 0 ? 0 : static_cast<double>(bytes) / (1024.0 * 1024.0) / (result.median_ms / 1000.0);
+
+  std::clog << name << ": median " << result.median_ms << " ms, min " << result.min_ms << " ms";
+  if (result.mb_per_s != 0) {
+    std::clog << ", " << result.mb_per_s << " MB/s";
+  }
+  std::clog << " (" << result.iterations << " iterations)" << std::endl;
+
+  results_.push_back(std::move(result));
+}
+
+void Harness::Skip(const std::string& name, const std::string& reason) {
+  std::clog << name << ": skipped, " << reason << std::endl;
+  skipped_.push_back({name, reason});
+}
+
+void Harness::ExportJson(const std::string& path, const std::string& device_name) const {
+  std::ofstream file(path, std::ios::trunc);
+  if (!file.is_open()) {
+    throw Error("failed to open bench results file: " + path);
+  }
+  file << "{\n  \"revision\": ";
+  WriteString(file, ENGINE_BENCH_REVISION);
+  file << ",\n  \"device\": ";
+  WriteString(file, device_name);
+  file << ",\n  \"results\": [";
+  for (size_t i = 0; i < results_.size(); ++i) {
+    const Result& result = results_[i];
+    file << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+    WriteString(file, result.name);
+    file << ", \"iterations\": " << result.iterations
+         << ", \"bytes\": " << result.bytes
+         << ", \"mean_ms\": " << result.mean_ms
+         << ", \"median_ms\": " << result.median_ms
+         << ", \"min_ms\": " << result.min_ms
+         << ", \"max_ms\": " << result.max_ms
+         << ", \"mb_per_s\": " << result.mb_per_s << '}';
+  }
+  file << "\n  ],\n  \"skipped\": [";
+  for (size_t i = 0; i < skipped_.size(); ++i) {
+    file << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+    WriteString(file, skipped_[i].name);
+    file << ", \"reason\": ";
+    WriteString(file, skipped_[i].reason);
+    file << '}';
+  }
+  file << "\n  ]\n}\n";
+}
+
+} // namespace bench
@@ -0,0 +1,56 @@
+#ifndef BENCH_HARNESS_H_
+#define BENCH_HARNESS_H_
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+inline const void* volatile optimization_sink = nullptr;
+
+inline void DoNotOptimize(const void* value) noexcept {
+  optimization_sink = value;
+}
+
+class Harness final {
+public:
+  struct Result {
+    std::string name;
+    size_t iterations;
+    size_t bytes;
+    double mean_ms;
+    double median_ms;
+    double min_ms;
+    double max_ms;
+    double mb_per_s;
+  };
+
+  struct Skipped {
+    std::string name;
+    std::string reason;
+  };
+
+  Harness(std::chrono::milliseconds min_time, size_t min_iterations) noexcept;
+
+  // Runs fn once to warm up, then until both min_time and min_iterations are reached.
+  // bytes is the amount of input processed per call, zero disables throughput.
+  void Run(const std::string& name, size_t bytes, const std::function<void()>& fn);
+  void Skip(const std::string& name, const std::string& reason);
+
+  void ExportJson(const std::string& path, const std::string& device_name) const;
+private:
+  std::chrono::milliseconds min_time_;
+  size_t min_iterations_;
+
+  std::vector<Result> results_;
+  std::vector<Skipped> skipped_;
+};
+
+inline Harness::Harness(const std::chrono::milliseconds min_time, const size_t min_iterations) noexcept
+  : min_time_(min_time), min_iterations_(min_iterations) {}
+
+} // namespace bench
+
+#endif // BENCH_HARNESS_H_
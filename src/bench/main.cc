@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "backend/vk/renderer/device_selector.h"
+#include "backend/vk/renderer/instance.h"
+#include "backend/vk/renderer/object_loader.h"
+#include "bench/harness.h"
+#include "engine/render/data_util.h"
+#include "mesh/simplify.h"
+#include "obj/error.h"
+#include "obj/parser.h"
+#include "texture/texture.h"
+
+namespace {
+
+constexpr size_t kPolygonsPerIteration = 1000;
+constexpr size_t kFrameCount = 2;
+constexpr size_t kGeometryChunkBudget = 4 << 20;
+constexpr VkDeviceSize kStagingRingSize = 64 << 20;
+constexpr float kPi = 3.14159265358979f;
+
+std::vector<std::filesystem::path> FindFiles(const std::filesystem::path& dir, const std::string& extension) {
+  std::vector<std::filesystem::path> files;
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+    std::string file_extension = entry.path().extension().string();
+    std::transform(file_extension.begin(), file_extension.end(), file_extension.begin(), [](const unsigned char c) {
+      return std::tolower(c);
+    });
+    if (entry.is_regular_file() && file_extension == extension) {
+      files.push_back(entry.path());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+std::string BenchName(const char* group, const std::filesystem::path& corpus, const std::filesystem::path& file) {
+  return std::string(group) + '/' + std::filesystem::relative(file, corpus).generic_string();
+}
+
+obj::Data MakePolygon(const size_t sides, std::vector<obj::Indices>& raw_indices) {
+  obj::Data data = {};
+  raw_indices.clear();
+  for (size_t i = 0; i < sides; ++i) {
+    // wobble the radius so the ear clipper sees a concave outline
+    const float angle = 2.0f * kPi * static_cast<float>(i) / static_cast<float>(sides);
+    const float radius = i % 2 == 0 ? 1.0f : 0.7f;
+    data.v.insert(data.v.end(), {radius * std::cos(angle), radius * std::sin(angle), 0.0f});
+    raw_indices.push_back({static_cast<unsigned int>(i), 0, 0});
+  }
+  data.indices.reserve(3 * sides * kPolygonsPerIteration);
+  return data;
+}
+
+void BenchParse(bench::Harness& harness, const std::filesystem::path& corpus, const std::vector<std::filesystem::path>& models) {
+  for (const std::filesystem::path& model : models) {
+    const std::string name = BenchName("parse", corpus, model);
+    try {
+      harness.Run(name, std::filesystem::file_size(model), [&model] {
+        const obj::Data data = obj::ParseFromFile(model.string());
+        bench::DoNotOptimize(data.indices.data());
+      });
+    } catch (const obj::Error& error) {
+      harness.Skip(name, error.what());
+    }
+  }
+}
+
+void BenchStream(bench::Harness& harness, const std::filesystem::path& corpus, const std::vector<std::filesystem::path>& models) {
+  for (const std::filesystem::path& model : models) {
+    const std::string name = BenchName("stream", corpus, model);
+    try {
+      harness.Run(name, std::filesystem::file_size(model), [&model] {
+        size_t index_count = 0;
+        const obj::Data data = obj::StreamFromFile(model.string(), kGeometryChunkBudget, [&index_count](const obj::Chunk& chunk) {
+          index_count += chunk.index_count;
+          bench::DoNotOptimize(chunk.vertices);
+        });
+        bench::DoNotOptimize(&index_count);
+      });
+    } catch (const obj::Error& error) {
+      harness.Skip(name, error.what());
+    }
+  }
+}
+
+void BenchMtl(bench::Harness& harness, const std::filesystem::path& corpus) {
+  for (const std::filesystem::path& mtl : FindFiles(corpus, ".mtl")) {
+    harness.Run(BenchName("mtl", corpus, mtl), std::filesystem::file_size(mtl), [&mtl] {
+      obj::Data data = {};
+      data.dir_path = mtl.parent_path().string() + '/';
+      obj::ParseMtlFromFile(mtl.string(), data);
+      bench::DoNotOptimize(data.mtl.data());
+    });
+  }
+}
+
+void BenchTriangulate(bench::Harness& harness) {
+  for (const size_t sides : {4, 8, 32, 128}) {
+    std::vector<obj::Indices> raw_indices;
+    obj::Data data = MakePolygon(sides, raw_indices);
+
+    harness.Run("triangulate/" + std::to_string(sides), 0, [&data, &raw_indices] {
+      data.indices.clear();
+      for (size_t i = 0; i < kPolygonsPerIteration; ++i) {
+        obj::ProcessPolygon(data, raw_indices.data(), raw_indices.size());
+      }
+      bench::DoNotOptimize(data.indices.data());
+    });
+  }
+}
+
+void BenchRemoveDuplicates(bench::Harness& harness, const std::filesystem::path& corpus, const std::vector<std::filesystem::path>& models) {
+  for (const std::filesystem::path& model : models) {
+    const std::string name = BenchName("remove_duplicates", corpus, model);
+    obj::Data data;
+    try {
+      data = obj::ParseFromFile(model.string());
+    } catch (const obj::Error& error) {
+      harness.Skip(name, error.what());
+      continue;
+    }
+    std::vector<engine::Vertex> vertices(data.indices.size());
+    std::vector<engine::Index> indices(data.indices.size());
+
+    harness.Run(name, 0, [&] {
+      const size_t vertex_count = engine::data_util::RemoveDuplicates(data, vertices.data(), indices.data());
+      bench::DoNotOptimize(&vertex_count);
+    });
+  }
+}
+
+void BenchSimplify(bench::Harness& harness, const std::filesystem::path& corpus, const std::vector<std::filesystem::path>& models) {
+  for (const std::filesystem::path& model : models) {
+    const std::string name = BenchName("simplify", corpus, model);
+    obj::Data data;
+    try {
+      data = obj::ParseFromFile(model.string());
+    } catch (const obj::Error& error) {
+      harness.Skip(name, error.what());
+      continue;
+    }
+    std::vector<engine::Vertex> vertices(data.indices.size());
+    std::vector<engine::Index> indices(data.indices.size());
+    const size_t vertex_count = engine::data_util::RemoveDuplicates(data, vertices.data(), indices.data());
+
+    harness.Run(name, 0, [&] {
+      const std::vector<mesh::Lod> lods = mesh::BuildLods(&vertices.data()->pos, sizeof(engine::Vertex), vertex_count, indices.data(), data.usemtl, mesh::kMaxLods);
+      bench::DoNotOptimize(&lods);
+    });
+  }
+}
+
+void BenchTextureDecode(bench::Harness& harness, const std::filesystem::path& corpus, const std::vector<std::filesystem::path>& models) {
+  std::set<std::filesystem::path> textures;
+  for (const std::filesystem::path& model : models) {
+    try {
+      for (const obj::NewMtl& mtl : obj::ParseFromFile(model.string()).mtl) {
+        if (!mtl.map_kd.empty() && std::filesystem::exists(mtl.map_kd)) {
+          textures.insert(std::filesystem::canonical(mtl.map_kd));
+        }
+      }
+    } catch (const obj::Error&) {
+    }
+  }
+  const std::filesystem::path canonical_corpus = std::filesystem::canonical(corpus);
+  for (const std::filesystem::path& texture : textures) {
+    harness.Run(BenchName("texture_decode", canonical_corpus, texture), std::filesystem::file_size(texture), [&texture] {
+      int width, height, channels;
+      std::unique_ptr<stbi_uc, void(*)(void*)> pixels(stbi_load(texture.string().c_str(), &width, &height, &channels, STBI_rgb_alpha), stbi_image_free);
+      bench::DoNotOptimize(pixels.get());
+    });
+    int width, height, channels;
+    const std::unique_ptr<stbi_uc, void(*)(void*)> pixels(stbi_load(texture.string().c_str(), &width, &height, &channels, STBI_rgb_alpha), stbi_image_free);
+    if (pixels == nullptr) {
+      continue;
+    }
+    harness.Run(BenchName("texture_mips", canonical_corpus, texture), static_cast<size_t>(width) * height * STBI_rgb_alpha, [&pixels, width, height] {
+      const texture::Texture mips = texture::BuildMips(pixels.get(), static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+      bench::DoNotOptimize(&mips);
+    });
+  }
+}
+
+// Runs on whatever device the loader hands out first, point VK_DRIVER_FILES at lavapipe for comparable numbers.
+std::string BenchVulkanLoad(bench::Harness& harness, const std::filesystem::path& corpus, const std::vector<std::filesystem::path>& models) {
+  std::vector<const char*> instance_extensions = {
+#ifdef DEBUG
+    VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+#ifdef __APPLE__
+    VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+    VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
+#endif
+  };
+  const vk::Instance instance(instance_extensions);
+
+  vk::DeviceSelector::Requirements requirements = {};
+  requirements.present = false;
+  requirements.graphic = true;
+  requirements.anisotropy = true;
+  requirements.surface = VK_NULL_HANDLE;
+  requirements.extensions = {
+    VK_KHR_MAINTENANCE1_EXTENSION_NAME,
+#ifdef __APPLE__
+    VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME
+#endif
+  };
+  const std::vector<VkPhysicalDevice> physical_devices = instance.EnumeratePhysicalDevices();
+  const std::optional<vk::Device> device = vk::DeviceSelector(physical_devices).Select(requirements);
+  if (!device) {
+    harness.Skip("vk_load", "no suitable vulkan device");
+    return {};
+  }
+  vk::ObjectLoader::Init();
+  const vk::DeviceHandle<VkCommandPool> cmd_pool = device->CreateCommandPool();
+  // textures are released with each loaded object, every iteration uploads them again
+  vk::TextureCache texture_cache(*device);
+  vk::StagingRing staging_ring(*device, kStagingRingSize);
+  const vk::ObjectLoader loader(*device, cmd_pool.handle(), texture_cache, staging_ring);
+
+  for (const std::filesystem::path& model : models) {
+    const std::string name = BenchName("vk_load", corpus, model);
+    try {
+      harness.Run(name, std::filesystem::file_size(model), [&loader, &model] {
+        const vk::Object object = loader.Load(model.string(), kFrameCount);
+        bench::DoNotOptimize(&object);
+      });
+    } catch (const obj::Error& error) {
+      harness.Skip(name, error.what());
+    }
+  }
+  return device->physical_device().properties().deviceName;
+}
+
+} // namespace
+
+int main(const int argc, char* argv[]) {
+  const std::filesystem::path corpus = argc > 1 ? argv[1] : "../obj";
+  const std::string output = argc > 2 ? argv[2] : "bench_results.json";
+  try {
+    const std::vector<std::filesystem::path> models = FindFiles(corpus, ".obj");
+
+    bench::Harness harness(std::chrono::milliseconds(500), 5);
+    BenchParse(harness, corpus, models);
+    BenchStream(harness, corpus, models);
+    BenchMtl(harness, corpus);
+    BenchTriangulate(harness);
+    BenchRemoveDuplicates(harness, corpus, models);
+    BenchSimplify(harness, corpus, models);
+    BenchTextureDecode(harness, corpus, models);
+
+    std::string device_name;
+    try {
+      device_name = BenchVulkanLoad(harness, corpus, models);
+    } catch (const vk::Error& error) {
+      harness.Skip("vk_load", error.what());
+    }
+    harness.ExportJson(output, device_name);
+    return EXIT_SUCCESS;
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << std::endl;
+  }
+  return EXIT_FAILURE;
+}
@@ -1,5 +1,7 @@
 #include "engine/config.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 #ifdef _WIN32
@@ -31,11 +33,98 @@ std::string GetTitle(const RendererType::Name renderer_name, const WindowType::N
   return ss.str();
 }
 
+bool GetFlag(const char* name, const bool default_value) {
+  if (const char* value = std::getenv(name); value != nullptr) {
+    return std::strcmp(value, "0") != 0;
+  }
+  return default_value;
+}
+
+std::string GetStatsPath(const RendererType::Name renderer_type, const RenderSettings& settings) {
+  std::string path = std::string(renderer_type) + '_' + std::string(PresentModeName(settings.present_mode));
+  if (settings.depth_prepass) {
+    path += "_prepass";
+  }
+  if (settings.sort_draws) {
+    path += "_sorted";
+  }
+  if (settings.gpu_culling) {
+    path += "_culled";
+  }
+  if (settings.lod_count > 1) {
+    path += "_lods" + std::to_string(settings.lod_count);
+  }
+  if (settings.forced_lod) {
+    path += "_lod" + std::to_string(*settings.forced_lod);
+  }
+  if (settings.compress_textures) {
+    path += "_bc";
+  }
+  if (settings.stream_textures) {
+    path += "_stream";
+  }
+  if (settings.virtual_textures) {
+    path += "_vt";
+  }
+  if (settings.geometry_chunk_budget != 0) {
+    path += "_chunks" + std::to_string(settings.geometry_chunk_budget >> 10);
+  }
+  return path + "_frame_stats";
+}
+
+// ENGINE_PRESENT_MODE (vsync, mailbox, immediate, limited), ENGINE_TARGET_HZ and ENGINE_FRAMES_IN_FLIGHT override the defaults,
+// ENGINE_DEPTH_PREPASS, ENGINE_SORT_DRAWS, ENGINE_GPU_CULLING, ENGINE_COMPRESS_TEXTURES, ENGINE_STREAM_TEXTURES and
+// ENGINE_VIRTUAL_TEXTURES set to anything but 0 turn the feature on,
+// ENGINE_LOD_COUNT sets the number of detail levels, ENGINE_LOD pins the rendered one and ENGINE_GEOMETRY_CHUNK_KB sets the
+// geometry chunk budget in KiB
+RenderSettings GetRenderSettings() {
+  RenderSettings settings;
+  if (const char* present_mode = std::getenv("ENGINE_PRESENT_MODE"); present_mode != nullptr) {
+    settings.present_mode = ParsePresentMode(present_mode).value_or(settings.present_mode);
+  }
+  if (const char* target_hz = std::getenv("ENGINE_TARGET_HZ"); target_hz != nullptr) {
+    if (const double hz = std::strtod(target_hz, nullptr); hz > 0) {
+      settings.target_hz = hz;
+    }
+  }
+  if (const char* frames_in_flight = std::getenv("ENGINE_FRAMES_IN_FLIGHT"); frames_in_flight != nullptr) {
+    if (const long count = std::strtol(frames_in_flight, nullptr, 10); count > 0) {
+      settings.frames_in_flight = static_cast<size_t>(count);
+    }
+  }
+  settings.depth_prepass = GetFlag("ENGINE_DEPTH_PREPASS", settings.depth_prepass);
+  settings.sort_draws = GetFlag("ENGINE_SORT_DRAWS", settings.sort_draws);
+  settings.gpu_culling = GetFlag("ENGINE_GPU_CULLING", settings.gpu_culling);
+  settings.compress_textures = GetFlag("ENGINE_COMPRESS_TEXTURES", settings.compress_textures);
+  settings.stream_textures = GetFlag("ENGINE_STREAM_TEXTURES", settings.stream_textures);
+  settings.virtual_textures = GetFlag("ENGINE_VIRTUAL_TEXTURES", settings.virtual_textures);
+  if (const char* lod_count = std::getenv("ENGINE_LOD_COUNT"); lod_count != nullptr) {
+    if (const long count = std::strtol(lod_count, nullptr, 10); count > 0) {
+      settings.lod_count = static_cast<size_t>(count);
+    }
+  }
+  if (const char* chunk_kb = std::getenv("ENGINE_GEOMETRY_CHUNK_KB"); chunk_kb != nullptr) {
+    if (const long kb = std::strtol(chunk_kb, nullptr, 10); kb >= 0) {
+      settings.geometry_chunk_budget = static_cast<size_t>(kb) << 10;
+    }
+  }
+  if (const char* lod = std::getenv("ENGINE_LOD"); lod != nullptr) {
+    char* end = nullptr;
+    if (const long level = std::strtol(lod, &end, 10); end != lod && level >= 0) {
+      settings.forced_lod = static_cast<size_t>(level);
+    }
+  }
+  return settings;
+}
+
 } // namespace
 
 Config::Config(RendererType::Name renderer_type, WindowType::Name window_type)
   : window_plugin_path(GetWindowDllPath(renderer_type, window_type)),
     renderer_plugin_path(GetRendererDllPath(renderer_type)),
-    title(GetTitle(renderer_type, window_type)) {}
+    render_settings(GetRenderSettings()),
+    title(GetTitle(renderer_type, window_type)),
+    stats_path(GetStatsPath(renderer_type, render_settings)),
+    trace_path(std::string(renderer_type) + "_trace.json") {}
 
 } // namespace engine
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include "engine/render/settings.h"
+
 namespace engine {
 
 struct RendererType {
@@ -25,7 +27,11 @@ struct Config {
   std::string window_plugin_path;
   std::string renderer_plugin_path;
 
+  RenderSettings render_settings;
+
   std::string title;
+  std::string stats_path;
+  std::string trace_path;
 };
 
 
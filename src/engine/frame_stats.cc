@@ -0,0 +1,144 @@
+#include "engine/frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "engine/error.h"
+
+namespace engine {
+
+namespace {
+
+FrameStats::Percentiles ComputePercentiles(std::vector<double>& values) {
+  if (values.empty()) {
+    return {};
+  }
+  std::sort(values.begin(), values.end());
+  const auto rank = [&values](const double percentile) {
+    const auto idx = static_cast<size_t>(std::ceil(percentile * static_cast<double>(values.size()))) - 1;
+    return values[std::min(idx, values.size() - 1)];
+  };
+  return {rank(0.50), rank(0.95), rank(0.99), values.back()};
+}
+
+std::ofstream OpenExport(const std::string& path) {
+  std::ofstream file(path, std::ios::trunc);
+  if (!file.is_open()) {
+    throw Error("Failed to open frame stats export file: " + path);
+  }
+  return file;
+}
+
+} // namespace
+
+std::vector<FrameStats::Sample> FrameStats::Samples() const {
+  const uint64_t end = write_index_.load(std::memory_order_acquire);
+  const uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+
+  std::vector<Sample> samples;
+  samples.reserve(end - begin);
+  for (uint64_t i = begin; i < end; ++i) {
+    samples.push_back(ring_[i % kCapacity]);
+  }
+  return samples;
+}
+
+FrameStats::Summary FrameStats::Summarize() const {
+  const std::vector<Sample> samples = Samples();
+
+  Summary summary = {};
+  summary.frames = samples.size();
+
+  std::vector<double> values;
+  values.reserve(samples.size());
+
+  for (const Sample& sample : samples) {
+    values.push_back(sample.frame_ms);
+  }
+  summary.frame = ComputePercentiles(values);
+
+  values.clear();
+  for (const Sample& sample : samples) {
+    if (sample.gpu_ms > 0) {
+      values.push_back(sample.gpu_ms);
+    }
+  }
+  summary.gpu = ComputePercentiles(values);
+
+  values.clear();
+  for (const Sample& sample : samples) {
+    values.push_back(sample.latency_ms);
+  }
+  summary.latency = ComputePercentiles(values);
+
+  for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+    values.clear();
+    for (const Sample& sample : samples) {
+      values.push_back(sample.phase_ms[phase]);
+    }
+    summary.phases[phase] = ComputePercentiles(values);
+  }
+  for (size_t range = 0; range < gpu_ranges_.size(); ++range) {
+    if (const auto [total_ms, max_ms, count] = gpu_ranges_[range]; count != 0) {
+      summary.gpu_ranges.push_back({range, total_ms / static_cast<double>(count), max_ms, count});
+    }
+  }
+  summary.dropped_gpu_ranges = dropped_gpu_ranges_;
+  return summary;
+}
+
+void FrameStats::ExportCsv(const std::string& path) const {
+  std::ofstream file = OpenExport(path);
+
+  file << "frame,frame_ms,gpu_ms,latency_ms";
+  for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+    file << ',' << PhaseName(static_cast<Phase>(phase)) << "_ms";
+  }
+  file << '\n';
+
+  const std::vector<Sample> samples = Samples();
+  for (size_t i = 0; i < samples.size(); ++i) {
+    file << i << ',' << samples[i].frame_ms << ',' << samples[i].gpu_ms << ',' << samples[i].latency_ms;
+    for (const double phase_ms : samples[i].phase_ms) {
+      file << ',' << phase_ms;
+    }
+    file << '\n';
+  }
+}
+
+void FrameStats::ExportJson(const std::string& path) const {
+  std::ofstream file = OpenExport(path);
+
+  const auto write_percentiles = [&file](const Percentiles& percentiles) {
+    file << "{\"p50\": " << percentiles.p50
+         << ", \"p95\": " << percentiles.p95
+         << ", \"p99\": " << percentiles.p99
+         << ", \"max\": " << percentiles.max << '}';
+  };
+  const Summary summary = Summarize();
+
+  file << "{\n  \"frames\": " << summary.frames << ",\n  \"frame_ms\": ";
+  write_percentiles(summary.frame);
+  file << ",\n  \"gpu_ms\": ";
+  write_percentiles(summary.gpu);
+  file << ",\n  \"latency_ms\": ";
+  write_percentiles(summary.latency);
+  file << ",\n  \"phases_ms\": {";
+  for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+    file << (phase == 0 ? "\n" : ",\n") << "    \"" << PhaseName(static_cast<Phase>(phase)) << "\": ";
+    write_percentiles(summary.phases[phase]);
+  }
+  file << "\n  },\n  \"gpu_ranges_ms\": [";
+  for (size_t i = 0; i < summary.gpu_ranges.size(); ++i) {
+    const GpuRangeSummary& gpu_range = summary.gpu_ranges[i];
+    file << (i == 0 ? "\n" : ",\n")
+         << "    {\"range\": " << gpu_range.range
+         << ", \"mean\": " << gpu_range.mean_ms
+         << ", \"max\": " << gpu_range.max_ms
+         << ", \"count\": " << gpu_range.count << '}';
+  }
+  file << "\n  ],\n  \"gpu_ranges_dropped\": " << summary.dropped_gpu_ranges << "\n}\n";
+}
+
+} // namespace engine
@@ -0,0 +1,229 @@
+#ifndef ENGINE_FRAME_STATS_H_
+#define ENGINE_FRAME_STATS_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "trace/trace.h"
+
+namespace engine {
+
+class FrameStats {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Phase : size_t {
+    kEventPoll,
+    kUniformUpdate,
+    kRecord,
+    kSubmit,
+    kPresent,
+    kFenceWait,
+    // window work after the render callback returns, the buffer swap under gl
+    kLoopTail,
+    kCount
+  };
+
+  static constexpr size_t kPhaseCount = static_cast<size_t>(Phase::kCount);
+  static constexpr size_t kCapacity = 4096;
+  // draw ranges timed per frame, the ones past it are counted as dropped
+  static constexpr size_t kMaxGpuRanges = 64;
+
+  struct Sample {
+    double frame_ms;
+    double gpu_ms;
+    double latency_ms;
+    std::array<double, kPhaseCount> phase_ms;
+  };
+
+  struct GpuRange {
+    double total_ms;
+    double max_ms;
+    uint64_t count;
+  };
+
+  struct GpuRangeSummary {
+    size_t range;
+    double mean_ms;
+    double max_ms;
+    uint64_t count;
+  };
+
+  struct Percentiles {
+    double p50;
+    double p95;
+    double p99;
+    double max;
+  };
+
+  struct Summary {
+    size_t frames;
+    Percentiles frame;
+    Percentiles gpu;
+    Percentiles latency;
+    std::array<Percentiles, kPhaseCount> phases;
+    std::vector<GpuRangeSummary> gpu_ranges;
+    uint64_t dropped_gpu_ranges;
+  };
+
+  class Scope {
+  public:
+    Scope(FrameStats* stats, Phase phase) noexcept;
+    Scope(const Scope&) = delete;
+    ~Scope();
+
+    Scope& operator=(const Scope&) = delete;
+  private:
+    FrameStats* stats_;
+    Phase phase_;
+    Clock::time_point start_;
+    trace::Zone zone_;
+  };
+
+  static constexpr const char* PhaseName(Phase phase) noexcept;
+
+  FrameStats() noexcept;
+
+  void BeginFrame() noexcept;
+  void AddPhase(Phase phase, double ms) noexcept;
+  void AddGpuTime(double ms) noexcept;
+  void SetLatency(double ms) noexcept;
+  void AddGpuRangeTime(size_t range, double ms);
+  void AddDroppedGpuRanges(uint64_t count) noexcept;
+  void EndFrame() noexcept;
+
+  [[nodiscard]] double SinceFrameStart() const noexcept;
+  [[nodiscard]] double fps() const noexcept;
+  [[nodiscard]] uint64_t frame_count() const noexcept;
+
+  [[nodiscard]] std::vector<Sample> Samples() const;
+  [[nodiscard]] Summary Summarize() const;
+
+  void ExportCsv(const std::string& path) const;
+  void ExportJson(const std::string& path) const;
+private:
+  std::array<Sample, kCapacity> ring_;
+  std::atomic<uint64_t> write_index_;
+  // indexed by range, grown as higher ones come in
+  std::vector<GpuRange> gpu_ranges_;
+  uint64_t dropped_gpu_ranges_;
+
+  Sample current_;
+  Clock::time_point frame_start_;
+
+  double fps_;
+  Clock::time_point fps_update_time_;
+  int frames_since_fps_update_;
+};
+
+inline double ElapsedMs(const FrameStats::Clock::time_point start) noexcept {
+  return std::chrono::duration<double, std::milli>(FrameStats::Clock::now() - start).count();
+}
+
+inline FrameStats::Scope::Scope(FrameStats* stats, const Phase phase) noexcept
+  : stats_(stats), phase_(phase), start_(stats ? Clock::now() : Clock::time_point()), zone_(PhaseName(phase)) {}
+
+inline FrameStats::Scope::~Scope() {
+  if (stats_ != nullptr) {
+    stats_->AddPhase(phase_, ElapsedMs(start_));
+  }
+}
+
+constexpr const char* FrameStats::PhaseName(const Phase phase) noexcept {
+  switch (phase) {
+    case Phase::kEventPoll:
+      return "event_poll";
+    case Phase::kUniformUpdate:
+      return "uniform_update";
+    case Phase::kRecord:
+      return "record";
+    case Phase::kSubmit:
+      return "submit";
+    case Phase::kPresent:
+      return "present";
+    case Phase::kFenceWait:
+      return "fence_wait";
+    case Phase::kLoopTail:
+      return "loop_tail";
+    default:
+      return "unknown";
+  }
+}
+
+inline FrameStats::FrameStats() noexcept
+  : ring_(),
+    write_index_(0),
+    gpu_ranges_(),
+    dropped_gpu_ranges_(0),
+    current_(),
+    fps_(0),
+    fps_update_time_(Clock::now()),
+    frames_since_fps_update_(0) {}
+
+inline void FrameStats::BeginFrame() noexcept {
+  current_ = {};
+  frame_start_ = Clock::now();
+}
+
+inline void FrameStats::AddPhase(const Phase phase, const double ms) noexcept {
+  current_.phase_ms[static_cast<size_t>(phase)] += ms;
+}
+
+inline void FrameStats::AddGpuTime(const double ms) noexcept {
+  current_.gpu_ms += ms;
+}
+
+inline void FrameStats::SetLatency(const double ms) noexcept {
+  current_.latency_ms = ms;
+}
+
+inline void FrameStats::AddGpuRangeTime(const size_t range, const double ms) {
+  if (range >= gpu_ranges_.size()) {
+    gpu_ranges_.resize(range + 1);
+  }
+  GpuRange& gpu_range = gpu_ranges_[range];
+  gpu_range.total_ms += ms;
+  gpu_range.max_ms = std::max(gpu_range.max_ms, ms);
+  ++gpu_range.count;
+}
+
+inline void FrameStats::AddDroppedGpuRanges(const uint64_t count) noexcept {
+  dropped_gpu_ranges_ += count;
+}
+
+inline void FrameStats::EndFrame() noexcept {
+  const Clock::time_point now = Clock::now();
+  current_.frame_ms = std::chrono::duration<double, std::milli>(now - frame_start_).count();
+
+  const uint64_t index = write_index_.load(std::memory_order_relaxed);
+  ring_[index % kCapacity] = current_;
+  write_index_.store(index + 1, std::memory_order_release);
+
+  ++frames_since_fps_update_;
+  if (const double elapsed = std::chrono::duration<double>(now - fps_update_time_).count(); elapsed > 0.25) {
+    fps_ = frames_since_fps_update_ / elapsed;
+    fps_update_time_ = now;
+    frames_since_fps_update_ = 0;
+  }
+}
+
+inline double FrameStats::SinceFrameStart() const noexcept {
+  return ElapsedMs(frame_start_);
+}
+
+inline double FrameStats::fps() const noexcept {
+  return fps_;
+}
+
+inline uint64_t FrameStats::frame_count() const noexcept {
+  return write_index_.load(std::memory_order_acquire);
+}
+
+} // namespace engine
+
+#endif // ENGINE_FRAME_STATS_H_
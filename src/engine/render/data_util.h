@@ -2,14 +2,22 @@
 #define ENGINE_RENDER_DATA_UTIL_H_
 
 #include "engine/render/types.h"
+#include "obj/parser.h"
 #include "obj/types.h"
+#include "trace/trace.h"
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <unordered_map>
+#include <vector>
 
 namespace engine::data_util {
 
-static void RemoveDuplicates(const obj::Data& data, Vertex* vertices, Index* indices) {
+// positions, when given, receives a tightly packed copy of the vertex positions for position-only passes
+static size_t RemoveDuplicates(const obj::Data& data, Vertex* vertices, Index* indices, glm::vec3* positions = nullptr) {
+  TRACE_ZONE("RemoveDuplicates");
   std::unordered_map<obj::Indices, unsigned int, obj::Indices::Hash> index_map;
 
   unsigned int next_combined_idx = 0, combined_idx = 0;
@@ -19,16 +27,54 @@ static void RemoveDuplicates(const obj::Data& data, Vertex* vertices, Index* ind
     } else {
       combined_idx = next_combined_idx;
       index_map.emplace(index, combined_idx);
-      const unsigned int i_v = index.fv * 3, i_n = index.fn * 3, i_t = index.ft * 2;
+      const obj::Vertex vertex = obj::GetVertex(data, index);
+      const glm::vec3 pos(vertex.pos[0], vertex.pos[1], vertex.pos[2]);
+      if (positions != nullptr) {
+        *positions++ = pos;
+      }
       *vertices++ = Vertex{
-        glm::vec3(data.v[i_v], data.v[i_v + 1], data.v[i_v + 2]),
-        glm::vec3(data.vn[i_n], data.vn[i_n + 1], data.vn[i_n + 2]),
-        glm::vec2(data.vt[i_t], data.vt[i_t + 1])
+        pos,
+        glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]),
+        glm::vec2(vertex.tex_coord[0], vertex.tex_coord[1])
     };
       ++next_combined_idx;
     }
     *indices++ = combined_idx;
   }
+  return next_combined_idx;
+}
+
+// One sphere per usemtl range, centered on the range's bounding box.
+static std::vector<BoundingSphere> ComputeBounds(const obj::Data& data) {
+  TRACE_ZONE("ComputeBounds");
+  std::vector<BoundingSphere> bounds;
+  bounds.reserve(data.usemtl.size());
+
+  size_t begin = 0;
+  for (const obj::UseMtl& usemtl : data.usemtl) {
+    const size_t end = usemtl.offset;
+    if (begin >= end) {
+      bounds.push_back({glm::vec3(0.0f), 0.0f});
+      continue;
+    }
+    glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+    for (size_t i = begin; i < end; ++i) {
+      const unsigned int i_v = data.indices[i].fv * 3;
+      const glm::vec3 pos(data.v[i_v], data.v[i_v + 1], data.v[i_v + 2]);
+      min = glm::min(min, pos);
+      max = glm::max(max, pos);
+    }
+    const glm::vec3 center = (min + max) * 0.5f;
+    float radius_sq = 0.0f;
+    for (size_t i = begin; i < end; ++i) {
+      const unsigned int i_v = data.indices[i].fv * 3;
+      const glm::vec3 offset = glm::vec3(data.v[i_v], data.v[i_v + 1], data.v[i_v + 2]) - center;
+      radius_sq = std::max(radius_sq, glm::dot(offset, offset));
+    }
+    bounds.push_back({center, std::sqrt(radius_sq)});
+    begin = end;
+  }
+  return bounds;
 }
 
 } // namespace engine
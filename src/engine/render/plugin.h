@@ -4,11 +4,12 @@
 #include "engine/plugin_api.h"
 
 #include "engine/render/renderer.h"
+#include "engine/render/settings.h"
 #include "engine/window/window.h"
 
 extern "C" {
 
-extern ENGINE_API engine::Renderer* PluginCreateRenderer(engine::Window& window);
+extern ENGINE_API engine::Renderer* PluginCreateRenderer(engine::Window& window, const engine::RenderSettings& settings);
 extern ENGINE_API void PluginDestroyRenderer(engine::Renderer* renderer);
 
 } // extern "C"
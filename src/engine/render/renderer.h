@@ -1,6 +1,11 @@
 #ifndef ENGINE_RENDER_RENDERER_H_
 #define ENGINE_RENDER_RENDERER_H_
 
+#include <future>
+#include <memory>
+#include <string>
+
+#include "engine/frame_stats.h"
 #include "engine/render/model.h"
 #include "engine/window/window.h"
 
@@ -12,7 +17,9 @@ public:
 
   virtual void RenderFrame() = 0;
   virtual void LoadModel(const std::string& path) = 0;
+  virtual std::future<void> LoadModelAsync(const std::string& path) = 0;
   virtual Model& GetModel() noexcept = 0;
+  virtual void SetFrameStats(FrameStats* frame_stats) noexcept = 0;
   virtual ~Renderer() = default;
 };
 
@@ -6,10 +6,10 @@ namespace engine {
 
 RendererLoader::RendererLoader(const std::string& path) : DllLoader(path) {}
 
-Renderer::Handle RendererLoader::Load(Window& window) const {
+Renderer::Handle RendererLoader::Load(Window& window, const RenderSettings& settings) const {
   const auto create_renderer = DllLoader::Load<decltype(&PluginCreateRenderer)>("PluginCreateRenderer");
   const auto destroy_renderer = DllLoader::Load<decltype(&PluginDestroyRenderer)>("PluginDestroyRenderer");
-  return {create_renderer(window), destroy_renderer};
+  return {create_renderer(window, settings), destroy_renderer};
 }
 
 } // namespace engine
\ No newline at end of file
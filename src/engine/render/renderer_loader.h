@@ -2,6 +2,7 @@
 #define ENGINE_RENDER_RENDERER_LOADER_H_
 
 #include "engine/render/renderer.h"
+#include "engine/render/settings.h"
 #include "engine/dll_loader.h"
 
 namespace engine {
@@ -10,7 +11,7 @@ class RendererLoader final : DllLoader {
 public:
   explicit RendererLoader(const std::string& path);
 
-  [[nodiscard]] Renderer::Handle Load(Window& window) const;
+  [[nodiscard]] Renderer::Handle Load(Window& window, const RenderSettings& settings) const;
 
   ~RendererLoader() override = default;
 };
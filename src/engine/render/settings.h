@@ -0,0 +1,69 @@
+#ifndef ENGINE_RENDER_SETTINGS_H_
+#define ENGINE_RENDER_SETTINGS_H_
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace engine {
+
+enum class PresentMode {
+  kVsync,
+  kMailbox,
+  kImmediate,
+  kFrameLimited
+};
+
+struct RenderSettings {
+  PresentMode present_mode = PresentMode::kVsync;
+  // Only used with kFrameLimited, the runner paces frames on the cpu.
+  double target_hz = 60.0;
+  size_t frames_in_flight = 2;
+  // Lays down depth with a position-only pass so the shaded pass runs once per pixel.
+  bool depth_prepass = false;
+  // Orders draw ranges front to back by bounding sphere distance every frame.
+  bool sort_draws = false;
+  // Culls meshlets against the frustum and their normal cones in a compute pass, needs indirect count draws.
+  bool gpu_culling = false;
+  // Levels of detail generated per model, counting the full mesh, 1 disables simplification.
+  size_t lod_count = 1;
+  // Pins every model to one level instead of picking it from the projected error, for per level measurements.
+  std::optional<size_t> forced_lod;
+  // Uploads textures block compressed with precomputed mips, encodings are cached next to the images as KTX2.
+  bool compress_textures = false;
+  // Uploads the small mips of every texture with the model and streams the larger ones in over the following frames.
+  bool stream_textures = false;
+  // Samples textures through a bounded cache of tiles loaded as the frames ask for them, vulkan only.
+  bool virtual_textures = false;
+  // Parses models in deduplicated chunks of this many bytes copied straight to upload buffers, so host memory follows
+  // the budget rather than the file size. 0 parses models whole, vulkan only and not with gpu culling or lods.
+  size_t geometry_chunk_budget = 0;
+};
+
+constexpr std::string_view PresentModeName(const PresentMode present_mode) noexcept {
+  switch (present_mode) {
+    case PresentMode::kVsync:
+      return "vsync";
+    case PresentMode::kMailbox:
+      return "mailbox";
+    case PresentMode::kImmediate:
+      return "immediate";
+    case PresentMode::kFrameLimited:
+      return "limited";
+    default:
+      return "unknown";
+  }
+}
+
+inline std::optional<PresentMode> ParsePresentMode(const std::string_view name) noexcept {
+  for (const PresentMode present_mode : {PresentMode::kVsync, PresentMode::kMailbox, PresentMode::kImmediate, PresentMode::kFrameLimited}) {
+    if (PresentModeName(present_mode) == name) {
+      return present_mode;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace engine
+
+#endif // ENGINE_RENDER_SETTINGS_H_
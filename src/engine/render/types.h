@@ -16,6 +16,11 @@ struct Vertex {
 
 using Index = uint32_t;
 
+struct BoundingSphere {
+  glm::vec3 center;
+  float radius;
+};
+
 struct Uniforms {
   alignas(16) glm::mat4 model;
   alignas(16) glm::mat4 view;
@@ -1,40 +1,205 @@
 #include "engine/runner.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <sstream>
+#include <thread>
+
+#include "trace/trace.h"
 
 namespace engine {
 
-Runner::Runner(const RendererLoader& renderer_loader, const WindowLoader& window_loader, std::string title)
-    : title_(std::move(title)),
+namespace {
+
+constexpr double kSpikeFactor = 2.0;
+constexpr double kAverageWeight = 0.05;
+// sleep_until overshoots by up to a scheduler tick, the last stretch before a paced frame is spun instead
+constexpr std::chrono::microseconds kSpinMargin(1500);
+
+void PrintPercentiles(const char* name, const FrameStats::Percentiles& percentiles) {
+  std::clog << "  " << name
+            << ": p50 " << percentiles.p50
+            << " ms, p95 " << percentiles.p95
+            << " ms, p99 " << percentiles.p99
+            << " ms, max " << percentiles.max << " ms" << std::endl;
+}
+
+} // namespace
+
+Runner::Runner(const RendererLoader& renderer_loader, const WindowLoader& window_loader, const Config& config)
+    : title_(config.title),
+      stats_path_(config.stats_path),
+      trace_path_(config.trace_path),
+      present_mode_(config.render_settings.present_mode),
+      frame_period_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / config.render_settings.target_hz))),
       window_loader_(window_loader),
       renderer_loader_(renderer_loader),
+      displayed_fps_(-1),
       instance_(window_loader_.LoadInstance()),
       window_(window_loader_.LoadWindow(1280, 720, title_)),
-      renderer_(renderer_loader_.Load(*window_)) {}
+      renderer_(renderer_loader_.Load(*window_, config.render_settings)),
+      average_frame_ms_(0),
+      load_max_frame_ms_(0),
+      load_frames_(0),
+      load_spikes_(0) {
+  renderer_->SetFrameStats(&frame_stats_);
+  std::clog << "present mode " << PresentModeName(present_mode_);
+  if (present_mode_ == PresentMode::kFrameLimited) {
+    std::clog << " at " << config.render_settings.target_hz << " Hz";
+  }
+  std::clog << ", " << config.render_settings.frames_in_flight << " frames in flight";
+  if (config.render_settings.depth_prepass) {
+    std::clog << ", depth prepass";
+  }
+  if (config.render_settings.sort_draws) {
+    std::clog << ", sorted draws";
+  }
+  if (config.render_settings.gpu_culling) {
+    std::clog << ", gpu culling";
+  }
+  if (config.render_settings.lod_count > 1) {
+    std::clog << ", " << config.render_settings.lod_count << " lods";
+  }
+  if (config.render_settings.forced_lod) {
+    std::clog << ", pinned to lod " << *config.render_settings.forced_lod;
+  }
+  if (config.render_settings.compress_textures) {
+    std::clog << ", compressed textures";
+  }
+  if (config.render_settings.stream_textures) {
+    std::clog << ", streamed textures";
+  }
+  if (config.render_settings.virtual_textures) {
+    std::clog << ", virtual textures";
+  }
+  if (config.render_settings.geometry_chunk_budget != 0) {
+    std::clog << ", geometry in " << (config.render_settings.geometry_chunk_budget >> 10) << " KiB chunks";
+  }
+  std::clog << std::endl;
+}
 
 void Runner::Run() {
-  renderer_->LoadModel("../obj/Madara Uchiha/obj/Madara_Uchiha.obj");
+  load_start_ = Clock::now();
+  model_loading_ = renderer_->LoadModelAsync("../obj/Madara Uchiha/obj/Madara_Uchiha.obj");
   renderer_->GetModel().SetView(window_->GetWidth(), window_->GetHeight());
   window_->SetWindowEventHandler(this);
+  next_frame_time_ = Clock::now();
   while (!window_->ShouldClose()) {
-    UpdateFps();
+    frame_stats_.BeginFrame();
+    render_end_.reset();
     window_->Loop();
+    if (render_end_) {
+      frame_stats_.AddPhase(FrameStats::Phase::kLoopTail, ElapsedMs(*render_end_));
+      frame_stats_.SetLatency(ElapsedMs(input_time_));
+    }
+    WaitForNextFrame();
+
+    const double frame_ms = frame_stats_.SinceFrameStart();
+    frame_stats_.EndFrame();
+
+    if (model_loading_.valid()) {
+      TrackModelLoading(frame_ms);
+    }
+    average_frame_ms_ = average_frame_ms_ == 0 ? frame_ms : average_frame_ms_ + (frame_ms - average_frame_ms_) * kAverageWeight;
+
+    UpdateTitle();
   }
+  renderer_->SetFrameStats(nullptr);
+  ExportFrameStats();
+  ExportTrace();
 }
 
 void Runner::OnRenderEvent() {
+  frame_stats_.AddPhase(FrameStats::Phase::kEventPoll, frame_stats_.SinceFrameStart());
+  input_time_ = Clock::now();
+
   renderer_->GetModel().Rotate(1.0);
   renderer_->RenderFrame();
+
+  render_end_ = Clock::now();
 }
 
-void Runner::UpdateFps() {
-  const double fps = fps_counter_.Count();
+void Runner::WaitForNextFrame() {
+  if (present_mode_ != PresentMode::kFrameLimited) {
+    return;
+  }
+  const Clock::time_point now = Clock::now();
+  next_frame_time_ += frame_period_;
+  if (next_frame_time_ < now - frame_period_) {
+    // fell more than a frame behind, pace from here instead of bursting to catch up
+    next_frame_time_ = now;
+    return;
+  }
+  std::this_thread::sleep_until(next_frame_time_ - kSpinMargin);
+  while (Clock::now() < next_frame_time_) {
+    std::this_thread::yield();
+  }
+}
+
+void Runner::TrackModelLoading(const double frame_ms) {
+  ++load_frames_;
+  load_max_frame_ms_ = std::max(load_max_frame_ms_, frame_ms);
+  if (average_frame_ms_ != 0 && frame_ms > average_frame_ms_ * kSpikeFactor) {
+    ++load_spikes_;
+    std::clog << "frame spike during model load: " << frame_ms << " ms (average " << average_frame_ms_ << " ms)" << std::endl;
+  }
+  if (model_loading_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
+  model_loading_.get();
+
+  const double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - load_start_).count();
+  std::clog << "model loaded in " << load_ms << " ms over " << load_frames_ << " frames, worst frame "
+            << load_max_frame_ms_ << " ms, " << load_spikes_ << " spikes" << std::endl;
+
+  load_frames_ = 0;
+  load_spikes_ = 0;
+  load_max_frame_ms_ = 0;
+}
+
+void Runner::UpdateTitle() {
+  const long fps = std::lround(frame_stats_.fps() * 10);
+  if (fps == displayed_fps_) {
+    return;
+  }
+  displayed_fps_ = fps;
 
   std::stringstream oss;
-  oss.precision(1);
-  oss << title_ << " (" << std::fixed << fps << " FPS)";
+  oss << title_ << " (" << fps / 10 << '.' << fps % 10 << " FPS)";
 
   window_->SetWindowTitle(oss.str());
 }
 
-} // namespace engine
\ No newline at end of file
+void Runner::ExportFrameStats() const {
+  const FrameStats::Summary summary = frame_stats_.Summarize();
+
+  std::clog << "frame stats over the last " << summary.frames << " frames:" << std::endl;
+  PrintPercentiles("frame", summary.frame);
+  PrintPercentiles("gpu", summary.gpu);
+  PrintPercentiles("input to present", summary.latency);
+  for (size_t phase = 0; phase < FrameStats::kPhaseCount; ++phase) {
+    PrintPercentiles(FrameStats::PhaseName(static_cast<FrameStats::Phase>(phase)), summary.phases[phase]);
+  }
+  for (const auto [range, mean_ms, max_ms, count] : summary.gpu_ranges) {
+    std::clog << "  gpu range " << range << ": mean " << mean_ms << " ms, max " << max_ms << " ms over " << count << " draws" << std::endl;
+  }
+  if (summary.dropped_gpu_ranges != 0) {
+    std::clog << "  " << summary.dropped_gpu_ranges << " draws past " << FrameStats::kMaxGpuRanges << " ranges a frame were not timed" << std::endl;
+  }
+  if (stats_path_.empty()) {
+    return;
+  }
+  frame_stats_.ExportCsv(stats_path_ + ".csv");
+  frame_stats_.ExportJson(stats_path_ + ".json");
+}
+
+void Runner::ExportTrace() const {
+  if (trace_path_.empty()) {
+    return;
+  }
+  trace::Flush(trace_path_);
+  std::clog << "trace written to " << trace_path_ << std::endl;
+}
+
+} // namespace engine
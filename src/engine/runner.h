@@ -1,33 +1,60 @@
 #ifndef ENGINE_RUNNER_H_
 #define ENGINE_RUNNER_H_
 
+#include <chrono>
+#include <future>
+#include <optional>
 #include <string_view>
 
 #include "engine/window/window_loader.h"
 #include "engine/render/renderer_loader.h"
-#include "engine/fps_counter.h"
+#include "engine/config.h"
+#include "engine/frame_stats.h"
 
 namespace engine {
 
 class Runner final : public Window::EventHandler {
 public:
-  Runner(const RendererLoader& renderer_loader, const WindowLoader& window_loader, std::string title);
+  Runner(const RendererLoader& renderer_loader, const WindowLoader& window_loader, const Config& config);
   ~Runner() override = default;
 
   void Run();
 private:
+  using Clock = std::chrono::steady_clock;
+
   void OnRenderEvent() override;
-  void UpdateFps();
+  void WaitForNextFrame();
+  void UpdateTitle();
+  void TrackModelLoading(double frame_ms);
+  void ExportFrameStats() const;
+  void ExportTrace() const;
 
   std::string title_;
+  std::string stats_path_;
+  std::string trace_path_;
+  PresentMode present_mode_;
+  Clock::duration frame_period_;
 
   const WindowLoader& window_loader_;
   const RendererLoader& renderer_loader_;
 
-  FpsCounter fps_counter_;
+  FrameStats frame_stats_;
+  long displayed_fps_;
+  // unset in loop iterations where the window did not ask for a frame
+  std::optional<Clock::time_point> render_end_;
+  Clock::time_point input_time_;
+  Clock::time_point next_frame_time_;
+
   Instance::Handle instance_;
   Window::Handle window_;
   Renderer::Handle renderer_;
+
+  std::future<void> model_loading_;
+  Clock::time_point load_start_;
+  double average_frame_ms_;
+  double load_max_frame_ms_;
+  size_t load_frames_;
+  size_t load_spikes_;
 };
 
 } // namespace engine
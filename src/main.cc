@@ -10,7 +10,7 @@ int main() {
   const engine::WindowLoader window_loader(config.window_plugin_path);
   const engine::RendererLoader renderer_loader(config.renderer_plugin_path);
   try {
-    engine::Runner runner(renderer_loader, window_loader, config.title);
+    engine::Runner runner(renderer_loader, window_loader, config);
     runner.Run();
     return EXIT_SUCCESS;
   } catch (const std::exception& error) {
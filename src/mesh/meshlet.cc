@@ -0,0 +1,130 @@
+#include "mesh/meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "mesh/position_reader.h"
+#include "trace/trace.h"
+
+namespace mesh {
+
+namespace {
+
+// Normal cones wider than this are not worth testing, almost nothing gets culled.
+constexpr float kMinConeDot = 0.1f;
+
+uint32_t SpreadBits(uint32_t x) noexcept {
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x030000ff;
+  x = (x | (x << 8)) & 0x0300f00f;
+  x = (x | (x << 4)) & 0x030c30c3;
+  x = (x | (x << 2)) & 0x09249249;
+  return x;
+}
+
+uint32_t MortonCode(const glm::vec3& unit) noexcept {
+  const auto quantize = [](const float value) {
+    return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 1023.0f);
+  };
+  return SpreadBits(quantize(unit.x)) | (SpreadBits(quantize(unit.y)) << 1) | (SpreadBits(quantize(unit.z)) << 2);
+}
+
+// Sorts the triangles along a z-order curve over their centroids, consecutive triangles end up close in space.
+void SortTriangles(const PositionReader& positions, uint32_t* indices, const size_t triangle_count) {
+  std::vector<glm::vec3> centroids(triangle_count);
+  glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+  for (size_t i = 0; i < triangle_count; ++i) {
+    const uint32_t* triangle = indices + i * 3;
+    centroids[i] = (positions[triangle[0]] + positions[triangle[1]] + positions[triangle[2]]) / 3.0f;
+    min = glm::min(min, centroids[i]);
+    max = glm::max(max, centroids[i]);
+  }
+  const glm::vec3 extent = max - min;
+  const float scale = 1.0f / std::max({extent.x, extent.y, extent.z, std::numeric_limits<float>::min()});
+
+  std::vector<std::pair<uint32_t, uint32_t>> keys(triangle_count);
+  for (size_t i = 0; i < triangle_count; ++i) {
+    keys[i] = {MortonCode((centroids[i] - min) * scale), static_cast<uint32_t>(i)};
+  }
+  std::sort(keys.begin(), keys.end());
+
+  const std::vector<uint32_t> sorted(indices, indices + triangle_count * 3);
+  for (size_t i = 0; i < triangle_count; ++i) {
+    std::copy_n(sorted.begin() + keys[i].second * 3, 3, indices + i * 3);
+  }
+}
+
+Meshlet ComputeMeshlet(const PositionReader& positions, const uint32_t* indices, const uint32_t first_index, const uint32_t index_count) {
+  glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+  glm::vec3 normal_sum(0.0f);
+  std::vector<glm::vec3> normals;
+  normals.reserve(index_count / 3);
+
+  for (uint32_t i = first_index; i + 2 < first_index + index_count; i += 3) {
+    const glm::vec3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+    min = glm::min(glm::min(min, a), glm::min(b, c));
+    max = glm::max(glm::max(max, a), glm::max(b, c));
+
+    const glm::vec3 normal = glm::cross(b - a, c - a);
+    if (const float length = glm::length(normal); length > 0.0f) {
+      normals.push_back(normal / length);
+      normal_sum += normals.back();
+    }
+  }
+  Meshlet meshlet = {};
+  meshlet.center = (min + max) * 0.5f;
+  for (uint32_t i = first_index; i < first_index + index_count; ++i) {
+    meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, positions[indices[i]]));
+  }
+  meshlet.first_index = first_index;
+  meshlet.index_count = index_count;
+  meshlet.cone_cutoff = 1.0f;
+
+  const float axis_length = glm::length(normal_sum);
+  if (axis_length <= 0.0f) {
+    return meshlet;
+  }
+  meshlet.cone_axis = normal_sum / axis_length;
+
+  float min_dot = 1.0f;
+  for (const glm::vec3& normal : normals) {
+    min_dot = std::min(min_dot, glm::dot(normal, meshlet.cone_axis));
+  }
+  if (min_dot >= kMinConeDot) {
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+  }
+  return meshlet;
+}
+
+} // namespace
+
+std::vector<Meshlet> BuildMeshlets(const void* positions, const size_t stride, uint32_t* indices, const std::vector<obj::UseMtl>& usemtl) {
+  TRACE_ZONE("BuildMeshlets");
+  const PositionReader reader(positions, stride);
+  std::vector<Meshlet> meshlets;
+
+  uint32_t range_begin = 0;
+  for (uint32_t range = 0; range < usemtl.size(); ++range) {
+    const uint32_t range_end = usemtl[range].offset;
+    const size_t triangle_count = range_end > range_begin ? (range_end - range_begin) / 3 : 0;
+
+    SortTriangles(reader, indices + range_begin, triangle_count);
+
+    const auto draw_offset = static_cast<uint32_t>(meshlets.size());
+    for (size_t triangle = 0; triangle < triangle_count; triangle += kMaxMeshletTriangles) {
+      const auto first_index = static_cast<uint32_t>(range_begin + triangle * 3);
+      const auto index_count = static_cast<uint32_t>(std::min(kMaxMeshletTriangles, triangle_count - triangle) * 3);
+
+      Meshlet meshlet = ComputeMeshlet(reader, indices, first_index, index_count);
+      meshlet.range = range;
+      meshlet.draw_offset = draw_offset;
+      meshlets.push_back(meshlet);
+    }
+    range_begin = std::max(range_begin, range_end);
+  }
+  return meshlets;
+}
+
+} // namespace mesh
@@ -0,0 +1,38 @@
+#ifndef MESH_MESHLET_H_
+#define MESH_MESHLET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "obj/types.h"
+
+namespace mesh {
+
+inline constexpr size_t kMaxMeshletTriangles = 128;
+
+// Layout matches the std430 Meshlet struct of the cull shader.
+struct Meshlet {
+  glm::vec3 center;
+  float radius;
+  glm::vec3 cone_axis;
+  // Sine of the normal cone half-angle, 1 when the normals spread too far to ever be backface culled.
+  float cone_cutoff;
+  uint32_t first_index;
+  uint32_t index_count;
+  // usemtl range the meshlet belongs to and the first draw slot reserved for that range.
+  uint32_t range;
+  uint32_t draw_offset;
+};
+
+static_assert(sizeof(Meshlet) == 48, "Meshlet must match the shader layout");
+
+// Reorders the triangles of every usemtl range into spatially coherent clusters of at most
+// kMaxMeshletTriangles and returns them in index order. Positions are three floats read with the given byte stride.
+std::vector<Meshlet> BuildMeshlets(const void* positions, size_t stride, uint32_t* indices, const std::vector<obj::UseMtl>& usemtl);
+
+} // namespace mesh
+
+#endif // MESH_MESHLET_H_
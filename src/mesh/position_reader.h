@@ -0,0 +1,32 @@
+#ifndef MESH_POSITION_READER_H_
+#define MESH_POSITION_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace mesh {
+
+// Reads three float positions out of an interleaved vertex stream.
+class PositionReader {
+public:
+  PositionReader(const void* positions, size_t stride) noexcept;
+
+  [[nodiscard]] glm::vec3 operator[](uint32_t index) const noexcept;
+private:
+  const unsigned char* positions_;
+  size_t stride_;
+};
+
+inline PositionReader::PositionReader(const void* positions, const size_t stride) noexcept
+  : positions_(static_cast<const unsigned char*>(positions)), stride_(stride) {}
+
+inline glm::vec3 PositionReader::operator[](const uint32_t index) const noexcept {
+  const auto position = reinterpret_cast<const float*>(positions_ + index * stride_);
+  return {position[0], position[1], position[2]};
+}
+
+} // namespace mesh
+
+#endif // MESH_POSITION_READER_H_
@@ -0,0 +1,338 @@
+#include "mesh/simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include "mesh/position_reader.h"
+#include "trace/trace.h"
+
+namespace mesh {
+
+namespace {
+
+constexpr float kLodRatio = 0.5f;
+// Rejects collapses that turn a surrounding triangle by more than ~78 degrees.
+constexpr float kMinNormalDot = 0.2f;
+
+// Sum of squared distances to the planes of the adjacent triangles, weighted by their area.
+struct Quadric {
+  double a00, a01, a02, a11, a12, a22;
+  double b0, b1, b2;
+  double c;
+  double weight;
+
+  Quadric& operator+=(const Quadric& other) noexcept;
+  [[nodiscard]] double Evaluate(const glm::vec3& point) const noexcept;
+};
+
+Quadric& Quadric::operator+=(const Quadric& other) noexcept {
+  a00 += other.a00; a01 += other.a01; a02 += other.a02;
+  a11 += other.a11; a12 += other.a12; a22 += other.a22;
+  b0 += other.b0; b1 += other.b1; b2 += other.b2;
+  c += other.c;
+  weight += other.weight;
+  return *this;
+}
+
+double Quadric::Evaluate(const glm::vec3& point) const noexcept {
+  const double x = point.x, y = point.y, z = point.z;
+  return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + a11 * y * y + 2 * a12 * y * z + a22 * z * z +
+         2 * (b0 * x + b1 * y + b2 * z) + c;
+}
+
+Quadric PlaneQuadric(const glm::vec3& normal, const float distance, const double weight) noexcept {
+  const double x = normal.x, y = normal.y, z = normal.z, d = distance;
+  return {
+    x * x * weight, x * y * weight, x * z * weight, y * y * weight, y * z * weight, z * z * weight,
+    x * d * weight, y * d * weight, z * d * weight,
+    d * d * weight,
+    weight
+  };
+}
+
+struct PositionKey {
+  uint32_t x, y, z;
+
+  bool operator==(const PositionKey& other) const noexcept {
+    return x == other.x && y == other.y && z == other.z;
+  }
+
+  struct Hash {
+    size_t operator()(const PositionKey& key) const noexcept {
+      return (key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u);
+    }
+  };
+};
+
+PositionKey ToPositionKey(const glm::vec3& position) noexcept {
+  PositionKey key = {};
+  std::memcpy(&key.x, &position.x, sizeof(float));
+  std::memcpy(&key.y, &position.y, sizeof(float));
+  std::memcpy(&key.z, &position.z, sizeof(float));
+  return key;
+}
+
+uint64_t EdgeKey(const uint32_t a, const uint32_t b) noexcept {
+  return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+std::vector<bool> FindLockedVertices(const PositionReader& positions, const size_t vertex_count, const Lod& lod) {
+  std::vector<bool> locked(vertex_count, false);
+
+  // uv and normal seams split a position into several vertices, moving one of them would tear the surface
+  std::unordered_map<PositionKey, uint32_t, PositionKey::Hash> first_vertex;
+  for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+    if (const auto [it, inserted] = first_vertex.emplace(ToPositionKey(positions[vertex]), vertex); !inserted) {
+      locked[it->second] = true;
+      locked[vertex] = true;
+    }
+  }
+  std::vector<uint32_t> vertex_range(vertex_count, UINT32_MAX);
+  uint32_t range_begin = 0;
+  for (uint32_t range = 0; range < lod.range_ends.size(); ++range) {
+    for (uint32_t i = range_begin; i < lod.range_ends[range]; ++i) {
+      uint32_t& owner = vertex_range[lod.indices[i]];
+      if (owner == UINT32_MAX) {
+        owner = range;
+      } else if (owner != range) {
+        locked[lod.indices[i]] = true;
+      }
+    }
+    range_begin = std::max(range_begin, lod.range_ends[range]);
+  }
+  std::unordered_map<uint64_t, uint32_t> edge_uses;
+  for (size_t i = 0; i + 2 < lod.indices.size(); i += 3) {
+    for (size_t k = 0; k < 3; ++k) {
+      ++edge_uses[EdgeKey(lod.indices[i + k], lod.indices[i + (k + 1) % 3])];
+    }
+  }
+  for (const auto& [edge, uses] : edge_uses) {
+    if (uses != 2) {
+      locked[edge >> 32] = true;
+      locked[edge & UINT32_MAX] = true;
+    }
+  }
+  return locked;
+}
+
+std::vector<Quadric> ComputeQuadrics(const PositionReader& positions, const size_t vertex_count, const std::vector<uint32_t>& indices) {
+  std::vector<Quadric> quadrics(vertex_count, Quadric{});
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const glm::vec3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+    const glm::vec3 normal = glm::cross(b - a, c - a);
+    const float length = glm::length(normal);
+    if (length <= 0.0f) {
+      continue;
+    }
+    const glm::vec3 unit_normal = normal / length;
+    const Quadric quadric = PlaneQuadric(unit_normal, -glm::dot(unit_normal, a), length * 0.5);
+    for (size_t k = 0; k < 3; ++k) {
+      quadrics[indices[i + k]] += quadric;
+    }
+  }
+  return quadrics;
+}
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+class Simplifier {
+public:
+  Simplifier(const PositionReader& positions, size_t vertex_count, std::vector<bool> locked, std::vector<Quadric> quadrics) noexcept;
+
+  [[nodiscard]] Lod Simplify(const Lod& source, size_t target_index_count);
+private:
+  const PositionReader& positions_;
+  std::vector<bool> locked_;
+  std::vector<Quadric> quadrics_;
+  std::vector<uint32_t> remap_;
+  std::vector<uint32_t> adjacency_offsets_;
+  std::vector<uint32_t> adjacency_;
+
+  void BuildAdjacency(const std::vector<uint32_t>& indices);
+  [[nodiscard]] std::vector<Collapse> CollectCollapses(const std::vector<uint32_t>& indices) const;
+  [[nodiscard]] bool Flips(const std::vector<uint32_t>& indices, const Collapse& collapse) const;
+  [[nodiscard]] double Error(const Collapse& collapse) const noexcept;
+  static void Compact(Lod& lod, const std::vector<uint32_t>& remap);
+};
+
+Simplifier::Simplifier(const PositionReader& positions, const size_t vertex_count, std::vector<bool> locked, std::vector<Quadric> quadrics) noexcept
+  : positions_(positions),
+    locked_(std::move(locked)),
+    quadrics_(std::move(quadrics)),
+    remap_(vertex_count),
+    adjacency_offsets_(vertex_count + 1) {
+  for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+    remap_[vertex] = vertex;
+  }
+}
+
+void Simplifier::BuildAdjacency(const std::vector<uint32_t>& indices) {
+  std::fill(adjacency_offsets_.begin(), adjacency_offsets_.end(), 0);
+  for (const uint32_t vertex : indices) {
+    ++adjacency_offsets_[vertex + 1];
+  }
+  for (size_t i = 1; i < adjacency_offsets_.size(); ++i) {
+    adjacency_offsets_[i] += adjacency_offsets_[i - 1];
+  }
+  adjacency_.resize(indices.size());
+  std::vector<uint32_t> fill(adjacency_offsets_.begin(), adjacency_offsets_.end() - 1);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    adjacency_[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+}
+
+std::vector<Collapse> Simplifier::CollectCollapses(const std::vector<uint32_t>& indices) const {
+  std::vector<Collapse> collapses;
+  collapses.reserve(indices.size());
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    for (size_t k = 0; k < 3; ++k) {
+      const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+      // interior edges show up in both triangles, only one of them proposes the collapse, border edges are locked anyway
+      if (a > b) {
+        continue;
+      }
+      for (const auto& [from, to] : {std::pair(a, b), std::pair(b, a)}) {
+        if (!locked_[from]) {
+          Quadric quadric = quadrics_[from];
+          quadric += quadrics_[to];
+          collapses.push_back({from, to, quadric.Evaluate(positions_[to])});
+        }
+      }
+    }
+  }
+  std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+    return lhs.cost < rhs.cost;
+  });
+  return collapses;
+}
+
+bool Simplifier::Flips(const std::vector<uint32_t>& indices, const Collapse& collapse) const {
+  const glm::vec3 target = positions_[collapse.to];
+  for (uint32_t i = adjacency_offsets_[collapse.from]; i < adjacency_offsets_[collapse.from + 1]; ++i) {
+    const uint32_t* triangle = indices.data() + adjacency_[i] * 3;
+    if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+      continue;
+    }
+    glm::vec3 corners[3] = {positions_[triangle[0]], positions_[triangle[1]], positions_[triangle[2]]};
+    const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+    for (size_t k = 0; k < 3; ++k) {
+      if (triangle[k] == collapse.from) {
+        corners[k] = target;
+      }
+    }
+    const glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+    if (glm::dot(before, after) <= kMinNormalDot * glm::length(before) * glm::length(after)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+double Simplifier::Error(const Collapse& collapse) const noexcept {
+  const double weight = quadrics_[collapse.from].weight + quadrics_[collapse.to].weight;
+  return weight > 0.0 ? std::sqrt(std::max(collapse.cost, 0.0) / weight) : 0.0;
+}
+
+void Simplifier::Compact(Lod& lod, const std::vector<uint32_t>& remap) {
+  size_t write = 0;
+  size_t range_begin = 0;
+  for (uint32_t& range_end : lod.range_ends) {
+    for (size_t i = range_begin; i + 2 < range_end; i += 3) {
+      const uint32_t a = remap[lod.indices[i]], b = remap[lod.indices[i + 1]], c = remap[lod.indices[i + 2]];
+      if (a == b || b == c || a == c) {
+        continue;
+      }
+      lod.indices[write++] = a;
+      lod.indices[write++] = b;
+      lod.indices[write++] = c;
+    }
+    range_begin = std::max<size_t>(range_begin, range_end);
+    range_end = static_cast<uint32_t>(write);
+  }
+  lod.indices.resize(write);
+}
+
+Lod Simplifier::Simplify(const Lod& source, const size_t target_index_count) {
+  Lod lod = source;
+  std::vector<bool> touched;
+
+  while (lod.indices.size() > target_index_count) {
+    BuildAdjacency(lod.indices);
+    touched.assign(remap_.size(), false);
+
+    // each collapse drops the two triangles sharing the edge, stop once the target is about to be crossed
+    const size_t triangles_to_remove = (lod.indices.size() - target_index_count) / 3;
+    size_t triangles_removed = 0;
+    for (const Collapse& collapse : CollectCollapses(lod.indices)) {
+      if (triangles_removed >= triangles_to_remove) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to] || Flips(lod.indices, collapse)) {
+        continue;
+      }
+      // the neighbourhood is frozen for the rest of the pass so the flip checks above stay valid
+      for (const uint32_t vertex : {collapse.from, collapse.to}) {
+        for (uint32_t i = adjacency_offsets_[vertex]; i < adjacency_offsets_[vertex + 1]; ++i) {
+          const uint32_t* triangle = lod.indices.data() + adjacency_[i] * 3;
+          touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+          if (vertex == collapse.from && (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)) {
+            ++triangles_removed;
+          }
+        }
+      }
+      lod.error = std::max(lod.error, static_cast<float>(Error(collapse)));
+      quadrics_[collapse.to] += quadrics_[collapse.from];
+      remap_[collapse.from] = collapse.to;
+    }
+    if (triangles_removed == 0) {
+      break;
+    }
+    Compact(lod, remap_);
+  }
+  return lod;
+}
+
+} // namespace
+
+std::vector<Lod> BuildLods(const void* positions,
+                           const size_t stride,
+                           const size_t vertex_count,
+                           const uint32_t* indices,
+                           const std::vector<obj::UseMtl>& usemtl,
+                           const size_t lod_count) {
+  TRACE_ZONE("BuildLods");
+  const PositionReader reader(positions, stride);
+
+  Lod full = {};
+  full.range_ends.reserve(usemtl.size());
+  for (const obj::UseMtl& range : usemtl) {
+    full.range_ends.push_back(range.offset);
+  }
+  full.indices.assign(indices, indices + (usemtl.empty() ? 0 : usemtl.back().offset));
+
+  Simplifier simplifier(reader, vertex_count, FindLockedVertices(reader, vertex_count, full), ComputeQuadrics(reader, vertex_count, full.indices));
+
+  std::vector<Lod> lods;
+  for (size_t level = 1; level < std::min(lod_count, kMaxLods); ++level) {
+    const Lod& source = lods.empty() ? full : lods.back();
+    const size_t target_index_count = static_cast<size_t>(static_cast<float>(source.indices.size() / 3) * kLodRatio) * 3;
+
+    Lod lod = simplifier.Simplify(source, target_index_count);
+    if (lod.indices.size() >= source.indices.size()) {
+      break;
+    }
+    lods.push_back(std::move(lod));
+  }
+  return lods;
+}
+
+} // namespace mesh
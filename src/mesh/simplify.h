@@ -0,0 +1,30 @@
+#ifndef MESH_SIMPLIFY_H_
+#define MESH_SIMPLIFY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "obj/types.h"
+
+namespace mesh {
+
+// Levels of detail counting the full mesh.
+inline constexpr size_t kMaxLods = 5;
+
+struct Lod {
+  std::vector<uint32_t> indices;
+  // End of every usemtl range within indices.
+  std::vector<uint32_t> range_ends;
+  // How far, in model units, the simplified surface may stray from the full mesh.
+  float error;
+};
+
+// Builds up to lod_count - 1 coarser index lists, each aiming for half the triangles of the previous one, by quadric
+// error edge collapse. Vertices only move onto their neighbours, so every level shares the vertex stream. Vertices on
+// uv seams, material boundaries and open borders are never collapsed. Stops early once a level fails to shrink.
+std::vector<Lod> BuildLods(const void* positions, size_t stride, size_t vertex_count, const uint32_t* indices, const std::vector<obj::UseMtl>& usemtl, size_t lod_count);
+
+} // namespace mesh
+
+#endif // MESH_SIMPLIFY_H_
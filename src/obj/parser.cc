@@ -3,11 +3,15 @@
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <string_view>
+#include <unordered_map>
 #include <cmath>
 
 #include <glm/glm.hpp>
 
 #include "obj/error.h"
+#include "trace/trace.h"
 #include "mapbox/earcut.hpp"
 
 namespace obj {
@@ -15,6 +19,103 @@ namespace obj {
 namespace {
 
 constexpr size_t kBufferSize = 65536;
+// Facets up to a quad are read into an array on the stack, larger ones into the thread's scratch.
+constexpr size_t kInlineVertices = 4;
+// A chunk vertex with its node and bucket in the deduplication table.
+constexpr size_t kChunkVertexBytes = sizeof(Vertex) + sizeof(std::pair<const Indices, uint32_t>) + 2 * sizeof(void*);
+
+// Reused by every facet parsed on a thread, so once the buffers have grown to the largest polygon no line allocates.
+struct Scratch {
+  std::vector<Indices> indices;
+  std::vector<glm::vec2> points;
+  std::vector<uint32_t> prev;
+  std::vector<uint32_t> next;
+};
+
+Scratch& GetScratch() {
+  thread_local Scratch scratch;
+  return scratch;
+}
+
+// Twice the signed area of abc, negative when it turns the way of an outline with a positive SignedArea.
+inline float Area(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) noexcept {
+  return (b.y - a.y) * (c.x - b.x) - (b.x - a.x) * (c.y - b.y);
+}
+
+float SignedArea(const std::vector<glm::vec2>& points) noexcept {
+  float sum = 0.0f;
+  for (size_t i = 0, j = points.size() - 1; i < points.size(); j = i++) {
+    sum += (points[j].x - points[i].x) * (points[i].y + points[j].y);
+  }
+  return sum;
+}
+
+inline bool PointInTriangle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& p) noexcept {
+  return (c.x - p.x) * (a.y - p.y) >= (a.x - p.x) * (c.y - p.y) &&
+         (a.x - p.x) * (b.y - p.y) >= (b.x - p.x) * (a.y - p.y) &&
+         (b.x - p.x) * (c.y - p.y) >= (c.x - p.x) * (b.y - p.y);
+}
+
+bool IsEar(const Scratch& scratch, const uint32_t ear) noexcept {
+  const std::vector<glm::vec2>& points = scratch.points;
+  const uint32_t prev = scratch.prev[ear], next = scratch.next[ear];
+  const glm::vec2& a = points[prev];
+  const glm::vec2& b = points[ear];
+  const glm::vec2& c = points[next];
+  if (Area(a, b, c) >= 0.0f) {
+    return false;
+  }
+  for (uint32_t p = scratch.next[next]; p != prev; p = scratch.next[p]) {
+    // only reflex vertices can lie inside a convex corner
+    if (points[p] != a && points[p] != c && PointInTriangle(a, b, c, points[p]) &&
+        Area(points[scratch.prev[p]], points[p], points[scratch.next[p]]) >= 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Triangulates the projected outline in scratch.points by ear clipping over the scratch links, emitting triangles with
+// the winding earcut gives them. False, with nothing emitted, when some part of the outline has no ear to clip.
+bool ClipEars(Scratch& scratch, const Indices* raw_indices, std::vector<Indices>& indices) {
+  const auto count = static_cast<uint32_t>(scratch.points.size());
+  const size_t first_index = indices.size();
+  scratch.prev.resize(count);
+  scratch.next.resize(count);
+  // the links run the way earcut orders its outer rings
+  const bool forward = SignedArea(scratch.points) > 0.0f;
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t before = (i + count - 1) % count, after = (i + 1) % count;
+    scratch.prev[i] = forward ? before : after;
+    scratch.next[i] = forward ? after : before;
+  }
+  uint32_t ear = 0, stop = 0;
+  for (uint32_t remaining = count; remaining > 3;) {
+    const uint32_t prev = scratch.prev[ear], next = scratch.next[ear];
+    if (IsEar(scratch, ear)) {
+      indices.insert(indices.end(), {raw_indices[prev], raw_indices[ear], raw_indices[next]});
+      scratch.next[prev] = next;
+      scratch.prev[next] = prev;
+      --remaining;
+      ear = stop = scratch.next[next];
+      continue;
+    }
+    ear = next;
+    if (ear == stop) {
+      indices.resize(first_index);
+      return false;
+    }
+  }
+  indices.insert(indices.end(), {raw_indices[scratch.prev[ear]], raw_indices[ear], raw_indices[scratch.next[ear]]});
+  return true;
+}
+
+// Material libraries are parsed on their own threads while the geometry is read, usemtl names are resolved once every
+// library is in, names[i] belonging to data.usemtl[i].
+struct PendingMaterials {
+  std::vector<std::future<std::vector<NewMtl>>> libraries;
+  std::vector<std::string> names;
+};
 
 inline std::string GetDirPath(const std::string& path) {
   std::filesystem::path p(path);
@@ -38,10 +139,9 @@ const char* SkipSpace(const char* ptr) noexcept {
   return ptr;
 }
 
-const char* SkipLine(const char* ptr) noexcept {
-  for (; *ptr != '\n'; ++ptr)
-    ;
-  return ++ptr;
+const char* SkipLine(const char* ptr, const char* end) noexcept {
+  const void* newline = std::memchr(ptr, '\n', static_cast<size_t>(end - ptr));
+  return newline != nullptr ? static_cast<const char*>(newline) + 1 : end;
 }
 
 std::streamsize FileSize(std::ifstream& file) {
@@ -56,14 +156,12 @@ std::streamsize FileSize(std::ifstream& file) {
 }
 
 std::string GetName(const char** ptr) {
-  const char* p = *ptr;
-  p = SkipSpace(p);
-  std::string name;
-  for (; !IsEndOfName(*p); ++p) {
-    name += *p;
-  }
+  const char* begin = SkipSpace(*ptr);
+  const char* p = begin;
+  for (; !IsEndOfName(*p); ++p)
+    ;
   *ptr = p;
-  return name;
+  return {begin, p};
 }
 
 template<int count>
@@ -78,92 +176,6 @@ inline const char* ReadMtl<0>(const char* ptr, [[maybe_unused]]float* mtl) noexc
   return ptr;
 }
 
-void ProcessPolygon(Data& data, const std::vector<Indices>& raw_indices) {
-  // quad to 2 triangles
-  if (const size_t indices_len = raw_indices.size(); indices_len == 4) {
-    const unsigned int vi0 = raw_indices[0].fv;
-    const unsigned int vi1 = raw_indices[1].fv;
-    const unsigned int vi2 = raw_indices[2].fv;
-    const unsigned int vi3 = raw_indices[3].fv;
-
-    if (((3 * vi0 + 2) >= data.v.size()) || ((3 * vi1 + 2) >= data.v.size()) ||
-        ((3 * vi2 + 2) >= data.v.size()) || ((3 * vi3 + 2) >= data.v.size())) {
-      throw Error("invalid obj model");
-    }
-    const glm::vec3 v0 = {data.v[vi0 * 3 + 0], data.v[vi0 * 3 + 1], data.v[vi0 * 3 + 2] };
-    const glm::vec3 v1 = { data.v[vi1 * 3 + 0], data.v[vi1 * 3 + 1], data.v[vi1 * 3 + 2] };
-    const glm::vec3 v2 = { data.v[vi2 * 3 + 0], data.v[vi2 * 3 + 1], data.v[vi2 * 3 + 2] };
-    const glm::vec3 v3 = { data.v[vi3 * 3 + 0], data.v[vi3 * 3 + 1], data.v[vi3 * 3 + 2] };
-
-    const glm::vec3 e02 = v2 - v0;
-    const glm::vec3 e13 = v3 - v1;
-    // find nearest edge
-    data.indices.push_back(raw_indices[0]);
-    data.indices.push_back(raw_indices[1]);
-    if (glm::dot(e02, e02) < glm::dot(e13, e13)) {
-      data.indices.push_back(raw_indices[2]);
-      data.indices.push_back(raw_indices[0]);
-    } else {
-      data.indices.push_back(raw_indices[3]);
-      data.indices.push_back(raw_indices[1]);
-    }
-    data.indices.push_back(raw_indices[2]);
-    data.indices.push_back(raw_indices[3]);
-  } else if (indices_len > 4) {
-    glm::vec3 n1 = {};
-    for (size_t k = 0; k < indices_len; ++k) {
-      const unsigned int vi1 = raw_indices[k].fv;
-      const unsigned int vi2 = raw_indices[(k + 1) % indices_len].fv;
-
-      const glm::vec3 point1 = { data.v[vi1 * 3 + 0], data.v[vi1 * 3 + 1], data.v[vi1 * 3 + 2] };
-      const glm::vec3 point2 = { data.v[vi2 * 3 + 0], data.v[vi2 * 3 + 1], data.v[vi2 * 3 + 2] };
-
-      const glm::vec3 a = point1 - point2;
-      const glm::vec3 b = point1 + point2;
-
-      n1.x += a.y * b.z;
-      n1.y += a.z * b.x;
-      n1.z += a.x * b.y;
-    }
-    const float length_n = glm::length(n1);
-    if (length_n <= 0) {
-      throw Error("Invalid obj model");
-    }
-    const glm::vec3 axis_w = n1 * (-1.0f / length_n);
-
-    glm::vec3 a = {};
-    if (std::abs(axis_w.x) > 0.9999999f) a.y = 1.0f; else a.x = 1.0f;
-
-    const glm::vec3 axis_v = glm::normalize(glm::cross(axis_w, a));
-    const glm::vec3 axis_u = glm::cross(axis_w, axis_v);
-
-    using Point2D = std::pair<float, float>;
-
-    std::vector<std::vector<Point2D>> polygon;
-    std::vector<Point2D> polyline;
-
-    for (const Indices& indices : raw_indices) {
-      const unsigned int vi0 = indices.fv;
-      if (3 * vi0 + 2 >= data.v.size()) {
-        throw Error("invalid model file");
-      }
-      glm::vec3 polypoint = {data.v[vi0 * 3 + 0], data.v[vi0 * 3 + 1], data.v[vi0 * 3 + 2]};
-
-      polyline.emplace_back(glm::dot(polypoint, axis_u), glm::dot(polypoint, axis_v));
-    }
-    polygon.push_back(std::move(polyline));
-    std::vector order = mapbox::earcut(polygon);
-    if (order.size() % 3 != 0) {
-      throw Error("invalid obj model");
-    }
-    for (const auto idx : order) {
-      data.indices.push_back(raw_indices[idx]);
-    }
-  } else {
-    std::move(raw_indices.begin(), raw_indices.end(), std::back_inserter(data.indices));
-  }
-}
-
 template<int count>
 const char* ParseVertex(const char* ptr, std::vector<float>& verts) {
   char* end = nullptr;
@@ -182,7 +194,9 @@ const char* ParseVertex(const char* ptr, std::vector<float>& verts) {
 const char* ParseFacet(const char* ptr, Data& data) {
   char* end = nullptr;
 
-  std::vector<Indices> raw_indices;
+  Indices inline_indices[kInlineVertices];
+  std::vector<Indices>& spilled_indices = GetScratch().indices;
+  size_t count = 0;
   while (*ptr != '\n') {
     Indices indices = {};
     long int index = std::strtol(ptr, &end, 10);
@@ -193,6 +207,9 @@ const char* ParseFacet(const char* ptr, Data& data) {
     } else if (index > 0) {
       indices.fv = static_cast<unsigned int>(index) - 1;
     }
+    if (indices.fv >= data.v.size() / 3) {
+      throw Error("facet refers to a missing vertex");
+    }
     ptr = end;
     if (*ptr == '/') {
       ++ptr;
@@ -221,14 +238,24 @@ const char* ParseFacet(const char* ptr, Data& data) {
       }
       ptr = end;
     }
-    raw_indices.push_back(indices);
+    if (count < kInlineVertices) {
+      inline_indices[count] = indices;
+    } else {
+      if (count == kInlineVertices) {
+        spilled_indices.assign(inline_indices, inline_indices + kInlineVertices);
+      }
+      spilled_indices.push_back(indices);
+    }
+    ++count;
     ptr = SkipSpace(ptr);
   }
-  ProcessPolygon(data, raw_indices);
+  ProcessPolygon(data, count <= kInlineVertices ? inline_indices : spilled_indices.data(), count);
   return ptr;
 }
 
-void ParseMtlFile(std::ifstream& mtl_file, Data& data) {
+std::vector<NewMtl> ParseMtlFile(std::ifstream& mtl_file, const std::string& dir_path) {
+  TRACE_ZONE("obj::ParseMtlFile");
+  std::vector<NewMtl> mtl;
   NewMtl new_mtl;
   bool found_d = false;
 
@@ -237,11 +264,13 @@ void ParseMtlFile(std::ifstream& mtl_file, Data& data) {
 
   mtl_file.read(buffer.data(), bytes);
   const unsigned int read = mtl_file.gcount();
+  // the last line ends like the others even without a trailing newline
+  buffer[read] = '\n';
 
   const char* buffer_ptr = buffer.data();
 
   const char* ptr = buffer_ptr;
-  const char* eof = buffer_ptr + read;
+  const char* eof = buffer_ptr + read + 1;
 
   while (ptr < eof) {
     ptr = SkipSpace(ptr);
@@ -251,7 +280,7 @@ void ParseMtlFile(std::ifstream& mtl_file, Data& data) {
         if (ptr[0] == 'e' && ptr[1] == 'w' && ptr[2] == 'm' &&
             ptr[3] == 't' && ptr[4] == 'l' && IsSpace(ptr[5])) {
           if (!new_mtl.name.empty()) {
-            data.mtl.push_back(std::move(new_mtl));
+            mtl.push_back(std::move(new_mtl));
             new_mtl = NewMtl();
           }
           ptr += 5;
@@ -311,7 +340,7 @@ void ParseMtlFile(std::ifstream& mtl_file, Data& data) {
             }
           }
           if (map_ptr && std::filesystem::path(*map_ptr).is_relative()) {
-            *map_ptr = data.dir_path + *map_ptr;
+            *map_ptr = dir_path + *map_ptr;
           }
         }
         break;
@@ -319,37 +348,123 @@ void ParseMtlFile(std::ifstream& mtl_file, Data& data) {
       default:
         break;
     }
-    ptr = SkipLine(ptr);
+    ptr = SkipLine(ptr, eof);
   }
   if (!new_mtl.name.empty()) {
-    data.mtl.push_back(new_mtl);
+    mtl.push_back(std::move(new_mtl));
   }
+  return mtl;
 }
 
-inline const char* ParseMtl(const char* ptr, Data& data) {
+std::vector<NewMtl> ParseMtlLibrary(const std::string& path, const std::string& dir_path) {
+  std::ifstream mtl_file(path, std::ifstream::binary);
+  if (!mtl_file.is_open()) {
+    return {};
+  }
+  return ParseMtlFile(mtl_file, dir_path);
+}
+
+inline const char* ParseMtl(const char* ptr, const Data& data, PendingMaterials& pending) {
   const std::string path_mtl = GetName(&ptr);
-  std::ifstream mtl_file(data.dir_path + path_mtl, std::ifstream::binary);
-  if (mtl_file.is_open()) {
-    ParseMtlFile(mtl_file, data);
+  pending.libraries.push_back(std::async(std::launch::async, ParseMtlLibrary, data.dir_path + path_mtl, data.dir_path));
+  return ptr;
+}
+
+// The range of the previous usemtl ends where this one starts, at index_count.
+const char* ParseUsemtl(const char* ptr, Data& data, PendingMaterials& pending, const size_t index_count) {
+  if (!data.usemtl.empty()) {
+    data.usemtl.back().offset = index_count;
   }
+  data.usemtl.push_back({0, 0});
+  pending.names.push_back(GetName(&ptr));
   return ptr;
 }
 
-const char* ParseUsemtl(const char* ptr, Data& data) {
-  std::string use_mtl_name = GetName(&ptr);
+// Libraries are appended in mtllib order and the first material of a name wins. A usemtl naming no material is dropped
+// and the range before it goes on over its faces.
+void ResolveMaterials(PendingMaterials& pending, Data& data) {
+  TRACE_ZONE("obj::ResolveMaterials");
+  for (std::future<std::vector<NewMtl>>& library : pending.libraries) {
+    std::vector<NewMtl> mtl = library.get();
+    std::move(mtl.begin(), mtl.end(), std::back_inserter(data.mtl));
+  }
+  std::unordered_map<std::string_view, unsigned int> mtl_indices;
+  mtl_indices.reserve(data.mtl.size());
   for (unsigned int i = 0; i < data.mtl.size(); ++i) {
-    if (data.mtl[i].name == use_mtl_name) {
-      data.usemtl.push_back({i, 0});
-      if (!data.indices.empty()) {
-        data.usemtl[data.usemtl.size() - 2].offset = data.indices.size();
+    mtl_indices.emplace(data.mtl[i].name, i);
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < data.usemtl.size(); ++i) {
+    const auto it = mtl_indices.find(pending.names[i]);
+    if (it == mtl_indices.end()) {
+      if (kept != 0) {
+        data.usemtl[kept - 1].offset = data.usemtl[i].offset;
       }
-      break;
+      continue;
     }
+    data.usemtl[kept++] = {it->second, data.usemtl[i].offset};
   }
-  return ptr;
+  data.usemtl.resize(kept);
+}
+
+// Deduplicates the triangulated corners as they are parsed and hands them to the sink once the chunk outgrows its budget,
+// the table and buffers are cleared but keep their capacity for the next chunk.
+class ChunkWriter {
+public:
+  ChunkWriter(const size_t budget, const std::function<void(const Chunk&)>& sink) : budget_(budget), sink_(sink), first_vertex_(0), first_index_(0) {}
+
+  [[nodiscard]] size_t index_count() const noexcept { return first_index_ + indices_.size(); }
+
+  // Takes the corners parsed so far out of data.
+  void Add(Data& data) {
+    for (size_t i = 0; i < data.indices.size(); ++i) {
+      const Indices& index = data.indices[i];
+      const auto [it, inserted] = index_map_.emplace(index, static_cast<uint32_t>(first_vertex_ + vertices_.size()));
+      if (inserted) {
+        vertices_.push_back(GetVertex(data, index));
+      }
+      indices_.push_back(it->second);
+      // chunks end on whole triangles
+      if (i % 3 == 2 && vertices_.size() * kChunkVertexBytes + indices_.size() * sizeof(uint32_t) >= budget_) {
+        Flush();
+      }
+    }
+    data.indices.clear();
+  }
+
+  void Flush() {
+    if (indices_.empty()) {
+      return;
+    }
+    sink_({vertices_.data(), vertices_.size(), first_vertex_, indices_.data(), indices_.size(), first_index_});
+    first_vertex_ += vertices_.size();
+    first_index_ += indices_.size();
+    vertices_.clear();
+    indices_.clear();
+    index_map_.clear();
+  }
+private:
+  size_t budget_;
+  const std::function<void(const Chunk&)>& sink_;
+  std::unordered_map<Indices, uint32_t, Indices::Hash> index_map_;
+  std::vector<Vertex> vertices_;
+  std::vector<uint32_t> indices_;
+  size_t first_vertex_;
+  size_t first_index_;
+};
+
+// Without a writer the corners stay in data.indices, with one they are drained into it and chunks are cut at every
+// usemtl so none spans two ranges.
+size_t IndexCount(Data& data, ChunkWriter* writer) {
+  if (writer == nullptr) {
+    return data.indices.size();
+  }
+  writer->Add(data);
+  writer->Flush();
+  return writer->index_count();
 }
 
-void ParseBuffer(const char* ptr, const char* end, Data& data) {
+void ParseBuffer(const char* ptr, const char* end, Data& data, PendingMaterials& pending, ChunkWriter* writer) {
   while (ptr != end) {
     ptr = SkipSpace(ptr);
     if (*ptr == 'v') {
@@ -370,28 +485,26 @@ void ParseBuffer(const char* ptr, const char* end, Data& data) {
       ++ptr;
       if (ptr[0] == 't' && ptr[1] == 'l' && ptr[2] == 'l' && ptr[3] == 'i' &&
           ptr[4] == 'b' && IsSpace(ptr[5])) {
-        ptr = ParseMtl(ptr + 6, data);
+        ptr = ParseMtl(ptr + 6, data, pending);
       }
     } else if (*ptr == 'u') {
       ++ptr;
       if (ptr[0] == 's' && ptr[1] == 'e' && ptr[2] == 'm' && ptr[3] == 't' &&
           ptr[4] == 'l' && IsSpace(ptr[5])) {
-        ptr = ParseUsemtl(ptr + 6, data);
+        ptr = ParseUsemtl(ptr + 6, data, pending, IndexCount(data, writer));
       }
     }
-    ptr = SkipLine(ptr);
+    ptr = SkipLine(ptr, end);
   }
 }
 
-}  // namespace
-
-Data ParseFromFile(const std::string& path) {
-  Data data = {};
+void ParseFile(const std::string& path, Data& data, ChunkWriter* writer) {
   std::ifstream file(path.data(), std::ifstream::binary);
   if (!file.is_open()) {
     throw Error("model file is not found");
   }
   data.dir_path = GetDirPath(path);
+  PendingMaterials pending;
 
   std::vector<char> buffer(2 * kBufferSize);
   char* buffer_ptr = buffer.data();
@@ -420,20 +533,157 @@ Data ParseFromFile(const std::string& path) {
       break;
     }
     ++last;
-    ParseBuffer(buffer_ptr, last, data);
+    ParseBuffer(buffer_ptr, last, data, pending, writer);
+    if (writer != nullptr) {
+      writer->Add(data);
+    }
     const auto bytes = static_cast<unsigned int>(end - last);
     std::memmove(buffer_ptr, last, bytes);
     start = buffer_ptr + bytes;
   }
+  const size_t index_count = IndexCount(data, writer);
+  if (!data.usemtl.empty()) {
+    data.usemtl.back().offset = index_count;
+  }
+  ResolveMaterials(pending, data);
   if (data.mtl.empty()) {
     data.mtl.emplace_back();
   }
   if (data.usemtl.empty()) {
     data.usemtl.emplace_back();
   }
-  data.usemtl.back().offset = data.indices.size();
+  data.usemtl.back().offset = index_count;
+}
+
+}  // namespace
+
+void ProcessPolygon(Data& data, const Indices* raw_indices, const size_t indices_len) {
+  // quad to 2 triangles
+  if (indices_len == 4) {
+    const unsigned int vi0 = raw_indices[0].fv;
+    const unsigned int vi1 = raw_indices[1].fv;
+    const unsigned int vi2 = raw_indices[2].fv;
+    const unsigned int vi3 = raw_indices[3].fv;
+
+    if (((3 * vi0 + 2) >= data.v.size()) || ((3 * vi1 + 2) >= data.v.size()) ||
+        ((3 * vi2 + 2) >= data.v.size()) || ((3 * vi3 + 2) >= data.v.size())) {
+      throw Error("invalid obj model");
+    }
+    const glm::vec3 v0 = {data.v[vi0 * 3 + 0], data.v[vi0 * 3 + 1], data.v[vi0 * 3 + 2] };
+    const glm::vec3 v1 = { data.v[vi1 * 3 + 0], data.v[vi1 * 3 + 1], data.v[vi1 * 3 + 2] };
+    const glm::vec3 v2 = { data.v[vi2 * 3 + 0], data.v[vi2 * 3 + 1], data.v[vi2 * 3 + 2] };
+    const glm::vec3 v3 = { data.v[vi3 * 3 + 0], data.v[vi3 * 3 + 1], data.v[vi3 * 3 + 2] };
+
+    const glm::vec3 e02 = v2 - v0;
+    const glm::vec3 e13 = v3 - v1;
+    // find nearest edge
+    data.indices.push_back(raw_indices[0]);
+    data.indices.push_back(raw_indices[1]);
+    if (glm::dot(e02, e02) < glm::dot(e13, e13)) {
+      data.indices.push_back(raw_indices[2]);
+      data.indices.push_back(raw_indices[0]);
+    } else {
+      data.indices.push_back(raw_indices[3]);
+      data.indices.push_back(raw_indices[1]);
+    }
+    data.indices.push_back(raw_indices[2]);
+    data.indices.push_back(raw_indices[3]);
+  } else if (indices_len > 4) {
+    glm::vec3 n1 = {};
+    for (size_t k = 0; k < indices_len; ++k) {
+      const unsigned int vi1 = raw_indices[k].fv;
+      const unsigned int vi2 = raw_indices[(k + 1) % indices_len].fv;
+
+      const glm::vec3 point1 = { data.v[vi1 * 3 + 0], data.v[vi1 * 3 + 1], data.v[vi1 * 3 + 2] };
+      const glm::vec3 point2 = { data.v[vi2 * 3 + 0], data.v[vi2 * 3 + 1], data.v[vi2 * 3 + 2] };
+
+      const glm::vec3 a = point1 - point2;
+      const glm::vec3 b = point1 + point2;
+
+      n1.x += a.y * b.z;
+      n1.y += a.z * b.x;
+      n1.z += a.x * b.y;
+    }
+    const float length_n = glm::length(n1);
+    if (length_n <= 0) {
+      throw Error("Invalid obj model");
+    }
+    const glm::vec3 axis_w = n1 * (-1.0f / length_n);
+
+    glm::vec3 a = {};
+    if (std::abs(axis_w.x) > 0.9999999f) a.y = 1.0f; else a.x = 1.0f;
+
+    const glm::vec3 axis_v = glm::normalize(glm::cross(axis_w, a));
+    const glm::vec3 axis_u = glm::cross(axis_w, axis_v);
+
+    Scratch& scratch = GetScratch();
+    scratch.points.clear();
+    for (size_t i = 0; i < indices_len; ++i) {
+      const unsigned int vi0 = raw_indices[i].fv;
+      if (3 * vi0 + 2 >= data.v.size()) {
+        throw Error("invalid model file");
+      }
+      glm::vec3 polypoint = {data.v[vi0 * 3 + 0], data.v[vi0 * 3 + 1], data.v[vi0 * 3 + 2]};
+
+      scratch.points.emplace_back(glm::dot(polypoint, axis_u), glm::dot(polypoint, axis_v));
+    }
+    if (!ClipEars(scratch, raw_indices, data.indices)) {
+      // self intersecting or degenerate outlines are left to earcut, which allocates but copes with them
+      using Point2D = std::pair<float, float>;
+      std::vector<std::vector<Point2D>> polygon(1);
+      for (const glm::vec2& point : scratch.points) {
+        polygon[0].emplace_back(point.x, point.y);
+      }
+      std::vector order = mapbox::earcut(polygon);
+      if (order.size() % 3 != 0) {
+        throw Error("invalid obj model");
+      }
+      for (const auto idx : order) {
+        data.indices.push_back(raw_indices[idx]);
+      }
+    }
+  } else {
+    data.indices.insert(data.indices.end(), raw_indices, raw_indices + indices_len);
+  }
+}
+
+void ParseMtlFromFile(const std::string& path, Data& data) {
+  std::ifstream mtl_file(path, std::ifstream::binary);
+  if (!mtl_file.is_open()) {
+    throw Error("material file is not found");
+  }
+  std::vector<NewMtl> mtl = ParseMtlFile(mtl_file, data.dir_path);
+  std::move(mtl.begin(), mtl.end(), std::back_inserter(data.mtl));
+}
+
+Vertex GetVertex(const Data& data, const Indices& index) noexcept {
+  Vertex vertex = {};
+  std::memcpy(vertex.pos, &data.v[3 * static_cast<size_t>(index.fv)], sizeof(vertex.pos));
+  if (3 * static_cast<size_t>(index.fn) + 2 < data.vn.size()) {
+    std::memcpy(vertex.normal, &data.vn[3 * static_cast<size_t>(index.fn)], sizeof(vertex.normal));
+  }
+  if (2 * static_cast<size_t>(index.ft) + 1 < data.vt.size()) {
+    std::memcpy(vertex.tex_coord, &data.vt[2 * static_cast<size_t>(index.ft)], sizeof(vertex.tex_coord));
+  }
+  return vertex;
+}
 
+Data ParseFromFile(const std::string& path) {
+  TRACE_ZONE("obj::ParseFromFile");
+  Data data = {};
+  ParseFile(path, data, nullptr);
+  return data;
+}
+
+Data StreamFromFile(const std::string& path, const size_t chunk_budget, const std::function<void(const Chunk&)>& sink) {
+  TRACE_ZONE("obj::StreamFromFile");
+  Data data = {};
+  ChunkWriter writer(chunk_budget, sink);
+  ParseFile(path, data, &writer);
+  data.v = {};
+  data.vn = {};
+  data.vt = {};
   return data;
 }
 
-} // namespace obj
\ No newline at end of file
+} // namespace obj
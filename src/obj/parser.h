@@ -3,11 +3,22 @@
 
 #include "obj/types.h"
 
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace obj {
 
 Data ParseFromFile(const std::string& path);
+// Parses like ParseFromFile but hands the faces to sink in deduplicated chunks of about chunk_budget bytes instead of
+// keeping their indices, a vertex shared across chunks is repeated in each. The raw attributes are still held until the
+// end as faces may refer to any earlier one. The returned data only has the materials and the usemtl ranges.
+Data StreamFromFile(const std::string& path, size_t chunk_budget, const std::function<void(const Chunk&)>& sink);
+void ParseMtlFromFile(const std::string& path, Data& data);
+void ProcessPolygon(Data& data, const Indices* raw_indices, size_t indices_len);
+// Attributes of a parsed corner. The parser rejects positions it has not seen, a normal or texture coordinate the file
+// lacks reads as zeros.
+Vertex GetVertex(const Data& data, const Indices& index) noexcept;
 
 } // namespace obj
 
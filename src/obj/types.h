@@ -1,6 +1,8 @@
 #ifndef OBJ_TYPES_H_
 #define OBJ_TYPES_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
@@ -44,6 +46,24 @@ struct UseMtl {
   unsigned int offset;
 };
 
+// Attributes of a deduplicated corner, a corner without a normal or texture coordinate gets zeros.
+struct Vertex {
+  float pos[3];
+  float normal[3];
+  float tex_coord[2];
+};
+
+// Deduplicated vertices of a run of whole triangles and the indices of those triangles, which count from the first vertex
+// of the model. Chunks arrive in file order and never span two usemtl ranges.
+struct Chunk {
+  const Vertex* vertices;
+  size_t vertex_count;
+  size_t first_vertex;
+  const uint32_t* indices;
+  size_t index_count;
+  size_t first_index;
+};
+
 struct Data {
   std::string dir_path;
 
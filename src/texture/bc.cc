@@ -0,0 +1,347 @@
+#include "texture/bc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace texture::bc {
+
+namespace {
+
+constexpr int kTexelCount = 16;
+constexpr int kPowerIterations = 8;
+constexpr int kBc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+class BitWriter {
+public:
+  explicit BitWriter(uint8_t* block, const size_t size) noexcept : block_(block), bit_(0) {
+    std::memset(block, 0, size);
+  }
+
+  void Write(const uint32_t value, const int bits) noexcept {
+    for (int i = 0; i < bits; ++i, ++bit_) {
+      if ((value >> i) & 1) {
+        block_[bit_ >> 3] |= static_cast<uint8_t>(1 << (bit_ & 7));
+      }
+    }
+  }
+private:
+  uint8_t* block_;
+  size_t bit_;
+};
+
+// Fields are stored least significant bit first, as BitWriter writes them.
+uint32_t ReadBits(const uint8_t* block, const size_t bit, const int bits) noexcept {
+  uint32_t value = 0;
+  for (int i = 0; i < bits; ++i) {
+    value |= static_cast<uint32_t>((block[(bit + i) >> 3] >> ((bit + i) & 7)) & 1) << i;
+  }
+  return value;
+}
+
+void WriteBits(uint8_t* block, const size_t bit, const uint32_t value, const int bits) noexcept {
+  for (int i = 0; i < bits; ++i) {
+    const auto mask = static_cast<uint8_t>(1 << ((bit + i) & 7));
+    block[(bit + i) >> 3] = ((value >> i) & 1) ? block[(bit + i) >> 3] | mask : block[(bit + i) >> 3] & ~mask;
+  }
+}
+
+// Indices of bits each starting at bit, one per texel in row order.
+void FlipIndices(uint8_t* block, const size_t bit, const int bits, const int rows) noexcept {
+  uint32_t indices[kTexelCount];
+  for (int i = 0; i < kTexelCount; ++i) {
+    indices[i] = ReadBits(block, bit + i * bits, bits);
+  }
+  for (int row = 0; row < rows / 2; ++row) {
+    std::swap_ranges(indices + row * 4, indices + row * 4 + 4, indices + (rows - 1 - row) * 4);
+  }
+  for (int i = 0; i < kTexelCount; ++i) {
+    WriteBits(block, bit + i * bits, indices[i], bits);
+  }
+}
+
+// Endpoints of the texels spread along their principal axis, over the first channel_count channels.
+void FitEndpoints(const uint8_t* texels, const int channel_count, float* low, float* high) noexcept {
+  float mean[4] = {};
+  for (int i = 0; i < kTexelCount; ++i) {
+    for (int c = 0; c < channel_count; ++c) {
+      mean[c] += texels[i * 4 + c];
+    }
+  }
+  for (int c = 0; c < channel_count; ++c) {
+    mean[c] /= kTexelCount;
+  }
+  float covariance[4][4] = {};
+  for (int i = 0; i < kTexelCount; ++i) {
+    for (int a = 0; a < channel_count; ++a) {
+      for (int b = 0; b < channel_count; ++b) {
+        covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+      }
+    }
+  }
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < kPowerIterations; ++iteration) {
+    float next[4] = {};
+    float length = 0.0f;
+    for (int a = 0; a < channel_count; ++a) {
+      for (int b = 0; b < channel_count; ++b) {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      length = std::max(length, std::abs(next[a]));
+    }
+    if (length == 0.0f) {
+      break;
+    }
+    for (int c = 0; c < channel_count; ++c) {
+      axis[c] = next[c] / length;
+    }
+  }
+  float axis_length = 0.0f;
+  for (int c = 0; c < channel_count; ++c) {
+    axis_length += axis[c] * axis[c];
+  }
+  float min_t = 0.0f, max_t = 0.0f;
+  if (axis_length > 0.0f) {
+    min_t = std::numeric_limits<float>::max();
+    max_t = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < kTexelCount; ++i) {
+      float t = 0.0f;
+      for (int c = 0; c < channel_count; ++c) {
+        t += (texels[i * 4 + c] - mean[c]) * axis[c];
+      }
+      min_t = std::min(min_t, t / axis_length);
+      max_t = std::max(max_t, t / axis_length);
+    }
+  }
+  for (int c = 0; c < channel_count; ++c) {
+    low[c] = std::clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+    high[c] = std::clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+  }
+}
+
+uint16_t To565(const float* color) noexcept {
+  const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+  const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+  const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void From565(const uint16_t color, int* rgb) noexcept {
+  const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+void EncodeColor(const uint8_t* texels, uint8_t* block) noexcept {
+  float low[4], high[4];
+  FitEndpoints(texels, 3, low, high);
+
+  uint16_t color0 = To565(high), color1 = To565(low);
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+  int palette[4][3];
+  From565(color0, palette[0]);
+  From565(color1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+  BitWriter writer(block, 8);
+  writer.Write(color0, 16);
+  writer.Write(color1, 16);
+  for (int i = 0; i < kTexelCount; ++i) {
+    // equal endpoints leave every index at 0
+    int best_index = 0, best_error = std::numeric_limits<int>::max();
+    for (int index = 0; index < (color0 == color1 ? 1 : 4); ++index) {
+      int error = 0;
+      for (int c = 0; c < 3; ++c) {
+        const int delta = texels[i * 4 + c] - palette[index][c];
+        error += delta * delta;
+      }
+      if (error < best_error) {
+        best_error = error;
+        best_index = index;
+      }
+    }
+    writer.Write(best_index, 2);
+  }
+}
+
+void EncodeAlpha(const uint8_t* texels, uint8_t* block) noexcept {
+  int alpha0 = 0, alpha1 = 255;
+  for (int i = 0; i < kTexelCount; ++i) {
+    alpha0 = std::max<int>(alpha0, texels[i * 4 + 3]);
+    alpha1 = std::min<int>(alpha1, texels[i * 4 + 3]);
+  }
+  // alpha0 > alpha1 selects the eight value mode, 6 interpolated values between the endpoints
+  int palette[8] = {alpha0, alpha1};
+  for (int i = 1; i < 7; ++i) {
+    palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+  }
+  BitWriter writer(block, 8);
+  writer.Write(alpha0, 8);
+  writer.Write(alpha1, 8);
+  for (int i = 0; i < kTexelCount; ++i) {
+    int best_index = 0, best_error = std::numeric_limits<int>::max();
+    for (int index = 0; index < (alpha0 == alpha1 ? 1 : 8); ++index) {
+      if (const int error = std::abs(texels[i * 4 + 3] - palette[index]); error < best_error) {
+        best_error = error;
+        best_index = index;
+      }
+    }
+    writer.Write(best_index, 3);
+  }
+}
+
+int Bc7Interpolate(const int e0, const int e1, const int weight) noexcept {
+  return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+struct Bc7Candidate {
+  int quantized[2][4];
+  int p_bits[2];
+  int indices[kTexelCount];
+  int error;
+};
+
+void EvaluateBc7(const uint8_t* texels, const float* low, const float* high, Bc7Candidate& candidate) noexcept {
+  int endpoints[2][4];
+  for (int e = 0; e < 2; ++e) {
+    const float* source = e == 0 ? low : high;
+    for (int c = 0; c < 4; ++c) {
+      candidate.quantized[e][c] = std::clamp(static_cast<int>(std::lround((source[c] - candidate.p_bits[e]) / 2.0f)), 0, 127);
+      endpoints[e][c] = (candidate.quantized[e][c] << 1) | candidate.p_bits[e];
+    }
+  }
+  int direction[4], length_sq = 0;
+  for (int c = 0; c < 4; ++c) {
+    direction[c] = endpoints[1][c] - endpoints[0][c];
+    length_sq += direction[c] * direction[c];
+  }
+  candidate.error = 0;
+  for (int i = 0; i < kTexelCount; ++i) {
+    const uint8_t* texel = texels + i * 4;
+    int guess = 0;
+    if (length_sq > 0) {
+      int dot = 0;
+      for (int c = 0; c < 4; ++c) {
+        dot += (texel[c] - endpoints[0][c]) * direction[c];
+      }
+      guess = std::clamp(static_cast<int>(std::lround(15.0f * static_cast<float>(dot) / static_cast<float>(length_sq))), 0, 15);
+    }
+    // the weights are not evenly spaced, the neighbours of the projected index may fit better
+    int best_index = guess, best_error = std::numeric_limits<int>::max();
+    for (int index = std::max(guess - 1, 0); index <= std::min(guess + 1, 15); ++index) {
+      int error = 0;
+      for (int c = 0; c < 4; ++c) {
+        const int delta = texel[c] - Bc7Interpolate(endpoints[0][c], endpoints[1][c], kBc7Weights[index]);
+        error += delta * delta;
+      }
+      if (error < best_error) {
+        best_error = error;
+        best_index = index;
+      }
+    }
+    candidate.indices[i] = best_index;
+    candidate.error += best_error;
+  }
+}
+
+} // namespace
+
+void EncodeBc1(const uint8_t* texels, uint8_t* block) noexcept {
+  EncodeColor(texels, block);
+}
+
+void EncodeBc3(const uint8_t* texels, uint8_t* block) noexcept {
+  EncodeAlpha(texels, block);
+  EncodeColor(texels, block + 8);
+}
+
+void EncodeBc7(const uint8_t* texels, uint8_t* block) noexcept {
+  float low[4], high[4];
+  FitEndpoints(texels, 4, low, high);
+
+  Bc7Candidate best = {};
+  best.error = std::numeric_limits<int>::max();
+  for (int p_bits = 0; p_bits < 4; ++p_bits) {
+    Bc7Candidate candidate = {};
+    candidate.p_bits[0] = p_bits & 1;
+    candidate.p_bits[1] = p_bits >> 1;
+    EvaluateBc7(texels, low, high, candidate);
+    if (candidate.error < best.error) {
+      best = candidate;
+    }
+  }
+  // the anchor index is stored without its top bit, swapping the endpoints clears it
+  if (best.indices[0] >= 8) {
+    std::swap(best.quantized[0], best.quantized[1]);
+    std::swap(best.p_bits[0], best.p_bits[1]);
+    for (int& index : best.indices) {
+      index = 15 - index;
+    }
+  }
+  BitWriter writer(block, 16);
+  writer.Write(1 << 6, 7);
+  for (int c = 0; c < 4; ++c) {
+    writer.Write(best.quantized[0][c], 7);
+    writer.Write(best.quantized[1][c], 7);
+  }
+  writer.Write(best.p_bits[0], 1);
+  writer.Write(best.p_bits[1], 1);
+  writer.Write(best.indices[0], 3);
+  for (int i = 1; i < kTexelCount; ++i) {
+    writer.Write(best.indices[i], 4);
+  }
+}
+
+void FlipBc1(uint8_t* block, const int rows) noexcept {
+  FlipIndices(block, 32, 2, rows);
+}
+
+void FlipBc3(uint8_t* block, const int rows) noexcept {
+  FlipIndices(block, 16, 3, rows);
+  FlipBc1(block + 8, rows);
+}
+
+bool FlipBc7(uint8_t* block, const int rows) noexcept {
+  if ((block[0] & 0x7f) != 1 << 6) {
+    return false;
+  }
+  // mode 6: 7 mode bits, 7 bits per channel per endpoint interleaved, a p bit per endpoint, then the 3 bit anchor index
+  // followed by 4 bit indices
+  constexpr size_t kEndpointBit = 7, kPBit = 63, kIndexBit = 65;
+  int indices[kTexelCount];
+  indices[0] = static_cast<int>(ReadBits(block, kIndexBit, 3));
+  for (int i = 1; i < kTexelCount; ++i) {
+    indices[i] = static_cast<int>(ReadBits(block, kIndexBit + 3 + (i - 1) * 4, 4));
+  }
+  for (int row = 0; row < rows / 2; ++row) {
+    std::swap_ranges(indices + row * 4, indices + row * 4 + 4, indices + (rows - 1 - row) * 4);
+  }
+  // a new anchor with its top bit set is cleared by swapping the endpoints, as EncodeBc7 does
+  if (indices[0] >= 8) {
+    for (int c = 0; c < 4; ++c) {
+      const size_t bit = kEndpointBit + c * 14;
+      const uint32_t low = ReadBits(block, bit, 7), high = ReadBits(block, bit + 7, 7);
+      WriteBits(block, bit, high, 7);
+      WriteBits(block, bit + 7, low, 7);
+    }
+    const uint32_t p_bits = ReadBits(block, kPBit, 2);
+    WriteBits(block, kPBit, (p_bits >> 1) | ((p_bits & 1) << 1), 2);
+    for (int& index : indices) {
+      index = 15 - index;
+    }
+  }
+  WriteBits(block, kIndexBit, indices[0], 3);
+  for (int i = 1; i < kTexelCount; ++i) {
+    WriteBits(block, kIndexBit + 3 + (i - 1) * 4, indices[i], 4);
+  }
+  return true;
+}
+
+} // namespace texture::bc
@@ -0,0 +1,26 @@
+#ifndef TEXTURE_BC_H_
+#define TEXTURE_BC_H_
+
+#include <cstdint>
+
+namespace texture::bc {
+
+// Encoders take 16 rgba8 texels in row order and write one block.
+
+// 8 bytes, opaque four color mode.
+void EncodeBc1(const uint8_t* texels, uint8_t* block) noexcept;
+// 16 bytes, eight value interpolated alpha followed by a bc1 color block.
+void EncodeBc3(const uint8_t* texels, uint8_t* block) noexcept;
+// 16 bytes, mode 6 only: a single rgba endpoint pair with 4 bit indices.
+void EncodeBc7(const uint8_t* texels, uint8_t* block) noexcept;
+
+// Flips reverse the first rows rows of a block in place and keep the others.
+
+void FlipBc1(uint8_t* block, int rows) noexcept;
+void FlipBc3(uint8_t* block, int rows) noexcept;
+// False for any mode but 6, a flipped partition has no counterpart among the partition shapes.
+bool FlipBc7(uint8_t* block, int rows) noexcept;
+
+} // namespace texture::bc
+
+#endif // TEXTURE_BC_H_
@@ -0,0 +1,45 @@
+#include "texture/cache.h"
+
+#include <filesystem>
+
+#include "texture/error.h"
+#include "texture/ktx2.h"
+
+namespace texture {
+
+std::string CachePath(const std::string& source_path, const Format format) {
+  return source_path + '.' + std::string(FormatName(format)) + ".ktx2";
+}
+
+std::optional<Texture> LoadCached(const std::string& source_path, const std::vector<Format>& formats, const Destination& destination) {
+  std::error_code error_code;
+  const auto source_time = std::filesystem::last_write_time(source_path, error_code);
+  if (error_code) {
+    return std::nullopt;
+  }
+  for (const Format format : formats) {
+    const std::string cache_path = CachePath(source_path, format);
+    if (const auto cache_time = std::filesystem::last_write_time(cache_path, error_code); error_code || cache_time < source_time) {
+      continue;
+    }
+    try {
+      if (Texture texture = ReadKtx2(cache_path, destination); texture.format == format) {
+        return texture;
+      }
+    } catch (const Error&) {
+      // a corrupt copy is encoded again from the source
+    }
+  }
+  return std::nullopt;
+}
+
+bool StoreCached(const std::string& source_path, const Texture& texture) noexcept {
+  try {
+    WriteKtx2(CachePath(source_path, texture.format), texture);
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+} // namespace texture
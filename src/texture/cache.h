@@ -0,0 +1,21 @@
+#ifndef TEXTURE_CACHE_H_
+#define TEXTURE_CACHE_H_
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "texture/texture.h"
+
+namespace texture {
+
+// Encoded copies live next to the source image as <image>.<format>.ktx2 and are reused while newer than the source.
+[[nodiscard]] std::string CachePath(const std::string& source_path, Format format);
+// First up to date copy among formats, in their order, read into destination like ReadKtx2.
+[[nodiscard]] std::optional<Texture> LoadCached(const std::string& source_path, const std::vector<Format>& formats, const Destination& destination = {});
+// Returns false when the copy could not be written, a read-only asset directory only costs the encoding on every load.
+bool StoreCached(const std::string& source_path, const Texture& texture) noexcept;
+
+} // namespace texture
+
+#endif // TEXTURE_CACHE_H_
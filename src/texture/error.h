@@ -0,0 +1,14 @@
+#ifndef TEXTURE_ERROR_H_
+#define TEXTURE_ERROR_H_
+
+#include <stdexcept>
+
+namespace texture {
+
+struct Error final : std::runtime_error {
+  using runtime_error::runtime_error;
+};
+
+} // namespace texture
+
+#endif // TEXTURE_ERROR_H_
@@ -0,0 +1,349 @@
+#include "texture/ktx2.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#include "texture/bc.h"
+#include "texture/error.h"
+#include "trace/trace.h"
+
+namespace texture {
+
+namespace {
+
+constexpr uint8_t kIdentifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// VkFormat values, the unorm variants are read as srgb as well.
+constexpr uint32_t kVkFormatRgba8Unorm = 37;
+constexpr uint32_t kVkFormatRgba8Srgb = 43;
+constexpr uint32_t kVkFormatBc1RgbUnorm = 131;
+constexpr uint32_t kVkFormatBc1RgbSrgb = 132;
+constexpr uint32_t kVkFormatBc3Unorm = 137;
+constexpr uint32_t kVkFormatBc3Srgb = 138;
+constexpr uint32_t kVkFormatBc7Unorm = 145;
+constexpr uint32_t kVkFormatBc7Srgb = 146;
+
+// Khronos data format descriptor constants.
+constexpr uint32_t kDfdVersion = 2;
+constexpr uint32_t kDfdModelRgbsda = 1;
+constexpr uint32_t kDfdModelBc1a = 128;
+constexpr uint32_t kDfdModelBc3 = 130;
+constexpr uint32_t kDfdModelBc7 = 134;
+constexpr uint32_t kDfdPrimariesBt709 = 1;
+constexpr uint32_t kDfdTransferSrgb = 2;
+constexpr uint32_t kDfdChannelAlpha = 15;
+constexpr uint32_t kDfdSampleLinear = 0x10;
+
+// Levels are held bottom row first, the order stb decodes the sources in for the models' texture coordinates. Files say
+// so in their orientation entry, without one the rows run top down.
+constexpr std::string_view kOrientationKey = "KTXorientation";
+constexpr std::string_view kOrientation = "ru";
+
+struct Header {
+  uint8_t identifier[12];
+  uint32_t vk_format;
+  uint32_t type_size;
+  uint32_t pixel_width;
+  uint32_t pixel_height;
+  uint32_t pixel_depth;
+  uint32_t layer_count;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t supercompression_scheme;
+  uint32_t dfd_byte_offset;
+  uint32_t dfd_byte_length;
+  uint32_t kvd_byte_offset;
+  uint32_t kvd_byte_length;
+  uint64_t sgd_byte_offset;
+  uint64_t sgd_byte_length;
+};
+
+static_assert(sizeof(Header) == 80, "Header must match the KTX2 layout");
+
+struct LevelIndex {
+  uint64_t byte_offset;
+  uint64_t byte_length;
+  uint64_t uncompressed_byte_length;
+};
+
+struct DfdSample {
+  uint32_t bit_offset;
+  uint32_t bit_length;
+  uint32_t channel;
+  uint32_t lower;
+  uint32_t upper;
+};
+
+Format ToFormat(const uint32_t vk_format) {
+  switch (vk_format) {
+    case kVkFormatRgba8Unorm:
+    case kVkFormatRgba8Srgb:
+      return Format::kRgba8;
+    case kVkFormatBc1RgbUnorm:
+    case kVkFormatBc1RgbSrgb:
+      return Format::kBc1;
+    case kVkFormatBc3Unorm:
+    case kVkFormatBc3Srgb:
+      return Format::kBc3;
+    case kVkFormatBc7Unorm:
+    case kVkFormatBc7Srgb:
+      return Format::kBc7;
+    default:
+      throw Error("unsupported KTX2 vkFormat " + std::to_string(vk_format));
+  }
+}
+
+uint32_t ToVkFormat(const Format format) noexcept {
+  switch (format) {
+    case Format::kBc1:
+      return kVkFormatBc1RgbSrgb;
+    case Format::kBc3:
+      return kVkFormatBc3Srgb;
+    case Format::kBc7:
+      return kVkFormatBc7Srgb;
+    default:
+      return kVkFormatRgba8Srgb;
+  }
+}
+
+// Basic descriptor block, the samples describe which bits of a texel block hold which channel.
+std::vector<uint32_t> BuildDfd(const Format format) {
+  uint32_t model = kDfdModelRgbsda, block_dim = 0, bytes_plane = 4;
+  std::vector<DfdSample> samples;
+  switch (format) {
+    case Format::kBc1:
+      model = kDfdModelBc1a;
+      block_dim = 3 | (3 << 8);
+      bytes_plane = 8;
+      samples = {{0, 63, 0, 0, UINT32_MAX}};
+      break;
+    case Format::kBc3:
+      model = kDfdModelBc3;
+      block_dim = 3 | (3 << 8);
+      bytes_plane = 16;
+      samples = {{0, 63, kDfdChannelAlpha | kDfdSampleLinear, 0, UINT32_MAX}, {64, 63, 0, 0, UINT32_MAX}};
+      break;
+    case Format::kBc7:
+      model = kDfdModelBc7;
+      block_dim = 3 | (3 << 8);
+      bytes_plane = 16;
+      samples = {{0, 127, 0, 0, UINT32_MAX}};
+      break;
+    default:
+      samples = {{0, 7, 0, 0, 255}, {8, 7, 1, 0, 255}, {16, 7, 2, 0, 255}, {24, 7, kDfdChannelAlpha | kDfdSampleLinear, 0, 255}};
+      break;
+  }
+  const auto block_size = static_cast<uint32_t>(24 + 16 * samples.size());
+  std::vector<uint32_t> dfd = {
+    4 + block_size,
+    0,
+    kDfdVersion | (block_size << 16),
+    model | (kDfdPrimariesBt709 << 8) | (kDfdTransferSrgb << 16),
+    block_dim,
+    bytes_plane,
+    0
+  };
+  for (const DfdSample& sample : samples) {
+    dfd.insert(dfd.end(), {sample.bit_offset | (sample.bit_length << 16) | (sample.channel << 24), 0, sample.lower, sample.upper});
+  }
+  return dfd;
+}
+
+size_t AlignUp(const size_t value, const size_t alignment) noexcept {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// A single entry, the orientation of the levels.
+std::vector<uint8_t> BuildKvd() {
+  std::string entry(kOrientationKey);
+  entry += '\0';
+  entry += kOrientation;
+  entry += '\0';
+  const auto length = static_cast<uint32_t>(entry.size());
+  std::vector<uint8_t> kvd(sizeof(length) + AlignUp(length, 4), 0);
+  std::memcpy(kvd.data(), &length, sizeof(length));
+  std::memcpy(kvd.data() + sizeof(length), entry.data(), length);
+  return kvd;
+}
+
+// Whether the orientation entry has the rows run up, the way the levels are held.
+bool ReadBottomUp(std::ifstream& file, const Header& header, const std::string& path) {
+  std::vector<char> kvd(header.kvd_byte_length);
+  file.seekg(header.kvd_byte_offset);
+  if (!file.read(kvd.data(), static_cast<std::streamsize>(kvd.size()))) {
+    throw Error("truncated KTX2 key/value data in " + path);
+  }
+  for (size_t offset = 0; offset + sizeof(uint32_t) <= kvd.size();) {
+    uint32_t length = 0;
+    std::memcpy(&length, kvd.data() + offset, sizeof(length));
+    offset += sizeof(length);
+    if (length > kvd.size() - offset) {
+      break;
+    }
+    const std::string_view entry(kvd.data() + offset, length);
+    if (const size_t key_end = entry.find('\0'); key_end != std::string_view::npos && entry.substr(0, key_end) == kOrientationKey) {
+      return key_end + 2 < entry.size() && entry[key_end + 2] == kOrientation[1];
+    }
+    offset += AlignUp(length, 4);
+  }
+  return false;
+}
+
+// Copies a level with its rows reversed. Block formats reverse the block rows and the rows inside every block, which is
+// exact for heights that are a multiple of 4 or fit one block and leaves other levels up to 3 rows off. False when a
+// block cannot be flipped.
+bool FlipLevel(const Format format, const Level& level, const uint8_t* src, uint8_t* dst) noexcept {
+  if (format == Format::kRgba8) {
+    const size_t row_size = static_cast<size_t>(level.width) * 4;
+    for (uint32_t y = 0; y < level.height; ++y) {
+      std::memcpy(dst + y * row_size, src + (level.height - 1 - y) * row_size, row_size);
+    }
+    return true;
+  }
+  const size_t block_size = LevelSize(format, 1, 1);
+  const uint32_t block_rows = (level.height + 3) / 4;
+  const size_t row_size = level.size / block_rows;
+  const int rows = block_rows == 1 ? static_cast<int>(level.height) : 4;
+  for (uint32_t y = 0; y < block_rows; ++y) {
+    uint8_t* row = dst + y * row_size;
+    std::memcpy(row, src + (block_rows - 1 - y) * row_size, row_size);
+    for (size_t offset = 0; offset < row_size; offset += block_size) {
+      if (format == Format::kBc1) {
+        bc::FlipBc1(row + offset, rows);
+      } else if (format == Format::kBc3) {
+        bc::FlipBc3(row + offset, rows);
+      } else if (!bc::FlipBc7(row + offset, rows)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+Texture ReadKtx2(const std::string& path, const Destination& destination) {
+  TRACE_ZONE("texture::ReadKtx2");
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    throw Error("failed to open " + path);
+  }
+  const auto file_size = static_cast<uint64_t>(file.tellg());
+  file.seekg(0);
+
+  Header header = {};
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(Header))) {
+    throw Error("truncated KTX2 header in " + path);
+  }
+  if (std::memcmp(header.identifier, kIdentifier, sizeof(kIdentifier)) != 0) {
+    throw Error(path + " is not a KTX2 file");
+  }
+  if (header.supercompression_scheme != 0) {
+    throw Error("KTX2 supercompression is not supported in " + path);
+  }
+  if (header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1 || header.pixel_width == 0 || header.pixel_height == 0) {
+    throw Error("only 2d KTX2 textures are supported, " + path);
+  }
+  Texture texture = {};
+  texture.format = ToFormat(header.vk_format);
+  texture.width = header.pixel_width;
+  texture.height = header.pixel_height;
+
+  std::vector<LevelIndex> level_indices(std::max(header.level_count, 1u));
+  if (!file.read(reinterpret_cast<char*>(level_indices.data()), static_cast<std::streamsize>(level_indices.size() * sizeof(LevelIndex)))) {
+    throw Error("truncated KTX2 level index in " + path);
+  }
+  const bool bottom_up = ReadBottomUp(file, header, path);
+  // the layout is known before any texel is read, so the levels go to their final place in one read each
+  size_t data_size = 0;
+  uint32_t width = texture.width, height = texture.height;
+  for (size_t i = 0; i < level_indices.size(); ++i) {
+    const size_t size = LevelSize(texture.format, width, height);
+    if (level_indices[i].byte_length != size || level_indices[i].byte_offset + size > file_size) {
+      throw Error("corrupt KTX2 level " + std::to_string(i) + " in " + path);
+    }
+    texture.levels.push_back({width, height, data_size, size});
+    data_size += size;
+
+    width = std::max(width / 2, 1u);
+    height = std::max(height / 2, 1u);
+  }
+  uint8_t* data = destination ? destination(data_size) : nullptr;
+  if (data == nullptr) {
+    texture.data.resize(data_size);
+    data = texture.data.data();
+  }
+  // top down levels are read aside and flipped into place
+  std::vector<uint8_t> stored;
+  for (size_t i = 0; i < level_indices.size(); ++i) {
+    uint8_t* level_data = data + texture.levels[i].offset;
+    if (!bottom_up) {
+      stored.resize(texture.levels[i].size);
+      level_data = stored.data();
+    }
+    file.seekg(static_cast<std::streamoff>(level_indices[i].byte_offset));
+    if (!file.read(reinterpret_cast<char*>(level_data), static_cast<std::streamsize>(texture.levels[i].size))) {
+      throw Error("failed to read KTX2 level " + std::to_string(i) + " of " + path);
+    }
+    if (!bottom_up && !FlipLevel(texture.format, texture.levels[i], stored.data(), data + texture.levels[i].offset)) {
+      throw Error("only mode 6 BC7 blocks can be flipped, " + path + " runs top down");
+    }
+  }
+  return texture;
+}
+
+void WriteKtx2(const std::string& path, const Texture& texture) {
+  TRACE_ZONE("texture::WriteKtx2");
+  const std::vector<uint32_t> dfd = BuildDfd(texture.format);
+  const std::vector<uint8_t> kvd = BuildKvd();
+  const size_t alignment = texture.format == Format::kRgba8 ? 4 : LevelSize(texture.format, 1, 1);
+
+  Header header = {};
+  std::memcpy(header.identifier, kIdentifier, sizeof(kIdentifier));
+  header.vk_format = ToVkFormat(texture.format);
+  header.type_size = 1;
+  header.pixel_width = texture.width;
+  header.pixel_height = texture.height;
+  header.face_count = 1;
+  header.level_count = static_cast<uint32_t>(texture.levels.size());
+  header.dfd_byte_offset = static_cast<uint32_t>(sizeof(Header) + texture.levels.size() * sizeof(LevelIndex));
+  header.dfd_byte_length = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+  header.kvd_byte_offset = header.dfd_byte_offset + header.dfd_byte_length;
+  header.kvd_byte_length = static_cast<uint32_t>(kvd.size());
+
+  // level data is stored smallest mip first
+  std::vector<LevelIndex> level_indices(texture.levels.size());
+  size_t offset = header.kvd_byte_offset + header.kvd_byte_length;
+  for (size_t i = texture.levels.size(); i-- > 0;) {
+    offset = AlignUp(offset, alignment);
+    level_indices[i] = {offset, texture.levels[i].size, texture.levels[i].size};
+    offset += texture.levels[i].size;
+  }
+  std::vector<uint8_t> bytes(offset, 0);
+  std::memcpy(bytes.data(), &header, sizeof(Header));
+  std::memcpy(bytes.data() + sizeof(Header), level_indices.data(), level_indices.size() * sizeof(LevelIndex));
+  std::memcpy(bytes.data() + header.dfd_byte_offset, dfd.data(), header.dfd_byte_length);
+  std::memcpy(bytes.data() + header.kvd_byte_offset, kvd.data(), header.kvd_byte_length);
+  for (size_t i = 0; i < texture.levels.size(); ++i) {
+    std::memcpy(bytes.data() + level_indices[i].byte_offset, texture.data.data() + texture.levels[i].offset, texture.levels[i].size);
+  }
+  // written aside and renamed so a concurrent reader never sees a partial file
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()))) {
+      throw Error("failed to write " + temp_path);
+    }
+  }
+  std::error_code error_code;
+  std::filesystem::rename(temp_path, path, error_code);
+  if (error_code) {
+    std::filesystem::remove(temp_path, error_code);
+    throw Error("failed to replace " + path);
+  }
+}
+
+} // namespace texture
@@ -0,0 +1,18 @@
+#ifndef TEXTURE_KTX2_H_
+#define TEXTURE_KTX2_H_
+
+#include <string>
+
+#include "texture/texture.h"
+
+namespace texture {
+
+// Reads 2d KTX2 files of the supported formats without supercompression, Basis payloads are rejected. The levels are read
+// from the file into destination when it provides the memory. Levels are held bottom row first, files whose KTXorientation
+// entry does not say so run top down and are flipped on the way in. Written files carry the entry.
+[[nodiscard]] Texture ReadKtx2(const std::string& path, const Destination& destination = {});
+void WriteKtx2(const std::string& path, const Texture& texture);
+
+} // namespace texture
+
+#endif // TEXTURE_KTX2_H_
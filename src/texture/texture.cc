@@ -0,0 +1,352 @@
+#include "texture/texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+
+#include "texture/bc.h"
+#include "texture/error.h"
+#include "trace/trace.h"
+
+namespace texture {
+
+namespace {
+
+constexpr uint32_t kBlockDim = 4;
+// Rows below this are filtered or encoded on the calling thread, small mips are not worth a task.
+constexpr uint32_t kMinParallelRows = 16;
+constexpr float kPi = 3.14159265358979f;
+// Half width of the mip filter in destination texels, and the shape of its window.
+constexpr float kFilterRadius = 2.0f;
+constexpr float kKaiserAlpha = 4.0f;
+
+using BlockEncoder = void(*)(const uint8_t*, uint8_t*) noexcept;
+
+BlockEncoder GetBlockEncoder(const Format format) {
+  switch (format) {
+    case Format::kBc1:
+      return bc::EncodeBc1;
+    case Format::kBc3:
+      return bc::EncodeBc3;
+    case Format::kBc7:
+      return bc::EncodeBc7;
+    default:
+      throw Error("format has no block encoder");
+  }
+}
+
+std::vector<Level> GetLevels(const Format format, uint32_t width, uint32_t height, const size_t level_count) {
+  std::vector<Level> levels;
+  levels.reserve(level_count);
+  size_t offset = 0;
+  for (size_t i = 0; i < level_count; ++i) {
+    const size_t size = LevelSize(format, width, height);
+    levels.push_back({width, height, offset, size});
+    offset += size;
+    width = std::max(width / 2, 1u);
+    height = std::max(height / 2, 1u);
+  }
+  return levels;
+}
+
+// Filter taps of one axis, every destination texel reads count taps starting at its first index.
+struct Taps {
+  size_t count;
+  std::vector<uint32_t> indices;
+  std::vector<float> weights;
+};
+
+float SrgbToLinear(const float value) noexcept {
+  return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+uint8_t LinearToSrgb(float value) noexcept {
+  value = std::clamp(value, 0.0f, 1.0f);
+  value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+  return static_cast<uint8_t>(value * 255.0f + 0.5f);
+}
+
+float BesselI0(const float x) noexcept {
+  float sum = 1.0f, term = 1.0f;
+  for (int k = 1; k < 16; ++k) {
+    term *= (x * 0.5f / static_cast<float>(k)) * (x * 0.5f / static_cast<float>(k));
+    sum += term;
+  }
+  return sum;
+}
+
+// Kaiser windowed sinc, x in destination texels.
+float Kaiser(const float x) noexcept {
+  if (std::abs(x) >= kFilterRadius) {
+    return 0.0f;
+  }
+  const float window = x / kFilterRadius;
+  const float sinc = x == 0.0f ? 1.0f : std::sin(kPi * x) / (kPi * x);
+  return sinc * BesselI0(kKaiserAlpha * std::sqrt(1.0f - window * window)) / BesselI0(kKaiserAlpha);
+}
+
+Taps GetTaps(const uint32_t src_size, const uint32_t dst_size) {
+  if (src_size == dst_size) {
+    Taps taps = {1, std::vector<uint32_t>(dst_size), std::vector<float>(dst_size, 1.0f)};
+    for (uint32_t i = 0; i < dst_size; ++i) {
+      taps.indices[i] = i;
+    }
+    return taps;
+  }
+  const float scale = static_cast<float>(src_size) / static_cast<float>(dst_size);
+  Taps taps = {};
+  taps.count = static_cast<size_t>(std::ceil(kFilterRadius * scale)) * 2;
+  taps.indices.resize(dst_size * taps.count);
+  taps.weights.resize(dst_size * taps.count);
+  for (uint32_t i = 0; i < dst_size; ++i) {
+    const float center = (static_cast<float>(i) + 0.5f) * scale;
+    const auto first = static_cast<int64_t>(std::floor(center)) - static_cast<int64_t>(taps.count / 2);
+    float sum = 0.0f;
+    for (size_t tap = 0; tap < taps.count; ++tap) {
+      const int64_t index = first + static_cast<int64_t>(tap);
+      const float weight = Kaiser((static_cast<float>(index) + 0.5f - center) / scale);
+      taps.indices[i * taps.count + tap] = static_cast<uint32_t>(std::clamp<int64_t>(index, 0, src_size - 1));
+      taps.weights[i * taps.count + tap] = weight;
+      sum += weight;
+    }
+    for (size_t tap = 0; tap < taps.count; ++tap) {
+      taps.weights[i * taps.count + tap] /= sum;
+    }
+  }
+  return taps;
+}
+
+// Splits [0, count) into one range per hardware thread, counts below min_count stay on the calling thread.
+template<typename Func>
+void ParallelFor(const uint32_t count, const uint32_t min_count, const Func& func) {
+  if (count < min_count) {
+    func(0u, count);
+    return;
+  }
+  const uint32_t worker_count = std::max(std::thread::hardware_concurrency(), 1u);
+  const uint32_t per_task = (count + worker_count - 1) / worker_count;
+  std::vector<std::future<void>> tasks;
+  for (uint32_t begin = per_task; begin < count; begin += per_task) {
+    tasks.emplace_back(std::async(std::launch::async, func, begin, std::min(begin + per_task, count)));
+  }
+  func(0u, std::min(per_task, count));
+  for (std::future<void>& task : tasks) {
+    task.get();
+  }
+}
+
+// Separable resample of premultiplied linear texels, four floats per texel so the tap loops vectorize.
+std::vector<float> Downsample(const std::vector<float>& src, const Level& src_level, const Level& dst_level) {
+  const Taps taps_x = GetTaps(src_level.width, dst_level.width);
+  const Taps taps_y = GetTaps(src_level.height, dst_level.height);
+
+  std::vector<float> rows(static_cast<size_t>(dst_level.width) * src_level.height * 4);
+  ParallelFor(src_level.height, kMinParallelRows, [&](const uint32_t begin, const uint32_t end) {
+    for (uint32_t y = begin; y < end; ++y) {
+      const float* src_row = src.data() + static_cast<size_t>(y) * src_level.width * 4;
+      for (uint32_t x = 0; x < dst_level.width; ++x) {
+        float texel[4] = {};
+        for (size_t tap = 0; tap < taps_x.count; ++tap) {
+          const float* src_texel = src_row + taps_x.indices[x * taps_x.count + tap] * 4;
+          const float weight = taps_x.weights[x * taps_x.count + tap];
+          for (int c = 0; c < 4; ++c) {
+            texel[c] += src_texel[c] * weight;
+          }
+        }
+        std::copy_n(texel, 4, rows.data() + (static_cast<size_t>(y) * dst_level.width + x) * 4);
+      }
+    }
+  });
+  std::vector<float> dst(static_cast<size_t>(dst_level.width) * dst_level.height * 4);
+  ParallelFor(dst_level.height, kMinParallelRows, [&](const uint32_t begin, const uint32_t end) {
+    for (uint32_t y = begin; y < end; ++y) {
+      float* dst_row = dst.data() + static_cast<size_t>(y) * dst_level.width * 4;
+      for (size_t tap = 0; tap < taps_y.count; ++tap) {
+        const float* src_row = rows.data() + static_cast<size_t>(taps_y.indices[y * taps_y.count + tap]) * dst_level.width * 4;
+        const float weight = taps_y.weights[y * taps_y.count + tap];
+        for (size_t i = 0; i < static_cast<size_t>(dst_level.width) * 4; ++i) {
+          dst_row[i] += src_row[i] * weight;
+        }
+      }
+    }
+  });
+  return dst;
+}
+
+void Encode(const std::vector<float>& texels, uint8_t* dst, const size_t pixel_count) noexcept {
+  for (size_t i = 0; i < pixel_count; ++i) {
+    const float* texel = texels.data() + i * 4;
+    const float alpha = std::clamp(texel[3], 0.0f, 1.0f);
+    const float inverse_alpha = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+    for (int c = 0; c < 3; ++c) {
+      dst[i * 4 + c] = LinearToSrgb(texel[c] * inverse_alpha);
+    }
+    dst[i * 4 + 3] = static_cast<uint8_t>(alpha * 255.0f + 0.5f);
+  }
+}
+
+std::vector<float> GetSrgbToLinear() {
+  std::vector<float> srgb_to_linear(256);
+  for (int i = 0; i < 256; ++i) {
+    srgb_to_linear[i] = SrgbToLinear(static_cast<float>(i) / 255.0f);
+  }
+  return srgb_to_linear;
+}
+
+void EncodeBlockRow(const BlockEncoder encoder, const size_t block_size, const uint8_t* src, const Level& level, uint8_t* dst, const uint32_t block_y) noexcept {
+  const uint32_t blocks_x = (level.width + kBlockDim - 1) / kBlockDim;
+  uint8_t texels[kBlockDim * kBlockDim * 4];
+  for (uint32_t block_x = 0; block_x < blocks_x; ++block_x) {
+    for (uint32_t y = 0; y < kBlockDim; ++y) {
+      const uint32_t src_y = std::min(block_y * kBlockDim + y, level.height - 1);
+      for (uint32_t x = 0; x < kBlockDim; ++x) {
+        const uint32_t src_x = std::min(block_x * kBlockDim + x, level.width - 1);
+        std::memcpy(texels + (y * kBlockDim + x) * 4, src + (src_y * level.width + src_x) * 4, 4);
+      }
+    }
+    encoder(texels, dst + (static_cast<size_t>(block_y) * blocks_x + block_x) * block_size);
+  }
+}
+
+} // namespace
+
+size_t LevelSize(const Format format, const uint32_t width, const uint32_t height) noexcept {
+  if (format == Format::kRgba8) {
+    return static_cast<size_t>(width) * height * 4;
+  }
+  const size_t block_count = static_cast<size_t>((width + kBlockDim - 1) / kBlockDim) * ((height + kBlockDim - 1) / kBlockDim);
+  return block_count * (format == Format::kBc1 ? 8 : 16);
+}
+
+bool HasAlpha(const uint8_t* pixels, const uint32_t width, const uint32_t height) noexcept {
+  const size_t pixel_count = static_cast<size_t>(width) * height;
+  for (size_t i = 0; i < pixel_count; ++i) {
+    if (pixels[i * 4 + 3] != 0xff) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Format ChooseFormat(const std::vector<Format>& supported, const bool alpha) noexcept {
+  for (const Format format : supported) {
+    if (!alpha || format != Format::kBc1) {
+      return format;
+    }
+  }
+  return Format::kRgba8;
+}
+
+Texture BuildMips(const uint8_t* pixels, const uint32_t width, const uint32_t height) {
+  TRACE_ZONE("texture::BuildMips");
+  const auto level_count = static_cast<size_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+  Texture texture = {};
+  texture.format = Format::kRgba8;
+  texture.width = width;
+  texture.height = height;
+  texture.levels = GetLevels(Format::kRgba8, width, height, level_count);
+  texture.data.resize(texture.levels.back().offset + texture.levels.back().size);
+
+  std::memcpy(texture.data.data(), pixels, texture.levels[0].size);
+
+  const std::vector<float> srgb_to_linear = GetSrgbToLinear();
+  // levels are filtered from the unquantized previous level, rounding errors do not pile up down the chain
+  std::vector<float> texels(texture.levels[0].size);
+  for (size_t i = 0; i < texels.size(); i += 4) {
+    const float alpha = static_cast<float>(pixels[i + 3]) / 255.0f;
+    for (size_t c = 0; c < 3; ++c) {
+      texels[i + c] = srgb_to_linear[pixels[i + c]] * alpha;
+    }
+    texels[i + 3] = alpha;
+  }
+  for (size_t i = 1; i < level_count; ++i) {
+    const Level& dst = texture.levels[i];
+    texels = Downsample(texels, texture.levels[i - 1], dst);
+    Encode(texels, texture.data.data() + dst.offset, static_cast<size_t>(dst.width) * dst.height);
+  }
+  return texture;
+}
+
+std::vector<uint8_t> Halve(const uint8_t* pixels, const uint32_t width, const uint32_t height) {
+  const std::vector<float> srgb_to_linear = GetSrgbToLinear();
+  const uint32_t dst_width = (width + 1) / 2, dst_height = (height + 1) / 2;
+
+  std::vector<uint8_t> halved(static_cast<size_t>(dst_width) * dst_height * 4);
+  ParallelFor(dst_height, kMinParallelRows, [&](const uint32_t begin, const uint32_t end) {
+    std::vector<float> row(static_cast<size_t>(dst_width) * 4);
+    for (uint32_t y = begin; y < end; ++y) {
+      std::fill(row.begin(), row.end(), 0.0f);
+      for (const uint32_t src_y : {std::min(y * 2, height - 1), std::min(y * 2 + 1, height - 1)}) {
+        for (uint32_t x = 0; x < dst_width; ++x) {
+          for (const uint32_t src_x : {std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1)}) {
+            const uint8_t* texel = pixels + (static_cast<size_t>(src_y) * width + src_x) * 4;
+            const float alpha = static_cast<float>(texel[3]) / 255.0f;
+            for (int c = 0; c < 3; ++c) {
+              row[x * 4 + c] += srgb_to_linear[texel[c]] * alpha * 0.25f;
+            }
+            row[x * 4 + 3] += alpha * 0.25f;
+          }
+        }
+      }
+      Encode(row, halved.data() + static_cast<size_t>(y) * dst_width * 4, dst_width);
+    }
+  });
+  return halved;
+}
+
+Texture DropLevels(const Texture& texture, const size_t first_level) {
+  if (first_level >= texture.levels.size()) {
+    throw Error("texture has no level " + std::to_string(first_level));
+  }
+  const size_t first_offset = texture.levels[first_level].offset;
+
+  Texture dropped = {};
+  dropped.format = texture.format;
+  dropped.width = texture.levels[first_level].width;
+  dropped.height = texture.levels[first_level].height;
+  dropped.levels.assign(texture.levels.begin() + static_cast<ptrdiff_t>(first_level), texture.levels.end());
+  for (Level& level : dropped.levels) {
+    level.offset -= first_offset;
+  }
+  dropped.data.assign(texture.data.begin() + static_cast<ptrdiff_t>(first_offset), texture.data.end());
+  return dropped;
+}
+
+Texture Compress(const Texture& texture, const Format format) {
+  TRACE_ZONE("texture::Compress");
+  if (texture.format != Format::kRgba8) {
+    throw Error("only rgba8 textures can be compressed");
+  }
+  if (format == Format::kRgba8) {
+    return texture;
+  }
+  const BlockEncoder encoder = GetBlockEncoder(format);
+  const size_t block_size = LevelSize(format, 1, 1);
+
+  Texture compressed = {};
+  compressed.format = format;
+  compressed.width = texture.width;
+  compressed.height = texture.height;
+  compressed.levels = GetLevels(format, texture.width, texture.height, texture.levels.size());
+  compressed.data.resize(compressed.levels.back().offset + compressed.levels.back().size);
+
+  for (size_t i = 0; i < texture.levels.size(); ++i) {
+    const Level& level = texture.levels[i];
+    const uint8_t* src = texture.data.data() + level.offset;
+    uint8_t* dst = compressed.data.data() + compressed.levels[i].offset;
+    const uint32_t block_rows = (level.height + kBlockDim - 1) / kBlockDim;
+
+    ParallelFor(block_rows, kMinParallelRows, [=, &level](const uint32_t begin, const uint32_t end) {
+      for (uint32_t block_y = begin; block_y < end; ++block_y) {
+        EncodeBlockRow(encoder, block_size, src, level, dst, block_y);
+      }
+    });
+  }
+  return compressed;
+}
+
+} // namespace texture
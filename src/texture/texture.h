@@ -0,0 +1,72 @@
+#ifndef TEXTURE_TEXTURE_H_
+#define TEXTURE_TEXTURE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace texture {
+
+// Every format holds srgb encoded color with straight alpha.
+enum class Format : uint32_t {
+  kRgba8,
+  kBc1,
+  kBc3,
+  kBc7
+};
+
+struct Level {
+  uint32_t width;
+  uint32_t height;
+  size_t offset;
+  size_t size;
+};
+
+// Mip levels are packed back to back in data, level 0 first. A texture read into a destination keeps data empty, its
+// levels are packed the same way there.
+struct Texture {
+  Format format;
+  uint32_t width;
+  uint32_t height;
+  std::vector<Level> levels;
+  std::vector<uint8_t> data;
+};
+
+// Memory for size bytes of levels, asked for by a reader once the header told it the size. nullptr keeps them in data.
+using Destination = std::function<uint8_t*(size_t size)>;
+
+constexpr std::string_view FormatName(const Format format) noexcept {
+  switch (format) {
+    case Format::kRgba8:
+      return "rgba8";
+    case Format::kBc1:
+      return "bc1";
+    case Format::kBc3:
+      return "bc3";
+    case Format::kBc7:
+      return "bc7";
+    default:
+      return "unknown";
+  }
+}
+
+[[nodiscard]] size_t LevelSize(Format format, uint32_t width, uint32_t height) noexcept;
+[[nodiscard]] bool HasAlpha(const uint8_t* pixels, uint32_t width, uint32_t height) noexcept;
+// First of the supported formats, best first, able to hold the alpha channel, rgba8 when none is.
+[[nodiscard]] Format ChooseFormat(const std::vector<Format>& supported, bool alpha) noexcept;
+
+// Full mip chain of rgba8 pixels, filtered in linear space with premultiplied alpha by a Kaiser windowed sinc.
+[[nodiscard]] Texture BuildMips(const uint8_t* pixels, uint32_t width, uint32_t height);
+// Next level of rgba8 pixels, (width + 1) / 2 by (height + 1) / 2, each texel the gamma correct premultiplied average of
+// the 2x2 texels it covers. Odd edges repeat their last row and column, so every level is exactly half of the previous one.
+[[nodiscard]] std::vector<uint8_t> Halve(const uint8_t* pixels, uint32_t width, uint32_t height);
+// The levels from first_level on, as a texture of their own.
+[[nodiscard]] Texture DropLevels(const Texture& texture, size_t first_level);
+// Encodes every level of an rgba8 texture into 4x4 blocks, partial edge blocks repeat their last row and column.
+[[nodiscard]] Texture Compress(const Texture& texture, Format format);
+
+} // namespace texture
+
+#endif // TEXTURE_TEXTURE_H_
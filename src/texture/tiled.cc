@@ -0,0 +1,180 @@
+#include "texture/tiled.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "texture/error.h"
+#include "texture/texture.h"
+#include "trace/trace.h"
+
+namespace texture {
+
+namespace {
+
+constexpr char kMagic[4] = {'V', 'T', 'X', '1'};
+
+struct Header {
+  char magic[4];
+  uint32_t width;
+  uint32_t height;
+  uint32_t tile_size;
+  uint32_t tile_border;
+};
+
+uint32_t NextPowerOfTwo(const uint32_t value) noexcept {
+  uint32_t power = 1;
+  while (power < value) {
+    power *= 2;
+  }
+  return power;
+}
+
+uint32_t Log2(uint32_t value) noexcept {
+  uint32_t log = 0;
+  while (value > 1) {
+    value /= 2;
+    ++log;
+  }
+  return log;
+}
+
+void CutTileRow(const uint8_t* pixels, const uint32_t width, const uint32_t height, const uint32_t columns, const uint32_t tile_y, uint8_t* dst) noexcept {
+  for (uint32_t tile_x = 0; tile_x < columns; ++tile_x) {
+    uint8_t* tile = dst + tile_x * kTileBytes;
+    for (uint32_t y = 0; y < kTileStride; ++y) {
+      const auto src_y = static_cast<uint32_t>(std::clamp<int64_t>(static_cast<int64_t>(tile_y * kTileSize + y) - kTileBorder, 0, height - 1));
+      for (uint32_t x = 0; x < kTileStride; ++x) {
+        const auto src_x = static_cast<uint32_t>(std::clamp<int64_t>(static_cast<int64_t>(tile_x * kTileSize + x) - kTileBorder, 0, width - 1));
+        std::memcpy(tile + (y * kTileStride + x) * 4, pixels + (static_cast<size_t>(src_y) * width + src_x) * 4, 4);
+      }
+    }
+  }
+}
+
+} // namespace
+
+uint32_t TileLayout::LevelColumns(const uint32_t level) const noexcept {
+  return std::max(columns >> level, 1u);
+}
+
+uint32_t TileLayout::LevelRows(const uint32_t level) const noexcept {
+  return std::max(rows >> level, 1u);
+}
+
+uint32_t TileLayout::FirstTile(const uint32_t level) const noexcept {
+  uint32_t first = 0;
+  for (uint32_t i = 0; i < level; ++i) {
+    first += LevelColumns(i) * LevelRows(i);
+  }
+  return first;
+}
+
+uint32_t TileLayout::TileCount() const noexcept {
+  return FirstTile(level_count);
+}
+
+TileLayout GetTileLayout(const uint32_t width, const uint32_t height) noexcept {
+  TileLayout layout = {};
+  layout.width = width;
+  layout.height = height;
+  layout.columns = NextPowerOfTwo((width + kTileSize - 1) / kTileSize);
+  layout.rows = NextPowerOfTwo((height + kTileSize - 1) / kTileSize);
+  layout.level_count = Log2(std::max(layout.columns, layout.rows)) + 1;
+  return layout;
+}
+
+TiledFile::TiledFile(const std::string& path) : path_(path), file_(path, std::ios::binary), layout_() {
+  Header header = {};
+  if (!file_.read(reinterpret_cast<char*>(&header), sizeof(Header)) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw Error(path + " is not a tile file");
+  }
+  if (header.tile_size != kTileSize || header.tile_border != kTileBorder || header.width == 0 || header.height == 0) {
+    throw Error("unsupported tile size in " + path);
+  }
+  layout_ = GetTileLayout(header.width, header.height);
+
+  std::error_code error_code;
+  if (std::filesystem::file_size(path, error_code) != sizeof(Header) + layout_.TileCount() * kTileBytes || error_code) {
+    throw Error("truncated tile file " + path);
+  }
+}
+
+void TiledFile::ReadTile(const uint32_t tile, uint8_t* dst) {
+  TRACE_ZONE("TiledFile::ReadTile");
+  file_.seekg(static_cast<std::streamoff>(sizeof(Header) + tile * kTileBytes));
+  if (!file_.read(reinterpret_cast<char*>(dst), kTileBytes)) {
+    file_.clear();
+    throw Error("failed to read tile " + std::to_string(tile) + " of " + path_);
+  }
+}
+
+std::string TiledPath(const std::string& source_path) {
+  return source_path + ".tiles";
+}
+
+std::optional<TiledFile> OpenTiled(const std::string& source_path) {
+  const std::string path = TiledPath(source_path);
+  std::error_code error_code;
+  const auto source_time = std::filesystem::last_write_time(source_path, error_code);
+  if (error_code) {
+    return std::nullopt;
+  }
+  if (const auto tiled_time = std::filesystem::last_write_time(path, error_code); error_code || tiled_time < source_time) {
+    return std::nullopt;
+  }
+  try {
+    return TiledFile(path);
+  } catch (const Error&) {
+    // a corrupt file is cut again from the source
+  }
+  return std::nullopt;
+}
+
+void WriteTiled(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height) {
+  TRACE_ZONE("texture::WriteTiled");
+  const TileLayout layout = GetTileLayout(width, height);
+
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.width = width;
+  header.height = height;
+  header.tile_size = kTileSize;
+  header.tile_border = kTileBorder;
+
+  // written aside and renamed so a concurrent reader never sees a partial file
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+    std::vector<uint8_t> level_pixels;
+    std::vector<uint8_t> tile_row;
+    for (uint32_t level = 0; level < layout.level_count && file; ++level) {
+      const uint32_t columns = layout.LevelColumns(level);
+      tile_row.resize(columns * kTileBytes);
+      for (uint32_t tile_y = 0; tile_y < layout.LevelRows(level); ++tile_y) {
+        CutTileRow(pixels, width, height, columns, tile_y, tile_row.data());
+        file.write(reinterpret_cast<const char*>(tile_row.data()), static_cast<std::streamsize>(tile_row.size()));
+      }
+      if (level + 1 < layout.level_count) {
+        level_pixels = Halve(pixels, width, height);
+        pixels = level_pixels.data();
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+      }
+    }
+    if (!file) {
+      throw Error("failed to write " + temp_path);
+    }
+  }
+  std::error_code error_code;
+  std::filesystem::rename(temp_path, path, error_code);
+  if (error_code) {
+    std::filesystem::remove(temp_path, error_code);
+    throw Error("failed to replace " + path);
+  }
+}
+
+} // namespace texture
@@ -0,0 +1,66 @@
+#ifndef TEXTURE_TILED_H_
+#define TEXTURE_TILED_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+
+namespace texture {
+
+// Texels per tile side, and texels repeated from the neighbouring tiles around every tile so filtering never reads past
+// its edge. Tiles are stored as rgba8 with their border.
+constexpr uint32_t kTileSize = 128;
+constexpr uint32_t kTileBorder = 4;
+constexpr uint32_t kTileStride = kTileSize + 2 * kTileBorder;
+constexpr size_t kTileBytes = static_cast<size_t>(kTileStride) * kTileStride * 4;
+
+// Every level is half of the previous one rounded up, so a texel of level l covers 2^l texels of level 0 on each axis.
+// The tile grid of level 0 is rounded up to powers of two and level l has max(columns >> l, 1) by max(rows >> l, 1)
+// tiles, down to a single tile. Tiles are indexed level by level, finest first, row major within a level.
+struct TileLayout {
+  uint32_t width;
+  uint32_t height;
+  uint32_t columns;
+  uint32_t rows;
+  uint32_t level_count;
+
+  [[nodiscard]] uint32_t LevelColumns(uint32_t level) const noexcept;
+  [[nodiscard]] uint32_t LevelRows(uint32_t level) const noexcept;
+  [[nodiscard]] uint32_t FirstTile(uint32_t level) const noexcept;
+  [[nodiscard]] uint32_t TileCount() const noexcept;
+};
+
+[[nodiscard]] TileLayout GetTileLayout(uint32_t width, uint32_t height) noexcept;
+
+// Reads single tiles of a tile file, not thread safe.
+class TiledFile final {
+public:
+  explicit TiledFile(const std::string& path);
+
+  [[nodiscard]] const TileLayout& layout() const noexcept;
+
+  // Copies kTileBytes into dst.
+  void ReadTile(uint32_t tile, uint8_t* dst);
+private:
+  std::string path_;
+  std::ifstream file_;
+  TileLayout layout_;
+};
+
+inline const TileLayout& TiledFile::layout() const noexcept {
+  return layout_;
+}
+
+// Tile files live next to the source image as <image>.tiles and are reused while newer than the source.
+[[nodiscard]] std::string TiledPath(const std::string& source_path);
+// Empty when the tile file is missing, older than the source or unreadable.
+[[nodiscard]] std::optional<TiledFile> OpenTiled(const std::string& source_path);
+// Cuts the mip chain of rgba8 pixels into tiles, one level in memory at a time. Texels past the edge of a level repeat
+// its last row and column.
+void WriteTiled(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height);
+
+} // namespace texture
+
+#endif // TEXTURE_TILED_H_
@@ -0,0 +1,14 @@
+#ifndef TRACE_ERROR_H_
+#define TRACE_ERROR_H_
+
+#include <stdexcept>
+
+namespace trace {
+
+struct Error final : std::runtime_error {
+  using runtime_error::runtime_error;
+};
+
+} // namespace trace
+
+#endif // TRACE_ERROR_H_
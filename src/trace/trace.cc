@@ -0,0 +1,134 @@
+#include "trace/trace.h"
+
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "trace/error.h"
+
+namespace trace {
+
+namespace {
+
+constexpr size_t kMaxThreadEvents = 1 << 20;
+
+struct Event {
+  const char* name;
+  Clock::time_point start;
+  Clock::time_point end;
+};
+
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::vector<Event> events;
+  uint32_t tid = 0;
+};
+
+class Registry {
+public:
+  Registry() : epoch_(Clock::now()), next_tid_(1), enabled_(true) {}
+
+  std::shared_ptr<ThreadBuffer> Register() {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard lock(mutex_);
+    buffer->tid = next_tid_++;
+    buffers_.push_back(buffer);
+    return buffer;
+  }
+
+  [[nodiscard]] Clock::time_point epoch() const noexcept {
+    return epoch_;
+  }
+
+  [[nodiscard]] std::atomic<bool>& enabled() noexcept {
+    return enabled_;
+  }
+
+  std::vector<std::pair<uint32_t, std::vector<Event>>> TakeEvents() {
+    std::vector<std::pair<uint32_t, std::vector<Event>>> events;
+    std::lock_guard lock(mutex_);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers_) {
+      std::lock_guard buffer_lock(buffer->mutex);
+      events.emplace_back(buffer->tid, std::exchange(buffer->events, {}));
+    }
+    return events;
+  }
+private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  Clock::time_point epoch_;
+  uint32_t next_tid_;
+  std::atomic<bool> enabled_;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer = GetRegistry().Register();
+  return *buffer;
+}
+
+double ToMicroseconds(const Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // namespace
+
+void Record(const char* name, const Clock::time_point start, const Clock::time_point end) noexcept {
+  if (!enabled()) {
+    return;
+  }
+  // an event that cannot be stored is dropped, tracing never takes the traced code down
+  try {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard lock(buffer.mutex);
+    if (buffer.events.size() == kMaxThreadEvents) {
+      return;
+    }
+    if (buffer.events.capacity() == 0) {
+      buffer.events.reserve(4096);
+    }
+    buffer.events.push_back({name, start, end});
+  } catch (const std::exception&) {
+    return;
+  }
+}
+
+void SetEnabled(const bool enabled) noexcept {
+  GetRegistry().enabled().store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled() noexcept {
+  return GetRegistry().enabled().load(std::memory_order_relaxed);
+}
+
+void Flush(const std::string& path) {
+  std::ofstream file(path, std::ios::trunc);
+  if (!file.is_open()) {
+    throw Error("failed to open trace file " + path);
+  }
+  const Clock::time_point epoch = GetRegistry().epoch();
+
+  file << "{\"traceEvents\": [";
+  bool first = true;
+  for (const auto& [tid, events] : GetRegistry().TakeEvents()) {
+    for (const auto [name, start, end] : events) {
+      file << (first ? "\n" : ",\n")
+           << "  {\"name\": \"" << name
+           << "\", \"ph\": \"X\", \"ts\": " << ToMicroseconds(start - epoch)
+           << ", \"dur\": " << ToMicroseconds(end - start)
+           << ", \"pid\": 1, \"tid\": " << tid << '}';
+      first = false;
+    }
+  }
+  file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+} // namespace trace
@@ -0,0 +1,43 @@
+#ifndef TRACE_TRACE_H_
+#define TRACE_TRACE_H_
+
+#include <chrono>
+#include <string>
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(name) ::trace::Zone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+
+namespace trace {
+
+using Clock = std::chrono::steady_clock;
+
+// Names must outlive the trace, string literals are expected.
+void Record(const char* name, Clock::time_point start, Clock::time_point end) noexcept;
+void SetEnabled(bool enabled) noexcept;
+[[nodiscard]] bool enabled() noexcept;
+
+// Writes every event recorded so far as chrome trace_event json and clears the thread buffers.
+void Flush(const std::string& path);
+
+class Zone {
+public:
+  explicit Zone(const char* name) noexcept;
+  Zone(const Zone&) = delete;
+  ~Zone();
+
+  Zone& operator=(const Zone&) = delete;
+private:
+  const char* name_;
+  Clock::time_point start_;
+};
+
+inline Zone::Zone(const char* name) noexcept : name_(name), start_(Clock::now()) {}
+
+inline Zone::~Zone() {
+  Record(name_, start_, Clock::now());
+}
+
+} // namespace trace
+
+#endif // TRACE_TRACE_H_